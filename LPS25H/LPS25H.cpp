@@ -19,43 +19,46 @@
 
 #include "LPS25H.h"
 
-LPS25H::LPS25H (PinName p_sda, PinName p_scl, uint8_t addr) : _i2c(p_sda, p_scl)
+LPS25H::LPS25H (PinName p_sda, PinName p_scl, uint8_t addr)
+    : _i2c_p(new I2CBus(p_sda, p_scl)), _i2c(*_i2c_p, addr)
 {
-    LPS25H_addr = addr;
     LPS25H_mode = FIFO_HW_FILTER;
     init();
 }
 
-LPS25H::LPS25H (PinName p_sda, PinName p_scl, uint8_t addr, uint8_t mode) : _i2c(p_sda, p_scl)
+LPS25H::LPS25H (PinName p_sda, PinName p_scl, uint8_t addr, uint8_t mode)
+    : _i2c_p(new I2CBus(p_sda, p_scl)), _i2c(*_i2c_p, addr)
 {
-    LPS25H_addr = addr;
     LPS25H_mode = mode;
     init();
 }
 
-LPS25H::LPS25H (I2C& p_i2c, uint8_t addr) : _i2c(p_i2c)
+LPS25H::LPS25H (I2CBus& p_i2c, uint8_t addr) : _i2c_p(NULL), _i2c(p_i2c, addr)
 {
-    LPS25H_addr = addr;
     LPS25H_mode = FIFO_HW_FILTER;
     init();
 }
 
-LPS25H::LPS25H (I2C& p_i2c, uint8_t addr, uint8_t mode) : _i2c(p_i2c)
+LPS25H::LPS25H (I2CBus& p_i2c, uint8_t addr, uint8_t mode) : _i2c_p(NULL), _i2c(p_i2c, addr)
 {
-    LPS25H_addr = addr;
     LPS25H_mode = mode;
     init();
 }
 
+LPS25H::~LPS25H()
+{
+    if (_i2c_p != NULL) {
+        delete _i2c_p;
+    }
+}
+
 /////////////// Initialize ////////////////////////////////
 void LPS25H::init(void)
 {
-    _i2c.frequency(100000);
+    int err = 0;
+
     // Check acc is available of not
-    dt[0] = LPS25H_WHO_AM_I;
-    _i2c.write(LPS25H_addr, dt, 1, true);
-    _i2c.read(LPS25H_addr, dt, 1, false);
-    if (dt[0] == I_AM_LPS25H) {
+    if (_i2c.check_id(LPS25H_WHO_AM_I, I_AM_LPS25H)) {
         LPS25H_id = I_AM_LPS25H;
         LPS25H_ready = 1;
     } else {
@@ -63,47 +66,132 @@ void LPS25H::init(void)
         LPS25H_ready = 0;
         return;     // acc chip is NOT on I2C line then terminate
     }
+    // Keep the configuration writes together on the bus
+    _i2c.lock();
     if (LPS25H_mode == FIFO_HW_FILTER){
         // Hardware digital filter
         // AN4450 April 2014 Rev1 P20/26, Filter enabling and suggested configuration
         dt[0] = LPS25H_RES_CONF;
         dt[1] = 0x05;
-        _i2c.write(LPS25H_addr, dt, 2, false);
+        err |= _i2c.write(dt, 2, false);
         dt[0] = LPS25H_FIFO_CTRL;
         dt[1] = 0xdf;
-        _i2c.write(LPS25H_addr, dt, 2, false);
+        err |= _i2c.write(dt, 2, false);
         dt[0] = LPS25H_CTRL_REG2;
         dt[1] = 0x40;
-        _i2c.write(LPS25H_addr, dt, 2, false);
+        err |= _i2c.write(dt, 2, false);
         dt[0] = LPS25H_CTRL_REG1;
         dt[1] = 0x90;
-        _i2c.write(LPS25H_addr, dt, 2, false);
+        err |= _i2c.write(dt, 2, false);
+    } else if (LPS25H_mode == FIFO_STREAM){
+        // 32 slot FIFO in stream mode, filled at 25Hz and drained by get_fifo()
+        dt[0] = LPS25H_RES_CONF;
+        dt[1] = 0x05;
+        err |= _i2c.write(dt, 2, false);
+        dt[0] = LPS25H_FIFO_CTRL;
+        dt[1] = FIFO_STREAM_MODE;
+        err |= _i2c.write(dt, 2, false);
+        dt[0] = LPS25H_CTRL_REG2;
+        dt[1] = FIFO_EN;
+        err |= _i2c.write(dt, 2, false);
+        dt[0] = LPS25H_CTRL_REG1;
+        dt[1] = CR_STREAM_SET;
+        err |= _i2c.write(dt, 2, false);
     } else {
         dt[0] = LPS25H_CTRL_REG2;
         dt[1] = 0x0;
-        _i2c.write(LPS25H_addr, dt, 2, false);       
+        err |= _i2c.write(dt, 2, false);       
         dt[0] = LPS25H_CTRL_REG1;
         dt[1] = CR_STD_SET;
-        _i2c.write(LPS25H_addr, dt, 2, false);
+        err |= _i2c.write(dt, 2, false);
+    }
+    _i2c.unlock();
+    if (err) {
+        LPS25H_ready = 0;   // half configured, get() probes again
     }
 }
 
 /////////////// Start conv. and gwt all data //////////////
-void LPS25H::get(void)
+bool LPS25H::get(void)
+{
+    if (LPS25H_ready == 0) {
+        // Missing at start-up or lost since: probe and configure again
+        init();
+        if (LPS25H_ready == 0) {
+            return false;
+        }
+    }
+    // PRESS_POUT_XL..TEMP_OUT_H are contiguous: one auto-increment read
+    char reg = LPS25H_PRESS_POUT_XL | 0x80;
+    char raw[LPS25H_RAW_SIZE];
+    LPS25H_sample_t sample;
+    if (_i2c.write_read(&reg, 1, raw, LPS25H_RAW_SIZE) != 0) {
+        return false;
+    }
+    decode(raw, &sample);
+    press = sample.press;
+    temp = sample.temp;
+    return true;
+}
+
+#if DEVICE_I2C_ASYNCH
+int LPS25H::get_async(char *raw, const event_callback_t& callback)
+{
+    static const char reg = LPS25H_PRESS_POUT_XL | 0x80;
+
+    if (LPS25H_ready == 0) {
+        return -1;
+    }
+    return _i2c.transfer(&reg, 1, raw, LPS25H_RAW_SIZE, callback, I2C_EVENT_ALL, false);
+}
+#endif
+
+void LPS25H::decode(const char *raw, LPS25H_sample_t *sample)
+{
+    const uint8_t *p = (const uint8_t *)raw;
+    sample->press = p[2] << 16 | p[1] << 8 | p[0];
+    sample->temp = p[4] << 8 | p[3];
+}
+
+/////////////// FIFO burst read /////////////////////////
+uint8_t LPS25H::fifo_level()
 {
     if (LPS25H_ready == 0) {
-        press = 0;
-        temp = 0;
-        return;
+        return 0;
+    }
+    uint8_t status = read_reg(LPS25H_FIFO_STATUS);
+    if (status & FIFO_STATUS_EMPTY) {
+        return 0;
+    }
+    if (status & FIFO_STATUS_FULL) {
+        return LPS25H_FIFO_DEPTH;
     }
-    dt[0] = LPS25H_PRESS_POUT_XL | 0x80;
-    _i2c.write(LPS25H_addr, dt, 1, true);
-    _i2c.read(LPS25H_addr, dt, 3, false);
-    press = dt[2] << 16 | dt[1] << 8 | dt[0];
-    dt[0] = LPS25H_TEMP_OUT_L | 0x80;
-    _i2c.write(LPS25H_addr, dt, 1, true);
-    _i2c.read(LPS25H_addr, dt, 2, false);
-    temp = dt[1] << 8 | dt[0];
+    return status & FIFO_STATUS_FSS;
+}
+
+int LPS25H::get_fifo(LPS25H_sample_t *samples, int max)
+{
+    char buf[LPS25H_FIFO_DEPTH * LPS25H_RAW_SIZE];
+    char reg = LPS25H_PRESS_POUT_XL | 0x80;
+    int n = fifo_level();
+
+    if (n > max) {
+        n = max;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    // With the FIFO enabled the address auto-increment wraps from TEMP_OUT_H
+    // back to PRESS_OUT_XL, so one read pops n pressure/temperature pairs
+    if (_i2c.write_read(&reg, 1, buf, n * LPS25H_RAW_SIZE)) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        decode(&buf[i * LPS25H_RAW_SIZE], &samples[i]);
+    }
+    press = samples[n - 1].press;
+    temp = samples[n - 1].temp;
+    return n;
 }
 
 /////////////// Read data from sensor /////////////////////
@@ -118,15 +206,87 @@ float LPS25H::temperature()
     return (float)temp / 480  + 42.5;
 }
 
+/////////////// Fixed point /////////////////////////////
+uint32_t LPS25H::pressure_x100()
+{
+    return raw_to_pressure_x100(press);
+}
+
+int16_t LPS25H::temperature_x100()
+{
+    return raw_to_temperature_x100(temp);
+}
+
+uint32_t LPS25H::raw_to_pressure_x100(uint32_t raw)
+{
+    // raw * 100 / 4096, rounded
+    return (raw * 25 + 512) / 1024;
+}
+
+int16_t LPS25H::raw_to_temperature_x100(int16_t raw)
+{
+    // raw * 100 / 480 + 4250, rounded half away from zero
+    int32_t t = (int32_t)raw * 5;
+    t = (t >= 0 ? t + 12 : t - 12) / 24;
+    return (int16_t)(t + 4250);
+}
+
+/////////////// Raw data //////////////////////////////////
+uint32_t LPS25H::pressure_raw()
+{
+    return press;
+}
+
+int16_t LPS25H::temperature_raw()
+{
+    return temp;
+}
+
 /////////////// ID ////////////////////////////////////////
 uint8_t LPS25H::read_id()
 {
     dt[0] = LPS25H_WHO_AM_I;
-    _i2c.write(LPS25H_addr, dt, 1, true);
-    _i2c.read(LPS25H_addr, dt, 1, false);
+    if (_i2c.write_read(dt, 1, dt, 1) != 0) {
+        return 0;
+    }
     return (uint8_t)dt[0];
 }
 
+/////////////// Bus health //////////////////////////////
+const I2CHealth& LPS25H::health()
+{
+    return _i2c.health();
+}
+
+/////////////// Data ready & one-shot /////////////////
+uint8_t LPS25H::data_ready()
+{
+    uint8_t status = read_reg(LPS25H_STATUS_REG);
+    if (LPS25H_ready == 0) {
+        return 0;
+    }
+    return (status & (STATUS_P_DA | STATUS_T_DA)) == (STATUS_P_DA | STATUS_T_DA);
+}
+
+void LPS25H::one_shot()
+{
+    // Read-modify-write keeps the FIFO configuration of the current mode
+    write_reg(LPS25H_CTRL_REG2, read_reg(LPS25H_CTRL_REG2) | ONE_SHOT);
+}
+
+/////////////// Output data rate ////////////////////////
+void LPS25H::odr(uint8_t rate)
+{
+    write_reg(LPS25H_CTRL_REG1, ACTIVE | rate | BDU_SET);
+}
+
+/////////////// Data ready on INT1 //////////////////////
+void LPS25H::drdy_enable(bool enable)
+{
+    write_reg(LPS25H_CTRL_REG3, INT_DATA_SIGNAL);
+    write_reg(LPS25H_CTRL_REG4, enable ? P1_DRDY : 0);
+}
+
 /////////////// I2C Freq. /////////////////////////////////
 void LPS25H::frequency(int hz)
 {
@@ -136,11 +296,8 @@ void LPS25H::frequency(int hz)
 /////////////// General purpose R/W ///////////////////////
 uint8_t LPS25H::read_reg(uint8_t addr)
 {
-    if (LPS25H_ready == 1) {
-        dt[0] = addr;
-        _i2c.write(LPS25H_addr, dt, 1, true);
-        _i2c.read(LPS25H_addr, dt, 1, false);
-    } else {
+    dt[0] = addr;
+    if (LPS25H_ready == 0 || _i2c.write_read(dt, 1, dt, 1) != 0) {
         dt[0] = 0xff;
     }
     return (uint8_t)dt[0];
@@ -151,6 +308,6 @@ void LPS25H::write_reg(uint8_t addr, uint8_t data)
     if (LPS25H_ready == 1) {
         dt[0] = addr;
         dt[1] = data;
-        _i2c.write(LPS25H_addr, dt, 2, false);
+        _i2c.write(dt, 2, false);
     }
 }
@@ -31,6 +31,7 @@
 #define LPS25H_H
 
 #include "mbed.h"
+#include "I2CBus.h"
 
 //  LPS25H Address
 //  7bit address = 0b101110x(0x5c or 0x5d depends on SA0/SDO)
@@ -38,6 +39,7 @@
 #define LPS25H_V_CHIP_ADDR  (0x5d << 1)    // SA0(=SDO pin) = Vdd
 
 // MODE Selection
+#define FIFO_STREAM             2
 #define FIFO_HW_FILTER          1
 #define FIFO_BYPASS             0
 
@@ -61,20 +63,33 @@
 #define LPS25H_TEMP_OUT_H      0x2c
 
 #define LPS25H_FIFO_CTRL       0x2e
-#define LPS25H_FIFO_STATUS     0x2e
+#define LPS25H_FIFO_STATUS     0x2f
 
 // Control Reg.
 #define PD              (0UL << 7)
 #define ACTIVE          (1UL << 7)
 #define ODR_ONESHOT     (0UL << 4)
 #define ODR_1HZ         (1UL << 4)
-#define ODR_7HZ         (1UL << 4)
-#define ODR_12R5HZ      (2UL << 4)
-#define ODR_25HZ        (3UL << 4)
+#define ODR_7HZ         (2UL << 4)
+#define ODR_12R5HZ      (3UL << 4)
+#define ODR_25HZ        (4UL << 4)
 #define BDU_SET         (1UL << 2)
 #define CR_STD_SET      (ACTIVE + ODR_7HZ + BDU_SET)
+#define CR_STREAM_SET   (ACTIVE + ODR_25HZ + BDU_SET)
+#define FIFO_EN         (1UL << 6)      // CTRL_REG2
+#define ONE_SHOT        (1UL << 0)      // CTRL_REG2, cleared when the conversion is done
+
+// Status Reg.
+#define STATUS_P_DA     (1UL << 1)
+#define STATUS_T_DA     (1UL << 0)
+
+// Interrupt Control
+#define INT_DATA_SIGNAL        (0UL << 0)   // CTRL_REG3 INT1_S: data signal on INT1
+#define P1_DRDY                (1UL << 0)   // CTRL_REG4: data ready on INT1
 
 // FIFO Control
+#define FIFO_FIFO_MODE         0x20
+#define FIFO_STREAM_MODE       0x40
 #define FIFO_MEAN_MODE         0xc0
 #define FIFO_SAMPLE_2          0x01
 #define FIFO_SAMPLE_4          0x03
@@ -82,6 +97,22 @@
 #define FIFO_SAMPLE_16         0x0f
 #define FIFO_SAMPLE_32         0x1f
 
+// FIFO Status
+#define FIFO_STATUS_WTM        0x80
+#define FIFO_STATUS_FULL       0x40
+#define FIFO_STATUS_EMPTY      0x20
+#define FIFO_STATUS_FSS        0x1f
+#define LPS25H_FIFO_DEPTH      32
+
+// Size of one PRESS_POUT_XL..TEMP_OUT_H block
+#define LPS25H_RAW_SIZE        5
+
+/** One pressure/temperature pair in raw units */
+typedef struct {
+    uint32_t press;        // 1/4096 hPa
+    int16_t temp;          // degC = temp / 480 + 42.5
+} LPS25H_sample_t;
+
 /** Interface for STMicronics MEMS pressure sensor
  *      Chip: LPS25H
  *
@@ -93,7 +124,7 @@
  * LPS25H baro(p_sda, p_scl, LPS25H_G_CHIP_ADDR);
  * // If you connected I2C line not only this device but also other devices,
  * //     you need to declare following method.
- * I2C i2c(dp5,dp27);              // SDA, SCL
+ * I2CBus i2c(dp5,dp27);           // SDA, SCL
  * LPS25H baro(i2c, LPS25H_G_CHIP_ADDR);
  *
  * int main() {
@@ -112,24 +143,62 @@ public:
     /** Configure data pin
       * @param data SDA and SCL pins
       * @param device address LPS25H(SA0=0 or 1), LPS25H_G_CHIP_ADDR or LPS25H_V_CHIP_ADDR
-      * @param Operation mode FIFO_HW_FILTER(default) or FIFO_BYPASS (Option parameter)
+      * @param Operation mode FIFO_HW_FILTER(default), FIFO_BYPASS or FIFO_STREAM (Option parameter)
       */
     LPS25H(PinName p_sda, PinName p_scl, uint8_t addr);
     LPS25H(PinName p_sda, PinName p_scl, uint8_t addr, uint8_t mode);
 
     /** Configure data pin (with other devices on I2C line)
-      * @param I2C previous definition
+      * @param shared I2C bus
       * @param device address LPS25H(SA0=0 or 1), LPS25H_G_CHIP_ADDR or LPS25H_V_CHIP_ADDR
-      * @param Operation mode FIFO_HW_FILTER(default) or FIFO_BYPASS (Option parameter)
+      * @param Operation mode FIFO_HW_FILTER(default), FIFO_BYPASS or FIFO_STREAM (Option parameter)
       */
-    LPS25H(I2C& p_i2c, uint8_t addr);
-    LPS25H(I2C& p_i2c, uint8_t addr, uint8_t mode);
+    LPS25H(I2CBus& p_i2c, uint8_t addr);
+    LPS25H(I2CBus& p_i2c, uint8_t addr, uint8_t mode);
+
+    virtual ~LPS25H();
 
     /** Start convertion & data save
+      *  A sensor that did not answer before is probed and configured again.
       * @param none
+      * @return false if the sensor is missing or the read failed, the last data is then kept
+      */
+    bool get(void);
+
+#if DEVICE_I2C_ASYNCH
+    /** Start a non-blocking read of pressure and temperature
+      *  Both are read with one auto-increment transfer into the caller's
+      *  buffer, which must stay valid until the callback has run. The
+      *  callback runs in interrupt context with the I2C event; convert the
+      *  buffer with decode() on I2C_EVENT_TRANSFER_COMPLETE.
+      * @param buffer of LPS25H_RAW_SIZE bytes
+      * @param callback completion callback
+      * @return 0 if the read was started, -1 if the bus is busy or no sensor
+      */
+    int get_async(char *raw, const event_callback_t& callback);
+#endif
+
+    /** Convert a PRESS_POUT_XL..TEMP_OUT_H block
+      * @param LPS25H_RAW_SIZE bytes as read from the sensor
+      * @param converted sample
       * @return none
       */
-    void get(void);
+    static void decode(const char *raw, LPS25H_sample_t *sample);
+
+    /** Number of samples waiting in the FIFO (FIFO_STREAM mode)
+      * @param none
+      * @return 0 to LPS25H_FIFO_DEPTH
+      */
+    uint8_t fifo_level(void);
+
+    /** Drain the FIFO with one auto-increment burst read (FIFO_STREAM mode)
+      *  The newest sample also becomes the value returned by pressure() and
+      *  temperature().
+      * @param buffer for the samples, oldest first
+      * @param buffer size in samples
+      * @return number of samples read
+      */
+    int get_fifo(LPS25H_sample_t *samples, int max);
 
     /** Read pressure data
       * @param none
@@ -143,19 +212,80 @@ public:
       */
     float temperature(void);
 
+    /** Read pressure data in fixed point
+      * @param none
+      * @return pressure in 0.01 hPa
+      */
+    uint32_t pressure_x100(void);
+
+    /** Read temperature data in fixed point
+      * @param none
+      * @return temperature in 0.01 degC
+      */
+    int16_t temperature_x100(void);
+
+    /** Convert a raw pressure
+      * @param pressure in 1/4096 hPa
+      * @return pressure in 0.01 hPa
+      */
+    static uint32_t raw_to_pressure_x100(uint32_t raw);
+
+    /** Convert a raw temperature
+      * @param temperature as read, degC = raw / 480 + 42.5
+      * @return temperature in 0.01 degC
+      */
+    static int16_t raw_to_temperature_x100(int16_t raw);
+
+    /** Read raw pressure data
+      * @param none
+      * @return pressure in 1/4096 hPa
+      */
+    uint32_t pressure_raw(void);
+
+    /** Read raw temperature data
+      * @param none
+      * @return temperature, degC = raw / 480 + 42.5
+      */
+    int16_t temperature_raw(void);
+
     /** Read a ID number
       * @param none
-      * @return if STM MEMS LPS25H, it should be I_AM_ LPS25H
+      * @return if STM MEMS LPS25H, it should be I_AM_ LPS25H, 0 if the read failed
       */
     uint8_t read_id(void);
 
+    /** Health counters of the sensor's I2C traffic
+      * @param none
+      * @return counters, see I2CBus.h
+      */
+    const I2CHealth& health(void);
+
     /** Read Data Ready flag
       * @param none
       * @return 1 = Ready
       */
     uint8_t data_ready(void);
 
-    /** Set I2C clock frequency
+    /** Start a one-shot conversion (ODR_ONESHOT)
+      *  The sensor returns to its power-down level once the sample is ready.
+      * @param none
+      * @return none
+      */
+    void one_shot(void);
+
+    /** Set the output data rate
+      * @param ODR_ONESHOT, ODR_1HZ, ODR_7HZ, ODR_12R5HZ or ODR_25HZ
+      * @return none
+      */
+    void odr(uint8_t rate);
+
+    /** Route the data ready signal to the INT1 pin (active high, push-pull)
+      * @param enable true to raise INT1 whenever a new sample is available
+      * @return none
+      */
+    void drdy_enable(bool enable);
+
+    /** Set the I2C clock frequency used for this sensor
       * @param freq.
       * @return none
       */
@@ -175,13 +305,13 @@ public:
     void write_reg(uint8_t addr, uint8_t data);
 
 protected:
-    I2C _i2c;
+    I2CBus *_i2c_p;
+    I2CDevice _i2c;
 
     void init(void);
 
 private:
     char dt[6];            // working buffer
-    uint8_t LPS25H_addr;   // Sensor address
     uint8_t LPS25H_id;     // ID
     uint8_t LPS25H_ready;  // Device is on I2C line = 1, not = 0
     uint8_t LPS25H_mode;   // Operation mode
@@ -0,0 +1,123 @@
+#include "LSM6DS0.h"
+
+LSM6DS0::LSM6DS0(I2CBus& i2c, uint8_t addr) : _i2c(i2c, addr), _ready(false), _fifo_reg(LSM6DS0_OUT_X_L_G)
+{
+}
+
+bool LSM6DS0::init(void)
+{
+    _ready = _i2c.check_id(LSM6DS0_WHO_AM_I, I_AM_LSM6DS0);
+    if (!_ready) {
+        return false;
+    }
+    _i2c.lock();
+    write_reg(LSM6DS0_CTRL_REG1_G, LSM6DS0_ODR_OFF | LSM6DS0_FS_245DPS);
+    write_reg(LSM6DS0_CTRL_REG4, LSM6DS0_G_XYZ_EN);
+    write_reg(LSM6DS0_CTRL_REG5_XL, LSM6DS0_XL_XYZ_EN);
+    write_reg(LSM6DS0_CTRL_REG6_XL, LSM6DS0_FS_2G);
+    write_reg(LSM6DS0_CTRL_REG8, LSM6DS0_BDU | LSM6DS0_IF_ADD_INC);
+    write_reg(LSM6DS0_CTRL_REG9, LSM6DS0_FIFO_EN);
+    write_reg(LSM6DS0_FIFO_CTRL, LSM6DS0_FIFO_CONTINUOUS);
+    _i2c.unlock();
+    return true;
+}
+
+void LSM6DS0::odr(uint8_t rate)
+{
+    _i2c.lock();
+    // Going through bypass mode empties the FIFO, so old samples don't
+    // turn up with the new rate
+    write_reg(LSM6DS0_FIFO_CTRL, LSM6DS0_FIFO_BYPASS);
+    write_reg(LSM6DS0_CTRL_REG1_G, rate | LSM6DS0_FS_245DPS);
+    write_reg(LSM6DS0_FIFO_CTRL, LSM6DS0_FIFO_CONTINUOUS);
+    _i2c.unlock();
+}
+
+uint16_t LSM6DS0::odr_hz(uint8_t rate)
+{
+    static const uint16_t hz[8] = { 0, 15, 60, 119, 238, 476, 952, 0 };
+    return hz[(rate >> 5) & 7];
+}
+
+uint8_t LSM6DS0::fifo_status(void)
+{
+    return read_reg(LSM6DS0_FIFO_SRC);
+}
+
+int LSM6DS0::get_fifo(LSM6DS0_sample_t *samples, int max)
+{
+    char buf[LSM6DS0_FIFO_DEPTH * LSM6DS0_RAW_SIZE];
+    int n = fifo_status() & LSM6DS0_FIFO_SRC_FSS;
+
+    if (n > max) {
+        n = max;
+    }
+    if (n > LSM6DS0_FIFO_DEPTH) {
+        n = LSM6DS0_FIFO_DEPTH;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    // With the FIFO enabled the address auto-increment rolls over from
+    // OUT_Z_H_G to OUT_X_L_XL and from OUT_Z_H_XL back to OUT_X_L_G, so one
+    // read pops n gyroscope/accelerometer pairs
+    if (_i2c.write_read(&_fifo_reg, 1, buf, n * LSM6DS0_RAW_SIZE)) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        decode(&buf[i * LSM6DS0_RAW_SIZE], &samples[i]);
+    }
+    return n;
+}
+
+#if DEVICE_I2C_ASYNCH
+int LSM6DS0::get_fifo_async(char *raw, int count, const event_callback_t& callback)
+{
+    if (!_ready || count <= 0 || count > LSM6DS0_FIFO_DEPTH) {
+        return -1;
+    }
+    return _i2c.transfer(&_fifo_reg, 1, raw, count * LSM6DS0_RAW_SIZE, callback, I2C_EVENT_ALL, false);
+}
+#endif
+
+void LSM6DS0::decode(const char *raw, LSM6DS0_sample_t *sample)
+{
+    const uint8_t *p = (const uint8_t *)raw;
+    for (int i = 0; i < 3; i++) {
+        sample->gyro[i] = (int16_t)(p[2 * i + 1] << 8 | p[2 * i]);
+        sample->accel[i] = (int16_t)(p[2 * i + 7] << 8 | p[2 * i + 6]);
+    }
+}
+
+uint8_t LSM6DS0::read_id(void)
+{
+    char reg = LSM6DS0_WHO_AM_I;
+    char id = 0;
+    _i2c.write_read(&reg, 1, &id, 1);
+    return (uint8_t)id;
+}
+
+const I2CHealth& LSM6DS0::health(void)
+{
+    return _i2c.health();
+}
+
+uint8_t LSM6DS0::read_reg(uint8_t addr)
+{
+    char reg = addr;
+    char data = 0;
+    if (!_ready || _i2c.write_read(&reg, 1, &data, 1)) {
+        return 0;
+    }
+    return (uint8_t)data;
+}
+
+void LSM6DS0::write_reg(uint8_t addr, uint8_t data)
+{
+    char dt[2];
+    if (_ready) {
+        dt[0] = addr;
+        dt[1] = data;
+        _i2c.write(dt, 2, false);
+    }
+}
@@ -0,0 +1,200 @@
+/*
+ * LSM6DS0 accelerometer/gyroscope driver
+ *
+ * Both parts run at the gyroscope output data rate and every sample pair
+ * goes through the 32 slot FIFO in continuous mode, which is drained with
+ * one auto-increment burst read, blocking or non-blocking.
+ *
+ * tools/lsm6ds0_test.cpp runs the bursts, and sampler/MotionStream on top
+ * of them, against a register model of the FIFO on the host.
+ */
+#ifndef LSM6DS0_H
+#define LSM6DS0_H
+
+#include "mbed.h"
+#include "I2CBus.h"
+
+//  LSM6DS0 Address
+//  7bit address = 0b110101x(0x6a or 0x6b depends on SA0)
+#define LSM6DS0_G_CHIP_ADDR     (0x6a << 1)     // SA0 = Ground
+#define LSM6DS0_V_CHIP_ADDR     (0x6b << 1)     // SA0 = Vdd, as fitted on the X-NUCLEO-IKS01A1
+
+//   LSM6DS0 ID
+#define I_AM_LSM6DS0            0x68
+
+//  Register's definition
+#define LSM6DS0_INT_CTRL        0x0c
+#define LSM6DS0_WHO_AM_I        0x0f
+#define LSM6DS0_CTRL_REG1_G     0x10
+#define LSM6DS0_STATUS_REG      0x17
+#define LSM6DS0_OUT_X_L_G       0x18
+#define LSM6DS0_CTRL_REG4       0x1e
+#define LSM6DS0_CTRL_REG5_XL    0x1f
+#define LSM6DS0_CTRL_REG6_XL    0x20
+#define LSM6DS0_CTRL_REG8       0x22
+#define LSM6DS0_CTRL_REG9       0x23
+#define LSM6DS0_OUT_X_L_XL      0x28
+#define LSM6DS0_FIFO_CTRL       0x2e
+#define LSM6DS0_FIFO_SRC        0x2f
+
+// CTRL_REG1_G, output data rate of both parts
+#define LSM6DS0_ODR_OFF         (0UL << 5)
+#define LSM6DS0_ODR_15HZ        (1UL << 5)      // 14.9 Hz
+#define LSM6DS0_ODR_60HZ        (2UL << 5)      // 59.5 Hz
+#define LSM6DS0_ODR_119HZ       (3UL << 5)
+#define LSM6DS0_ODR_238HZ       (4UL << 5)
+#define LSM6DS0_ODR_476HZ       (5UL << 5)
+#define LSM6DS0_ODR_952HZ       (6UL << 5)
+#define LSM6DS0_FS_245DPS       (0UL << 3)      // 8.75 mdps/LSB
+#define LSM6DS0_FS_500DPS       (1UL << 3)      // 17.5 mdps/LSB
+#define LSM6DS0_FS_2000DPS      (3UL << 3)      // 70 mdps/LSB
+
+// CTRL_REG4 / CTRL_REG5_XL
+#define LSM6DS0_G_XYZ_EN        0x38
+#define LSM6DS0_XL_XYZ_EN       0x38
+
+// CTRL_REG6_XL
+#define LSM6DS0_FS_2G           (0UL << 3)      // 0.061 mg/LSB
+#define LSM6DS0_FS_4G           (2UL << 3)      // 0.122 mg/LSB
+#define LSM6DS0_FS_8G           (3UL << 3)      // 0.244 mg/LSB
+#define LSM6DS0_FS_16G          (1UL << 3)      // 0.732 mg/LSB
+
+// CTRL_REG8
+#define LSM6DS0_BDU             (1UL << 6)
+#define LSM6DS0_IF_ADD_INC      (1UL << 2)
+
+// CTRL_REG9
+#define LSM6DS0_FIFO_EN         (1UL << 1)
+
+// FIFO_CTRL
+#define LSM6DS0_FIFO_BYPASS     0x00
+#define LSM6DS0_FIFO_CONTINUOUS 0xc0
+
+// FIFO_SRC
+#define LSM6DS0_FIFO_SRC_FTH    0x80
+#define LSM6DS0_FIFO_SRC_OVRN   0x40
+#define LSM6DS0_FIFO_SRC_FSS    0x3f
+#define LSM6DS0_FIFO_DEPTH      32
+
+// Size of one OUT_X_L_G..OUT_Z_H_G + OUT_X_L_XL..OUT_Z_H_XL FIFO slot
+#define LSM6DS0_RAW_SIZE        12
+
+/** One gyroscope/accelerometer pair in raw units */
+typedef struct {
+    int16_t gyro[3];       // 8.75 mdps/LSB at 245 dps
+    int16_t accel[3];      // 0.061 mg/LSB at 2 g
+} LSM6DS0_sample_t;
+
+/** Interface for the STMicroelectronics LSM6DS0 accelerometer/gyroscope
+ *
+ * @code
+ * #include "mbed.h"
+ * #include "LSM6DS0.h"
+ *
+ * I2CBus i2c(I2C_SDA, I2C_SCL);
+ * LSM6DS0 imu(i2c);
+ *
+ * int main() {
+ *   LSM6DS0_sample_t samples[LSM6DS0_FIFO_DEPTH];
+ *   imu.init();
+ *   imu.odr(LSM6DS0_ODR_119HZ);
+ *   while(1) {
+ *      wait(0.1);
+ *      int n = imu.get_fifo(samples, LSM6DS0_FIFO_DEPTH);
+ *      printf("%d samples, x %d\r\n", n, samples[0].accel[0]);
+ *   }
+ * }
+ * @endcode
+ */
+class LSM6DS0
+{
+public:
+    /** Attach to a shared I2C bus
+      * @param I2C bus
+      * @param device address, LSM6DS0_G_CHIP_ADDR or LSM6DS0_V_CHIP_ADDR (default)
+      */
+    LSM6DS0(I2CBus& i2c, uint8_t addr = LSM6DS0_V_CHIP_ADDR);
+
+    /** Check the ID and configure 245 dps / 2 g, FIFO in continuous mode, powered down
+      * @param none
+      * @return true if the device answered with the expected WHO_AM_I value
+      */
+    bool init(void);
+
+    /** Set the output data rate of both parts, the FIFO is cleared
+      * @param LSM6DS0_ODR_OFF, LSM6DS0_ODR_15HZ ... LSM6DS0_ODR_952HZ
+      * @return none
+      */
+    void odr(uint8_t rate);
+
+    /** Output data rate in Hz
+      * @param LSM6DS0_ODR_xxx
+      * @return rate, rounded to whole Hz
+      */
+    static uint16_t odr_hz(uint8_t rate);
+
+    /** FIFO status
+      * @param none
+      * @return FIFO_SRC, level in LSM6DS0_FIFO_SRC_FSS, LSM6DS0_FIFO_SRC_OVRN if samples were lost
+      */
+    uint8_t fifo_status(void);
+
+    /** Drain the FIFO with one auto-increment burst read
+      * @param buffer for the samples, oldest first
+      * @param buffer size in samples
+      * @return number of samples read
+      */
+    int get_fifo(LSM6DS0_sample_t *samples, int max);
+
+#if DEVICE_I2C_ASYNCH
+    /** Start a non-blocking burst read of FIFO slots
+      *  Check the level with fifo_status() first. The buffer must stay valid
+      *  until the callback, which runs in interrupt context, has run; convert
+      *  it with decode() on I2C_EVENT_TRANSFER_COMPLETE.
+      * @param buffer of count * LSM6DS0_RAW_SIZE bytes
+      * @param count slots to read, at most LSM6DS0_FIFO_DEPTH
+      * @param callback completion callback
+      * @return 0 if the read was started, -1 if no sensor or the bus refused it
+      */
+    int get_fifo_async(char *raw, int count, const event_callback_t& callback);
+#endif
+
+    /** Convert one FIFO slot
+      * @param LSM6DS0_RAW_SIZE bytes as read from the sensor
+      * @param converted sample
+      * @return none
+      */
+    static void decode(const char *raw, LSM6DS0_sample_t *sample);
+
+    /** Read a ID number
+      * @param none
+      * @return if STM MEMS LSM6DS0, it should be I_AM_LSM6DS0
+      */
+    uint8_t read_id(void);
+
+    /** Health counters of the sensor's I2C traffic
+      * @param none
+      * @return counters, see I2CBus.h
+      */
+    const I2CHealth& health(void);
+
+    /** Read register (general purpose)
+      * @param register's address
+      * @return register data
+      */
+    uint8_t read_reg(uint8_t addr);
+
+    /** Write register (general purpose)
+      * @param register's address
+      * @param data
+      * @return none
+      */
+    void write_reg(uint8_t addr, uint8_t data);
+
+private:
+    I2CDevice _i2c;
+    bool _ready;            // device answered on the bus
+    char _fifo_reg;         // register address for the async burst
+};
+
+#endif // LSM6DS0_H
@@ -0,0 +1,202 @@
+#include "BufferedSerial.h"
+
+#if (BUFFERED_SERIAL_TX_SIZE & (BUFFERED_SERIAL_TX_SIZE - 1)) || (BUFFERED_SERIAL_RX_SIZE & (BUFFERED_SERIAL_RX_SIZE - 1))
+#error "BUFFERED_SERIAL_TX_SIZE and BUFFERED_SERIAL_RX_SIZE must be powers of two"
+#endif
+
+// Most bytes copied into the TX ring per critical section
+#define COPY_CHUNK      64
+
+static inline bool in_isr(void)
+{
+    return __get_IPSR() != 0;
+}
+
+BufferedSerial::BufferedSerial(PinName tx, PinName rx, const char *name, int baud)
+    : SerialBase(tx, rx, baud), Stream(name), _tx_head(0), _tx_tail(0), _tx_sending(0),
+      _rx_head(0), _rx_tail(0), _rx_ready(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _tx_callback = callback(this, &BufferedSerial::tx_done);
+    set_dma_usage_tx(DMA_USAGE_OPPORTUNISTIC);
+    attach(callback(this, &BufferedSerial::rx_irq), RxIrq);
+}
+
+ssize_t BufferedSerial::write(const void *buffer, size_t length)
+{
+    const uint8_t *data = (const uint8_t *)buffer;
+    bool isr = in_isr();
+    bool waited = false;
+    size_t done = 0;
+
+    if (!isr) {
+        lock();
+    }
+    while (done < length) {
+        uint32_t fill, n, at, first;
+
+        core_util_critical_section_enter();
+        fill = _tx_head - _tx_tail;
+        n = BUFFERED_SERIAL_TX_SIZE - fill;
+        if (n > length - done) {
+            n = length - done;
+        }
+        if (n > COPY_CHUNK) {
+            n = COPY_CHUNK;
+        }
+        at = _tx_head & (BUFFERED_SERIAL_TX_SIZE - 1);
+        first = n < BUFFERED_SERIAL_TX_SIZE - at ? n : BUFFERED_SERIAL_TX_SIZE - at;
+        memcpy(&_tx[at], data + done, first);
+        memcpy(_tx, data + done + first, n - first);
+        _tx_head += n;
+        fill += n;
+        if (fill > _stats.tx_high_water) {
+            _stats.tx_high_water = fill;
+        }
+        _stats.tx_bytes += n;
+        if (!_tx_sending) {
+            tx_start();
+        }
+        core_util_critical_section_exit();
+
+        done += n;
+        if (n == 0) {
+            if (isr) {
+                // Cannot wait here, what does not fit is lost
+                _stats.tx_dropped += length - done;
+                done = length;
+                break;
+            }
+            if (!waited) {
+                _stats.tx_waits++;
+                waited = true;
+            }
+            Thread::wait(1);
+        }
+    }
+    if (!isr) {
+        unlock();
+    }
+    return done;
+}
+
+ssize_t BufferedSerial::read(void *buffer, size_t length)
+{
+    uint8_t *data = (uint8_t *)buffer;
+    size_t n = 0;
+
+    // One reader, which must not hold the lock writers need while it waits
+    while (_rx_head == _rx_tail) {
+        _rx_ready.wait();
+    }
+    while (n < length && _rx_tail != _rx_head) {
+        data[n++] = _rx[_rx_tail & (BUFFERED_SERIAL_RX_SIZE - 1)];
+        _rx_tail++;
+    }
+    return n;
+}
+
+int BufferedSerial::sync(void)
+{
+    while (!in_isr() && _tx_head != _tx_tail) {
+        Thread::wait(1);
+    }
+    return 0;
+}
+
+uint32_t BufferedSerial::available(void)
+{
+    return _rx_head - _rx_tail;
+}
+
+const BufferedSerialStats& BufferedSerial::stats(void)
+{
+    return _stats;
+}
+
+void BufferedSerial::clear_stats(void)
+{
+    core_util_critical_section_enter();
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.tx_high_water = _tx_head - _tx_tail;
+    _stats.rx_high_water = _rx_head - _rx_tail;
+    core_util_critical_section_exit();
+}
+
+int BufferedSerial::_putc(int c)
+{
+    uint8_t b = c;
+
+    write(&b, 1);
+    return c;
+}
+
+int BufferedSerial::_getc()
+{
+    uint8_t c = 0;
+
+    read(&c, 1);
+    return c;
+}
+
+void BufferedSerial::lock(void)
+{
+    _mutex.lock();
+}
+
+void BufferedSerial::unlock(void)
+{
+    _mutex.unlock();
+}
+
+// Receive interrupt: move everything the UART holds into the ring
+void BufferedSerial::rx_irq(void)
+{
+    while (serial_readable(&_serial)) {
+        uint8_t c = serial_getc(&_serial);
+        uint32_t fill = _rx_head - _rx_tail;
+
+        if (fill == BUFFERED_SERIAL_RX_SIZE) {
+            _stats.rx_dropped++;
+            continue;
+        }
+        _rx[_rx_head & (BUFFERED_SERIAL_RX_SIZE - 1)] = c;
+        _rx_head++;
+        if (fill + 1 > _stats.rx_high_water) {
+            _stats.rx_high_water = fill + 1;
+        }
+        _stats.rx_bytes++;
+    }
+    _rx_ready.release();
+}
+
+// Send the ring from the tail to its end or to the head, whichever comes
+// first; interrupts are masked or this is the completion interrupt
+void BufferedSerial::tx_start(void)
+{
+    uint32_t at = _tx_tail & (BUFFERED_SERIAL_TX_SIZE - 1);
+    uint32_t n = _tx_head - _tx_tail;
+
+    if (n == 0) {
+        return;
+    }
+    if (n > BUFFERED_SERIAL_TX_SIZE - at) {
+        n = BUFFERED_SERIAL_TX_SIZE - at;
+    }
+    _tx_sending = n;
+    if (SerialBase::write(&_tx[at], n, _tx_callback, SERIAL_EVENT_TX_COMPLETE) != 0) {
+        // A transmit of someone else is running, the next write retries
+        _tx_sending = 0;
+        return;
+    }
+    _stats.tx_transfers++;
+}
+
+void BufferedSerial::tx_done(int event)
+{
+    // Only SERIAL_EVENT_TX_COMPLETE is asked for
+    (void)event;
+    _tx_tail += _tx_sending;
+    _tx_sending = 0;
+    tx_start();
+}
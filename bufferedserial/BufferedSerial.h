@@ -0,0 +1,127 @@
+/*
+ * Interrupt driven, buffered serial port
+ *
+ * Serial busy-waits in serial_putc() on every byte, so printing a history
+ * dump holds the printing thread for the whole transmit time, 87us a byte
+ * at 115200 baud. BufferedSerial copies output into a TX ring and returns.
+ * The ring drains in the background through asynchronous transmits, on
+ * DMA where the target has a stream for the UART, one contiguous stretch
+ * of the ring per transmit, the next started from the completion
+ * interrupt. The receive interrupt fills an RX ring that read() and
+ * getc() take from, sleeping while it is empty.
+ *
+ * A thread writing to a full TX ring waits for room, so console output is
+ * never lost; it is only slowed to the line rate, as before. Output from
+ * interrupt context cannot wait and what does not fit is dropped. Input
+ * arriving with the RX ring full is dropped. stats() counts both, with
+ * the high-water mark of each ring to size them by.
+ * tools/bufferedserial_test.cpp runs the rings on a simulated UART.
+ *
+ * Opened by name it replaces the stdio console:
+ *
+ *   BufferedSerial port(USBTX, USBRX, "console", 115200);
+ *   freopen("/console", "w", stdout);
+ */
+#ifndef BUFFEREDSERIAL_H
+#define BUFFEREDSERIAL_H
+
+#include "mbed.h"
+#include "platform/PlatformMutex.h"
+
+// Ring sizes, powers of two
+#ifndef BUFFERED_SERIAL_TX_SIZE
+#define BUFFERED_SERIAL_TX_SIZE     1024
+#endif
+#ifndef BUFFERED_SERIAL_RX_SIZE
+#define BUFFERED_SERIAL_RX_SIZE     64
+#endif
+
+/** Traffic and loss counters */
+typedef struct {
+    uint32_t tx_bytes;          // queued for transmission
+    uint32_t tx_transfers;      // asynchronous transmits started
+    uint32_t tx_waits;          // writes that had to wait for room
+    uint32_t tx_dropped;        // bytes written from interrupt context with the ring full
+    uint32_t tx_high_water;     // most bytes waiting in the TX ring
+    uint32_t rx_bytes;          // received into the ring
+    uint32_t rx_dropped;        // received with the ring full
+    uint32_t rx_high_water;     // most bytes waiting in the RX ring
+} BufferedSerialStats;
+
+class BufferedSerial : public SerialBase, public Stream
+{
+public:
+    /** Open the port
+      * @param tx transmit pin
+      * @param rx receive pin
+      * @param name to open the port by as "/name", may be NULL
+      * @param baud rate
+      */
+    BufferedSerial(PinName tx, PinName rx, const char *name = NULL,
+                   int baud = MBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE);
+
+    /** Queue bytes for transmission
+      *  Waits for room in the ring when called from a thread.
+      * @param buffer
+      * @param length
+      * @return bytes queued
+      */
+    virtual ssize_t write(const void *buffer, size_t length);
+
+    /** Take received bytes, waiting for the first one
+      * @param buffer
+      * @param length
+      * @return bytes read, at least 1
+      */
+    virtual ssize_t read(void *buffer, size_t length);
+
+    /** Wait until the TX ring has been sent
+      * @param none
+      * @return 0
+      */
+    virtual int sync(void);
+
+    /** Received bytes waiting in the RX ring
+      * @param none
+      * @return count
+      */
+    uint32_t available(void);
+
+    /** Traffic and loss counters
+      * @param none
+      * @return counters since start-up or the last clear_stats()
+      */
+    const BufferedSerialStats& stats(void);
+
+    /** Reset the counters, the high-water marks to the current fill
+      * @param none
+      * @return none
+      */
+    void clear_stats(void);
+
+protected:
+    virtual int _putc(int c);
+    virtual int _getc();
+    virtual void lock(void);
+    virtual void unlock(void);
+
+private:
+    void rx_irq(void);
+    void tx_start(void);
+    void tx_done(int event);
+
+    uint8_t _tx[BUFFERED_SERIAL_TX_SIZE];
+    uint8_t _rx[BUFFERED_SERIAL_RX_SIZE];
+    // Free running counts, the fill is head - tail
+    volatile uint32_t _tx_head;
+    volatile uint32_t _tx_tail;
+    volatile uint32_t _tx_sending;      // bytes in the transmit in flight, 0 if none
+    volatile uint32_t _rx_head;
+    volatile uint32_t _rx_tail;
+    event_callback_t _tx_callback;
+    Semaphore _rx_ready;
+    BufferedSerialStats _stats;
+    PlatformMutex _mutex;
+};
+
+#endif // BUFFEREDSERIAL_H
@@ -0,0 +1,97 @@
+#include <string.h>
+#include "Delta.h"
+
+static const uint8_t code_bytes[4] = { 0, 1, 2, 4 };
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u)
+{
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+// Size code of a zigzagged difference, and the difference stored after the tag
+static inline unsigned put(uint32_t u, uint8_t *out, size_t *n)
+{
+    unsigned code = u == 0 ? 0 : u < 0x100 ? 1 : u < 0x10000 ? 2 : 3;
+
+    for (unsigned i = 0; i < code_bytes[code]; i++) {
+        out[(*n)++] = u >> (8 * i);
+    }
+    return code;
+}
+
+DeltaEncoder::DeltaEncoder()
+{
+    reset();
+}
+
+void DeltaEncoder::reset(void)
+{
+    memset(&_previous, 0, sizeof(_previous));
+    _period = 0;
+}
+
+size_t DeltaEncoder::encode(const DeltaRecord& record, uint8_t *out)
+{
+    uint32_t period = record.time - _previous.time;
+    size_t n = 1;
+    uint8_t tag;
+    int i;
+
+    tag = put(zigzag((int32_t)(period - _period)), out, &n);
+    for (i = 0; i < DELTA_CHANNELS; i++) {
+        tag |= put(zigzag((int32_t)((uint32_t)record.value[i] - (uint32_t)_previous.value[i])), out, &n) << (2 * (i + 1));
+    }
+    out[0] = tag;
+
+    _previous = record;
+    _period = period;
+    return n;
+}
+
+DeltaDecoder::DeltaDecoder()
+{
+    reset();
+}
+
+void DeltaDecoder::reset(void)
+{
+    memset(&_previous, 0, sizeof(_previous));
+    _period = 0;
+}
+
+size_t DeltaDecoder::decode(const uint8_t *in, size_t length, DeltaRecord *record)
+{
+    int32_t diff[1 + DELTA_CHANNELS];
+    size_t n = 1;
+    uint8_t tag;
+    int i;
+
+    if (length == 0) {
+        return 0;
+    }
+    tag = in[0];
+    for (i = 0; i < 1 + DELTA_CHANNELS; i++) {
+        unsigned bytes = code_bytes[(tag >> (2 * i)) & 3];
+        uint32_t u = 0;
+        if (n + bytes > length) {
+            return 0;
+        }
+        for (unsigned b = 0; b < bytes; b++) {
+            u |= (uint32_t)in[n++] << (8 * b);
+        }
+        diff[i] = unzigzag(u);
+    }
+
+    _period += (uint32_t)diff[0];
+    record->time = _previous.time + _period;
+    for (i = 0; i < DELTA_CHANNELS; i++) {
+        record->value[i] = (int32_t)((uint32_t)_previous.value[i] + (uint32_t)diff[i + 1]);
+    }
+    _previous = *record;
+    return n;
+}
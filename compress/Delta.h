@@ -0,0 +1,85 @@
+/*
+ * Streaming delta compression of sensor time series
+ *
+ * Weather data moves slowly, so each record is coded as its difference to
+ * the one before: the time as a delta of deltas, which is zero while the
+ * sampling period holds, and each value as a plain delta. Differences are
+ * zigzag mapped (0, -1, 1, -2, ... to 0, 1, 2, 3, ...) and stored in 0, 1,
+ * 2 or 4 bytes, little-endian, behind a tag byte holding the four 2-bit
+ * size codes:
+ *
+ *   tag bits 0-1 time, 2-3 value[0], 4-5 value[1], 6-7 value[2]
+ *   size code 0: difference is 0, 1: 1 byte, 2: 2 bytes, 3: 4 bytes
+ *
+ * A steady reading takes 1 to 5 bytes instead of the 8 of a packed record.
+ * Encoder and decoder keep one previous record as their only state, so a
+ * stream is coded a record at a time in fixed RAM. A stream starts from
+ * an all-zero record; reset() starts a new one, which is how independently
+ * decodable blocks are made.
+ *
+ * No mbed dependency, so the host tools build the same code;
+ * tools/delta_test.cpp checks the edge cases of the coding.
+ */
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_CHANNELS      3
+#define DELTA_MAX_RECORD    (1 + 4 * (1 + DELTA_CHANNELS))     // bytes
+
+/** One record of the series */
+typedef struct {
+    uint32_t time;                      // ms, may wrap
+    int32_t value[DELTA_CHANNELS];
+} DeltaRecord;
+
+class DeltaEncoder
+{
+public:
+    DeltaEncoder();
+
+    /** Start a new stream
+      * @param none
+      * @return none
+      */
+    void reset(void);
+
+    /** Code one record
+      * @param record
+      * @param output buffer of DELTA_MAX_RECORD bytes
+      * @return bytes written
+      */
+    size_t encode(const DeltaRecord& record, uint8_t *out);
+
+private:
+    DeltaRecord _previous;
+    uint32_t _period;       // previous time delta
+};
+
+class DeltaDecoder
+{
+public:
+    DeltaDecoder();
+
+    /** Start a new stream
+      * @param none
+      * @return none
+      */
+    void reset(void);
+
+    /** Decode one record
+      * @param input
+      * @param bytes available
+      * @param record
+      * @return bytes used, 0 if the input ends inside the record
+      */
+    size_t decode(const uint8_t *in, size_t length, DeltaRecord *record);
+
+private:
+    DeltaRecord _previous;
+    uint32_t _period;
+};
+
+#endif // DELTA_H
@@ -0,0 +1,197 @@
+#include "Derived.h"
+#include "cmsis.h"
+
+// log2(1 + i / 128) in Q30
+static const uint32_t log2_table[129] = {
+    0x00000000, 0x00b7f286, 0x016e7968, 0x02239a3b, 0x02d75a6f, 0x0389bf57,
+    0x043ace28, 0x04ea8bf7, 0x0598fdbf, 0x0646285c, 0x06f21090, 0x079cbb04,
+    0x08462c46, 0x08ee68cc, 0x099574f1, 0x0a3b54fd, 0x0ae00d1d, 0x0b83a16a,
+    0x0c2615e8, 0x0cc76e84, 0x0d67af17, 0x0e06db67, 0x0ea4f726, 0x0f4205f4,
+    0x0fde0b5d, 0x10790adc, 0x111307db, 0x11ac05b3, 0x124407ab, 0x12db10fc,
+    0x137124cf, 0x1406463b, 0x149a784c, 0x152dbdfc, 0x15c01a3a, 0x16518fe4,
+    0x16e221ce, 0x1771d2ba, 0x1800a563, 0x188e9c73, 0x191bba89, 0x19a80239,
+    0x1a33760a, 0x1abe1879, 0x1b47ebf7, 0x1bd0f2ea, 0x1c592fad, 0x1ce0a492,
+    0x1d6753e0, 0x1ded3fd4, 0x1e726aa2, 0x1ef6d673, 0x1f7a8569, 0x1ffd799b,
+    0x207fb517, 0x210139e5, 0x21820a02, 0x22022763, 0x228193f5, 0x2300519f,
+    0x237e623d, 0x23fbc7a6, 0x247883a8, 0x24f4980b, 0x2570068e, 0x25ead0ec,
+    0x2664f8d5, 0x26de7ff7, 0x275767f5, 0x27cfb26f, 0x284760fd, 0x28be7531,
+    0x2934f098, 0x29aad4b6, 0x2a20230e, 0x2a94dd19, 0x2b09044d, 0x2b7c9a19,
+    0x2bef9fe8, 0x2c62171f, 0x2cd4011d, 0x2d455f3d, 0x2db632d5, 0x2e267d36,
+    0x2e963fad, 0x2f057b80, 0x2f7431f2, 0x2fe26443, 0x305013ab, 0x30bd4161,
+    0x3129ee96, 0x31961c77, 0x3201cc2c, 0x326cfedb, 0x32d7b5a5, 0x3341f1a7,
+    0x33abb3fb, 0x3414fdb5, 0x347dcfe7, 0x34e62ba0, 0x354e11eb, 0x35b583ce,
+    0x361c824d, 0x36830e69, 0x36e9291f, 0x374ed367, 0x37b40e3a, 0x3818da89,
+    0x387d3946, 0x38e12b5d, 0x3944b1b9, 0x39a7cd42, 0x3a0a7eda, 0x3a6cc765,
+    0x3acea7c0, 0x3b3020c8, 0x3b913356, 0x3bf1e041, 0x3c52285c, 0x3cb20c79,
+    0x3d118d67, 0x3d70abf2, 0x3dcf68e3, 0x3e2dc504, 0x3e8bc118, 0x3ee95de2,
+    0x3f469c23, 0x3fa37c99, 0x40000000
+};
+
+// 2^(i / 128) in Q30
+static const uint32_t exp2_table[129] = {
+    0x40000000, 0x4058f6a8, 0x40b268fa, 0x410c57a2, 0x4166c34c, 0x41c1aca7,
+    0x421d1462, 0x4278fb2b, 0x42d561b4, 0x433248ae, 0x438fb0cb, 0x43ed9ac0,
+    0x444c0740, 0x44aaf702, 0x450a6abb, 0x456a6323, 0x45cae0f2, 0x462be4e2,
+    0x468d6fae, 0x46ef8210, 0x47521cc6, 0x47b5408c, 0x4818ee22, 0x487d2646,
+    0x48e1e9ba, 0x4947393f, 0x49ad1598, 0x4a137f88, 0x4a7a77d4, 0x4ae1ff43,
+    0x4b4a169c, 0x4bb2bea5, 0x4c1bf829, 0x4c85c3f1, 0x4cf022ca, 0x4d5b157e,
+    0x4dc69cdd, 0x4e32b9b4, 0x4e9f6cd4, 0x4f0cb70c, 0x4f7a9930, 0x4fe91413,
+    0x50582888, 0x50c7d765, 0x51382182, 0x51a907b4, 0x521a8ad7, 0x528cabc3,
+    0x52ff6b55, 0x5372ca68, 0x53e6c9da, 0x545b6a8b, 0x54d0ad5a, 0x55469329,
+    0x55bd1cdb, 0x56344b52, 0x56ac1f75, 0x57249a29, 0x579dbc57, 0x581786e6,
+    0x5891fac1, 0x590d18d3, 0x5988e209, 0x5a055751, 0x5a82799a, 0x5b0049d4,
+    0x5b7ec8f2, 0x5bfdf7e5, 0x5c7dd7a4, 0x5cfe6923, 0x5d7fad59, 0x5e01a53f,
+    0x5e8451d0, 0x5f07b405, 0x5f8bccdb, 0x60109d51, 0x60962665, 0x611c6919,
+    0x61a3666d, 0x622b1f66, 0x62b39509, 0x633cc85b, 0x63c6ba64, 0x64516c2e,
+    0x64dcdec3, 0x6569132f, 0x65f60a7f, 0x6683c5c3, 0x6712460b, 0x67a18c68,
+    0x683199ed, 0x68c26fb1, 0x69540ec9, 0x69e6784d, 0x6a79ad56, 0x6b0daeff,
+    0x6ba27e65, 0x6c381ca6, 0x6cce8ae1, 0x6d65ca38, 0x6dfddbcc, 0x6e96c0c3,
+    0x6f307a41, 0x6fcb096f, 0x70666f76, 0x7102ad80, 0x719fc4b9, 0x723db650,
+    0x72dc8374, 0x737c2d55, 0x741cb528, 0x74be1c20, 0x75606374, 0x76038c5b,
+    0x76a7980f, 0x774c87cc, 0x77f25cce, 0x78991854, 0x7940bb9e, 0x79e947ef,
+    0x7a92be8b, 0x7b3d20b6, 0x7be86fba, 0x7c94acde, 0x7d41d96e, 0x7deff6b6,
+    0x7e9f0606, 0x7f4f08ae, 0x80000000
+};
+
+#define LOG2_1000_Q24       167198116   // log2(1000)
+#define MAGNUS_B_Q24        295614546   // 17.62
+#define MAGNUS_C            24312       // 243.12 degC in 0.01 degC
+#define ISA_EXPONENT_Q24    3192083     // 0.190263
+#define ISA_HEIGHT          443308      // 44330.77 m in 0.1 m, rounded
+#define ISA_HEIGHT_Q8       113486771   // 44330.77 m in 0.1 m, Q8
+
+Derived::Derived()
+    : _temperature(0), _humidity(0), _pressure(0), _sea_level(DERIVED_SEA_LEVEL_RAW),
+      _station_altitude(DERIVED_STATION_ALTITUDE), _valid(0), _dew_point(0), _altitude(0), _qnh(0)
+{
+}
+
+void Derived::humidity_input(int16_t temperature, uint16_t humidity)
+{
+    if (temperature != _temperature || humidity != _humidity) {
+        _temperature = temperature;
+        _humidity = humidity;
+        _valid &= ~DEW_POINT;
+    }
+}
+
+void Derived::pressure_input(uint32_t pressure)
+{
+    if (pressure != _pressure) {
+        _pressure = pressure;
+        _valid &= ~(ALTITUDE | QNH);
+    }
+}
+
+void Derived::sea_level(uint32_t pressure)
+{
+    _sea_level = pressure;
+    _valid &= ~ALTITUDE;
+}
+
+void Derived::station_altitude(int32_t altitude)
+{
+    _station_altitude = altitude;
+    _valid &= ~QNH;
+}
+
+int16_t Derived::dew_point(void)
+{
+    if (!(_valid & DEW_POINT)) {
+        _dew_point = dew_point(_temperature, _humidity);
+        _valid |= DEW_POINT;
+    }
+    return _dew_point;
+}
+
+int32_t Derived::altitude(void)
+{
+    if (!(_valid & ALTITUDE)) {
+        _altitude = altitude(_pressure, _sea_level);
+        _valid |= ALTITUDE;
+    }
+    return _altitude;
+}
+
+uint32_t Derived::qnh(void)
+{
+    if (!(_valid & QNH)) {
+        _qnh = qnh(_pressure, _station_altitude);
+        _valid |= QNH;
+    }
+    return _qnh;
+}
+
+int16_t Derived::dew_point(int16_t temperature, uint16_t humidity)
+{
+    int64_t gamma;
+
+    if (humidity == 0) {
+        humidity = 1;       // ln(0), take the lowest step the sensor reports
+    }
+    // gamma = ln(RH) + b * T / (c + T), kept in log2 units until the end
+    gamma = (int64_t)(log2_q24(humidity, 0) - LOG2_1000_Q24) * 1488522236 >> 31;   // * ln(2)
+    gamma += (int64_t)MAGNUS_B_Q24 * temperature / (MAGNUS_C + temperature);
+    // Td = c * gamma / (b - gamma)
+    return (int16_t)(MAGNUS_C * gamma / (MAGNUS_B_Q24 - gamma));
+}
+
+int32_t Derived::altitude(uint32_t pressure, uint32_t sea_level)
+{
+    int32_t ratio;
+    uint32_t power;
+
+    if (pressure == 0 || sea_level == 0) {
+        return 0;
+    }
+    // (p / p0)^0.190263 = 2^(0.190263 * (log2(p) - log2(p0)))
+    ratio = log2_q24(pressure, 0) - log2_q24(sea_level, 0);
+    power = exp2_q28((int32_t)((int64_t)ratio * ISA_EXPONENT_Q24 >> 24));
+    return (int32_t)(((int64_t)ISA_HEIGHT_Q8 * ((int64_t)(1 << 28) - power) + ((int64_t)1 << 35)) >> 36);
+}
+
+uint32_t Derived::qnh(uint32_t pressure, int32_t altitude)
+{
+    uint32_t base;
+    int32_t exponent;
+
+    // p0 = p * (1 - h / 44330.77)^(-1 / 0.190263)
+    if (altitude >= ISA_HEIGHT) {
+        return 0;
+    }
+    base = (uint32_t)((((int64_t)ISA_HEIGHT_Q8 - ((int64_t)altitude << 8)) << 28) / ISA_HEIGHT_Q8);
+    exponent = (int32_t)(((int64_t)log2_q24(base, 28) << 24) / -ISA_EXPONENT_Q24);
+    return (uint32_t)(((uint64_t)pressure * exp2_q28(exponent) + (1 << 27)) >> 28);
+}
+
+int32_t Derived::log2_q24(uint32_t x, int frac_bits)
+{
+    int n = 31 - __CLZ(x);
+    uint32_t m = x << (31 - n);             // leading one at bit 31
+    uint32_t i = (m >> 24) & 0x7f;          // 7 bit table index
+    uint32_t r = (m >> 8) & 0xffff;         // interpolation weight, Q16
+    uint32_t f = log2_table[i] + (uint32_t)(((uint64_t)(log2_table[i + 1] - log2_table[i]) * r) >> 16);
+
+    return ((n - frac_bits) << 24) + (int32_t)((f + 32) >> 6);
+}
+
+uint32_t Derived::exp2_q28(int32_t y)
+{
+    int k = y >> 24;                        // floor, arithmetic shift
+    uint32_t f = (uint32_t)y & 0xffffff;
+    uint32_t i = f >> 17;
+    uint32_t r = (f >> 1) & 0xffff;
+    uint32_t m = exp2_table[i] + (uint32_t)(((uint64_t)(exp2_table[i + 1] - exp2_table[i]) * r) >> 16);
+
+    // m is in [1, 2) in Q30, scale by 2^k into Q28
+    if (k >= 4) {
+        return 0xffffffff;
+    }
+    if (k >= 2) {
+        return m << (k - 2);
+    }
+    if (k < -29) {
+        return 0;
+    }
+    return m >> (2 - k);
+}
@@ -0,0 +1,135 @@
+/*
+ * Derived quantities in fixed point
+ *
+ * Dew point (Magnus formula, b = 17.62, c = 243.12 degC), barometric
+ * altitude and sea-level pressure (QNH) from the international standard
+ * atmosphere, h = 44330.77 m * (1 - (p / p0)^0.190263). The logarithms
+ * and powers go through log2/exp2 tables of 129 entries with linear
+ * interpolation, so no libm call or float operation is involved.
+ *
+ * Worst case error against a double precision evaluation of the same
+ * formulas, measured over the whole input ranges given by
+ * tools/derived_bench.cpp, which fails when a bound is exceeded:
+ *   dew point      0.02 degC    -40..120 degC, 0.1..100 %RH
+ *   altitude       0.25 m       300..1100 hPa against 1013.25 hPa
+ *   QNH            0.05 hPa     300..1100 hPa, station at -500..5000 m
+ *
+ * The speed against libm is measured on the device by the 'bench' shell
+ * command: DWT->CYCCNT cycles per sample of all three quantities, fixed
+ * point against logf/powf, over the same inputs as the host bench.
+ *
+ * Derived only keeps the latest inputs. Each quantity is computed the
+ * first time it is asked for after an input changed, so nothing is spent
+ * on samples no consumer looks at. It is not locked, the caller shares it
+ * under its own lock.
+ */
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include <stdint.h>
+
+#define DERIVED_SEA_LEVEL_RAW       4150272     // 1013.25 hPa in 1/4096 hPa
+#define DERIVED_STATION_ALTITUDE    0           // 0.1 m
+
+class Derived
+{
+public:
+    Derived();
+
+    /** New HTS221 reading
+      * @param temperature in 0.01 degC
+      * @param relative humidity in 0.1 %
+      * @return none
+      */
+    void humidity_input(int16_t temperature, uint16_t humidity);
+
+    /** New LPS25H reading
+      * @param pressure in 1/4096 hPa
+      * @return none
+      */
+    void pressure_input(uint32_t pressure);
+
+    /** Reference pressure for altitude()
+      * @param pressure at 0 m in 1/4096 hPa, DERIVED_SEA_LEVEL_RAW by default
+      * @return none
+      */
+    void sea_level(uint32_t pressure);
+
+    /** Height of the sensor for qnh()
+      * @param altitude in 0.1 m, DERIVED_STATION_ALTITUDE by default
+      * @return none
+      */
+    void station_altitude(int32_t altitude);
+
+    /** Dew point
+      * @param none
+      * @return dew point in 0.01 degC
+      */
+    int16_t dew_point(void);
+
+    /** Barometric altitude
+      * @param none
+      * @return altitude in 0.1 m
+      */
+    int32_t altitude(void);
+
+    /** Pressure reduced to sea level
+      * @param none
+      * @return QNH in 1/4096 hPa
+      */
+    uint32_t qnh(void);
+
+    /** Dew point, without caching
+      * @param temperature in 0.01 degC
+      * @param relative humidity in 0.1 %
+      * @return dew point in 0.01 degC
+      */
+    static int16_t dew_point(int16_t temperature, uint16_t humidity);
+
+    /** Barometric altitude, without caching
+      * @param pressure in 1/4096 hPa
+      * @param pressure at 0 m in 1/4096 hPa
+      * @return altitude in 0.1 m
+      */
+    static int32_t altitude(uint32_t pressure, uint32_t sea_level);
+
+    /** Pressure reduced to sea level, without caching
+      * @param pressure in 1/4096 hPa
+      * @param altitude of the sensor in 0.1 m
+      * @return QNH in 1/4096 hPa
+      */
+    static uint32_t qnh(uint32_t pressure, int32_t altitude);
+
+    /** log2 in fixed point
+      * @param x with frac_bits fractional bits, > 0
+      * @param frac_bits
+      * @return log2(x) in Q24
+      */
+    static int32_t log2_q24(uint32_t x, int frac_bits);
+
+    /** exp2 in fixed point
+      * @param y in Q24, below 4
+      * @return 2^y in Q28
+      */
+    static uint32_t exp2_q28(int32_t y);
+
+private:
+    enum {
+        DEW_POINT = 1,
+        ALTITUDE = 2,
+        QNH = 4
+    };
+
+    int16_t _temperature;
+    uint16_t _humidity;
+    uint32_t _pressure;
+    uint32_t _sea_level;
+    int32_t _station_altitude;
+
+    uint8_t _valid;         // cached results still matching the inputs
+    int16_t _dew_point;
+    int32_t _altitude;
+    uint32_t _qnh;
+};
+
+#endif // DERIVED_H
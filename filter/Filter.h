@@ -0,0 +1,282 @@
+/*
+ * Fixed-point filter stages
+ *
+ * Each stage takes one integer sample at a time through
+ *
+ *     bool put(T in, T& out);
+ *
+ * which returns true when an output sample is available. Only decimating
+ * stages ever return false. Window sizes, shifts and rates are template
+ * parameters, so the loops are bounded at compile time, power-of-two
+ * divisions become shifts and the stages inline into the caller.
+ * Chain<> composes stages into a per-channel pipeline:
+ *
+ *     Chain<Median<int32_t, 3>, Ema<int32_t, 2> > temperature;
+ *
+ * Accumulators default to 32 bits. The caller must make sure the input
+ * range times the stage gain (N for Boxcar, 2^SHIFT for Ema, R^M for Cic)
+ * fits.
+ *
+ * The stages have no mbed dependency; tools/filter_test.cpp tests and
+ * times them on the host.
+ */
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+// Compile time check, there is no static_assert in C++03
+#define FILTER_CHECK(cond, name)    typedef char name[(cond) ? 1 : -1]
+
+// B^E at compile time
+template <int B, int E>
+struct FilterPower {
+    enum { value = B * FilterPower<B, E - 1>::value };
+};
+template <int B>
+struct FilterPower<B, 0> {
+    enum { value = 1 };
+};
+
+/** Pass samples through unchanged */
+template <typename T>
+class Pass
+{
+public:
+    typedef T value_type;
+
+    bool put(T in, T& out)
+    {
+        out = in;
+        return true;
+    }
+
+    void reset(void)
+    {
+    }
+};
+
+/** Moving average over the last N samples
+  *  Until N samples have arrived the average is over those seen so far.
+  */
+template <typename T, int N, typename A = int32_t>
+class Boxcar
+{
+    FILTER_CHECK(N > 0, boxcar_window_must_be_positive);
+
+public:
+    typedef T value_type;
+
+    Boxcar()
+    {
+        reset();
+    }
+
+    bool put(T in, T& out)
+    {
+        _sum += (A)in - (A)_window[_index];
+        _window[_index] = in;
+        if (++_index == N) {
+            _index = 0;
+        }
+        if (_count < N) {
+            _count++;
+            out = (T)(_sum / _count);
+        } else {
+            out = (T)(_sum / N);
+        }
+        return true;
+    }
+
+    void reset(void)
+    {
+        for (int i = 0; i < N; i++) {
+            _window[i] = 0;
+        }
+        _sum = 0;
+        _index = 0;
+        _count = 0;
+    }
+
+private:
+    T _window[N];
+    A _sum;
+    int _index;
+    int _count;
+};
+
+/** Exponential moving average, y += (x - y) / 2^SHIFT
+  *  The state keeps SHIFT fractional bits so small steps are not lost.
+  *  The first sample initialises the state.
+  */
+template <typename T, int SHIFT, typename A = int32_t>
+class Ema
+{
+    FILTER_CHECK(SHIFT > 0 && SHIFT < 16, ema_shift_out_of_range);
+
+public:
+    typedef T value_type;
+
+    Ema()
+    {
+        reset();
+    }
+
+    bool put(T in, T& out)
+    {
+        if (_empty) {
+            _acc = (A)in << SHIFT;
+            _empty = false;
+        } else {
+            _acc += (A)in - ((_acc + ((A)1 << (SHIFT - 1))) >> SHIFT);
+        }
+        out = (T)((_acc + ((A)1 << (SHIFT - 1))) >> SHIFT);
+        return true;
+    }
+
+    void reset(void)
+    {
+        _acc = 0;
+        _empty = true;
+    }
+
+private:
+    A _acc;
+    bool _empty;
+};
+
+/** Median of the last N samples, N odd
+  *  Rejects single-sample spikes such as a corrupted read.
+  */
+template <typename T, int N>
+class Median
+{
+    FILTER_CHECK(N > 0 && (N & 1), median_window_must_be_odd);
+
+public:
+    typedef T value_type;
+
+    Median()
+    {
+        reset();
+    }
+
+    bool put(T in, T& out)
+    {
+        T sorted[N];
+        int i, j, count;
+
+        _window[_index] = in;
+        if (++_index == N) {
+            _index = 0;
+        }
+        if (_count < N) {
+            _count++;
+        }
+        // Local copy bounded to 1..N, so the compiler sees sorted[count / 2]
+        // written by the sort (no -Wmaybe-uninitialized at -O2)
+        count = _count > 0 ? _count : 1;
+        // Insertion sort, N is small
+        for (i = 0; i < count; i++) {
+            T v = _window[i];
+            for (j = i; j > 0 && sorted[j - 1] > v; j--) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = v;
+        }
+        out = sorted[count / 2];
+        return true;
+    }
+
+    void reset(void)
+    {
+        _index = 0;
+        _count = 0;
+    }
+
+private:
+    T _window[N];
+    int _index;
+    int _count;
+};
+
+/** CIC decimator: M integrator and comb stages, decimation by R
+  *  Outputs one sample for every R inputs, scaled back to unity gain. The
+  *  integrators are allowed to wrap, which the combs undo, so they run in
+  *  unsigned arithmetic where wrapping is defined.
+  */
+template <typename T, int R, int M, typename A = int32_t>
+class Cic
+{
+    FILTER_CHECK(R > 1 && M > 0 && M <= 4, cic_parameters_out_of_range);
+
+public:
+    typedef T value_type;
+
+    Cic()
+    {
+        reset();
+    }
+
+    bool put(T in, T& out)
+    {
+        uint32_t v = (uint32_t)(A)in;
+        int i;
+
+        for (i = 0; i < M; i++) {
+            _integrator[i] += v;
+            v = _integrator[i];
+        }
+        if (++_phase < R) {
+            return false;
+        }
+        _phase = 0;
+        for (i = 0; i < M; i++) {
+            uint32_t d = v - _comb[i];
+            _comb[i] = v;
+            v = d;
+        }
+        out = (T)((A)(int32_t)v / (A)FilterPower<R, M>::value);
+        return true;
+    }
+
+    void reset(void)
+    {
+        for (int i = 0; i < M; i++) {
+            _integrator[i] = 0;
+            _comb[i] = 0;
+        }
+        _phase = 0;
+    }
+
+private:
+    uint32_t _integrator[M];
+    uint32_t _comb[M];
+    int _phase;
+};
+
+/** Two stages in series, nest for longer pipelines */
+template <typename First, typename Second>
+class Chain
+{
+public:
+    typedef typename First::value_type value_type;
+
+    bool put(value_type in, value_type& out)
+    {
+        value_type mid;
+        return _first.put(in, mid) && _second.put(mid, out);
+    }
+
+    void reset(void)
+    {
+        _first.reset();
+        _second.reset();
+    }
+
+private:
+    First _first;
+    Second _second;
+};
+
+#endif // FILTER_H
@@ -0,0 +1,27 @@
+#include "SampleFilter.h"
+
+bool SampleFilter::apply(Sample& sample)
+{
+    int32_t temperature, value;
+    bool ready;
+
+    if (sample.source == SAMPLE_HTS221) {
+        ready = _hts221_temperature.put(sample.temperature, temperature);
+        ready &= _hts221_humidity.put(sample.humidity, value);
+        sample.humidity = (uint16_t)value;
+    } else {
+        ready = _lps25h_temperature.put(sample.temperature, temperature);
+        ready &= _lps25h_pressure.put((int32_t)sample.pressure, value);
+        sample.pressure = (uint32_t)value;
+    }
+    sample.temperature = (int16_t)temperature;
+    return ready;
+}
+
+void SampleFilter::reset(void)
+{
+    _hts221_temperature.reset();
+    _hts221_humidity.reset();
+    _lps25h_pressure.reset();
+    _lps25h_temperature.reset();
+}
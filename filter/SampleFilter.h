@@ -0,0 +1,44 @@
+/*
+ * Per-channel filtering of the sensor samples
+ *
+ * One pipeline per channel, built from the stages in Filter.h. The
+ * pipelines are fixed here at compile time; swap the typedefs to change
+ * them. Both channels of a sensor must decimate by the same factor since
+ * they share a Sample.
+ */
+#ifndef SAMPLEFILTER_H
+#define SAMPLEFILTER_H
+
+#include "Filter.h"
+#include "Sample.h"
+
+// HTS221: drop single bad reads, then smooth
+typedef Chain<Median<int32_t, 3>, Ema<int32_t, 2> > HTS221TemperatureFilter;
+typedef Chain<Median<int32_t, 3>, Ema<int32_t, 2> > HTS221HumidityFilter;
+// LPS25H: pressure (24 bit raw) averaged over 4, temperature only smoothed
+typedef Chain<Median<int32_t, 3>, Boxcar<int32_t, 4> > LPS25HPressureFilter;
+typedef Ema<int32_t, 2> LPS25HTemperatureFilter;
+
+class SampleFilter
+{
+public:
+    /** Run a sample through the pipelines of its sensor
+      * @param sample, replaced by the filtered values
+      * @return false if a decimating stage produced no output for this sample
+      */
+    bool apply(Sample& sample);
+
+    /** Clear the filter state, e.g. after a rate change
+      * @param none
+      * @return none
+      */
+    void reset(void);
+
+private:
+    HTS221TemperatureFilter _hts221_temperature;
+    HTS221HumidityFilter _hts221_humidity;
+    LPS25HPressureFilter _lps25h_pressure;
+    LPS25HTemperatureFilter _lps25h_temperature;
+};
+
+#endif // SAMPLEFILTER_H
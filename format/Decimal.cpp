@@ -0,0 +1,101 @@
+#include "Decimal.h"
+
+int Decimal::format(char *buffer, int32_t value, int decimals, int width)
+{
+    if (value < 0) {
+        return format(buffer, (uint32_t)0 - (uint32_t)value, true, decimals, width);
+    }
+    return format(buffer, (uint32_t)value, false, decimals, width);
+}
+
+int Decimal::format_unsigned(char *buffer, uint32_t value, int decimals, int width)
+{
+    return format(buffer, value, false, decimals, width);
+}
+
+int Decimal::format(char *buffer, uint32_t magnitude, bool negative, int decimals, int width)
+{
+    char digits[DECIMAL_MAX_LENGTH];
+    int n = 0;
+    int length, i;
+
+    if (decimals < 0) {
+        decimals = 0;
+    }
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    if (width > DECIMAL_MAX_LENGTH - 1) {
+        width = DECIMAL_MAX_LENGTH - 1;
+    }
+    // Least significant digit first, at least one digit before the point
+    do {
+        if (n == decimals && decimals > 0) {
+            digits[n++] = '.';
+        }
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0 || n <= decimals);
+    if (negative) {
+        digits[n++] = '-';
+    }
+
+    length = n < width ? width : n;
+    for (i = 0; i < length - n; i++) {
+        buffer[i] = ' ';
+    }
+    while (n > 0) {
+        buffer[i++] = digits[--n];
+    }
+    buffer[i] = '\0';
+    return length;
+}
+
+bool Decimal::parse_unsigned(const char *text, int decimals, uint32_t *value)
+{
+    uint32_t v = 0;
+    int fraction = -1;      // digits seen after the point, -1 before it
+    bool digits = false;
+
+    for (; *text; text++) {
+        if (*text == '.' && fraction < 0) {
+            fraction = 0;
+            continue;
+        }
+        if (*text < '0' || *text > '9' || fraction == decimals) {
+            return false;
+        }
+        if (v > (0xffffffffU - (*text - '0')) / 10) {
+            return false;
+        }
+        v = v * 10 + (*text - '0');
+        digits = true;
+        if (fraction >= 0) {
+            fraction++;
+        }
+    }
+    if (!digits) {
+        return false;
+    }
+    for (fraction = fraction < 0 ? 0 : fraction; fraction < decimals; fraction++) {
+        if (v > 0xffffffffU / 10) {
+            return false;
+        }
+        v *= 10;
+    }
+    *value = v;
+    return true;
+}
+
+bool Decimal::parse(const char *text, int decimals, int32_t *value)
+{
+    bool negative = *text == '-';
+    uint32_t magnitude;
+
+    if (!parse_unsigned(negative ? text + 1 : text, decimals, &magnitude) ||
+        magnitude > (negative ? 0x80000000U : 0x7fffffffU)) {
+        return false;
+    }
+    *value = negative ? (int32_t)(0U - magnitude) : (int32_t)magnitude;
+    return true;
+}
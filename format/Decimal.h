@@ -0,0 +1,60 @@
+/*
+ * Fixed-point decimal formatting
+ *
+ * Prints integers held in units of 10^-decimals (0.01 degC, 0.1 %RH, ...)
+ * with the decimal point put back, so the console output needs no float
+ * conversion and no %f, which keeps the floating point printf out of the
+ * image. parse() and parse_unsigned() read them back, for console
+ * arguments.
+ */
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <stdint.h>
+
+// Longest result: sign, 10 digits, point, leading zero and the NUL
+#define DECIMAL_MAX_LENGTH      16
+
+class Decimal
+{
+public:
+    /** Format a signed fixed-point value
+      * @param buffer of DECIMAL_MAX_LENGTH bytes
+      * @param value in units of 10^-decimals
+      * @param decimals digits after the point, 0 to 9
+      * @param width minimum width, padded with spaces on the left
+      * @return length without the terminating NUL
+      */
+    static int format(char *buffer, int32_t value, int decimals, int width = 0);
+
+    /** Format an unsigned fixed-point value
+      * @param buffer of DECIMAL_MAX_LENGTH bytes
+      * @param value in units of 10^-decimals
+      * @param decimals digits after the point, 0 to 9
+      * @param width minimum width, padded with spaces on the left
+      * @return length without the terminating NUL
+      */
+    static int format_unsigned(char *buffer, uint32_t value, int decimals, int width = 0);
+
+    /** Parse an unsigned decimal number into fixed point
+      *  Missing fraction digits count as zeros, extra ones are an error.
+      * @param text, digits with an optional point, nothing else
+      * @param decimals digits kept after the point, 0 to 9
+      * @param value in units of 10^-decimals
+      * @return false if the text is not a number or the value overflows
+      */
+    static bool parse_unsigned(const char *text, int decimals, uint32_t *value);
+
+    /** Parse a signed decimal number into fixed point, see parse_unsigned()
+      * @param text, with an optional leading '-'
+      * @param decimals digits kept after the point, 0 to 9
+      * @param value in units of 10^-decimals
+      * @return false if the text is not a number or the value overflows
+      */
+    static bool parse(const char *text, int decimals, int32_t *value);
+
+private:
+    static int format(char *buffer, uint32_t magnitude, bool negative, int decimals, int width);
+};
+
+#endif // DECIMAL_H
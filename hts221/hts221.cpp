@@ -13,151 +13,222 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include <mbed.h>
 #include "hts221.h"
 
-I2C i2c(I2C_SDA, I2C_SCL);    //SDA, SCL
-
-
 /*lint ++flb "Enter library region" */
 
-// Gill
+static const char expected_who_am_i = 0xBCU; //!< Expected value to get from WHO_AM_I register.
 
+HTS221::HTS221(I2CBus& p_i2c) : _i2c(p_i2c, HTS221_WriteADDE)
+{
+    _t_slope = _t_offset = 0;
+    _h_slope = _h_offset = 0;
+    _temp = 0;
+    _humi = 0;
+#if DEVICE_I2C_ASYNCH
+    _async_reg = HTS221_TempHumi_OUT | 0x80;
+    _async_busy = false;
+#endif
+}
 
-//
+HTS221::HTS221(I2CBus& p_i2c, uint8_t addr) : _i2c(p_i2c, addr)
+{
+    _t_slope = _t_offset = 0;
+    _h_slope = _h_offset = 0;
+    _temp = 0;
+    _humi = 0;
+#if DEVICE_I2C_ASYNCH
+    _async_reg = HTS221_TempHumi_OUT | 0x80;
+    _async_busy = false;
+#endif
+}
 
-static const char expected_who_am_i = 0xBCU; //!< Expected value to get from WHO_AM_I register.
+bool HTS221::init(void)
+{   
+    bool transfer_succeeded = true;
+
+    _i2c.lock();
+    transfer_succeeded &= register_write(0x10 , TRes_4 << 3 | HRes_5) == 0;
+    transfer_succeeded &= register_write(0x20 , PD_On | BDU_On  | ODR_1Hz) == 0; // Control register 1
+    transfer_succeeded &= register_write(0x21 , NoBoot | HeaterOff  | No_OS) == 0; // Control register 2
+    transfer_succeeded &= register_write(0x22 , DRDY_H | PP_OD_PP | DRDY_NON) == 0; // Control register 3
+    _i2c.unlock();
+                                
+    // Read and verify product ID
+    transfer_succeeded &= verify_product_id();
 
-uint8_t H0_rH_x2; 
-uint8_t H1_rH_x2;
-uint16_t T0_degC_x8;
-uint16_t T1_degC_x8;
+    return transfer_succeeded;
+}
 
-int16_t H0_T0_OUT;
-int16_t H1_T0_OUT;
-int16_t T0_OUT;
-int16_t T1_OUT;
+void HTS221::odr(uint8_t rate)
+{
+    register_write(0x20 , PD_On | BDU_On | rate); // Control register 1
+}
 
-float T0_DegC_cal;
-float T1_DegC_cal;
-float H0_RH_cal;
-float H1_RH_cal;
+void HTS221::one_shot(void)
+{
+    register_write(0x21 , NoBoot | HeaterOff | New_OS); // Control register 2, cleared by the sensor when done
+}
 
-bool hts221_init(void)
-{   
-  bool transfer_succeeded = true;
+bool HTS221::data_ready(void)
+{
+    char status;
+    if (register_read(HTS221_STATUS, &status, 1) != 0) return false;
+    return (status & (H_DA_On | T_DA_On)) == (H_DA_On | T_DA_On);
+}
 
-  i2c.frequency(400000);
-    hts221_register_write(0x10 , TRes_4 << 3 | HRes_5); 
-    hts221_register_write(0x20 , PD_On | BDU_On  | ODR_1Hz); // Control register 1
-    hts221_register_write(0x21 , NoBoot | HeaterOff  | No_OS); // Control register 2
-    hts221_register_write(0x22 , DRDY_H | PP_OD_PP | DRDY_NON); // Control register 3
-                                
-  // Read and verify product ID
-  transfer_succeeded &= hts221_verify_product_id();
+void HTS221::drdy_enable(bool enable)
+{
+    register_write(0x22 , DRDY_H | PP_OD_PP | (enable ? DRDY_EN : DRDY_NON)); // Control register 3
+}
 
-  return transfer_succeeded;
+bool HTS221::verify_product_id(void)
+{
+    return _i2c.check_id(ADDRESS_WHO_AM_I, expected_who_am_i);
 }
 
-bool hts221_verify_product_id(void)
+const I2CHealth& HTS221::health(void)
 {
-    char who_am_i[1];
-    hts221_register_read(ADDRESS_WHO_AM_I, &who_am_i[0], 1);
-    if (who_am_i[0] != expected_who_am_i) return false;
-    else return true;
+    return _i2c.health();
 }
 
-void hts221_register_write(uint8_t register_address, uint8_t value)
+int HTS221::register_write(uint8_t register_address, uint8_t value)
 {   
     char w2_data[2];
     
     w2_data[0] = register_address;
     w2_data[1] = value;
-    i2c.write(HTS221_WriteADDE, w2_data, 2);      
-
-}
-
-void hts221_register_read(char register_address, char *destination, uint8_t number_of_bytes)
-{
-  i2c.write(HTS221_WriteADDE, &register_address, 1, 1);
-  i2c.read(HTS221_WriteADDE, destination, number_of_bytes);   //Note by Tsungta, API may have a bug
-  
-  //runaboud read function added by Tsungta
-/*  if (number_of_bytes == 1) {
-      i2c.write(HTS221_WriteADDE, &register_address, 1, 1);
-      i2c.write(HTS221_ReadADDE);
-      *destination = i2c.read(0);
-      i2c.stop();
-  } else {
-      register_address |= 0x80;
-      i2c.write(HTS221_WriteADDE, &register_address, 1, 1);
-      i2c.write(HTS221_ReadADDE);
-      while (number_of_bytes-- > 0)
-        *destination++ = i2c.read(0);
-      i2c.stop();      
-  }*/    
+    return _i2c.write(w2_data, 2);      
+}
+
+int HTS221::register_read(char register_address, char *destination, uint8_t number_of_bytes)
+{
+    return _i2c.write_read(&register_address, 1, destination, number_of_bytes);
 }
                
-void HTS221_Calib(void) 
+bool HTS221::calib(void) 
 {
     char cal_data[16];
+    const uint8_t *cal = (const uint8_t *)cal_data;
+    
+    if (register_read(HTS221_CALIB | 0x80, cal_data, 16) != 0) return false;
+
+    int32_t H0_rH_x2 = cal[0]; 
+    int32_t H1_rH_x2 = cal[1];
+    int32_t T0_degC_x8 = ((cal[5] & 0x03) << 8) + cal[2]; //MSB + LSB in 
+    int32_t T1_degC_x8 = ((cal[5] & 0x0C) << 6) + cal[3]; // MSB
+
+    int32_t H0_T0_OUT = (int16_t)((cal[7] << 8) | cal[6]);  
+    int32_t H1_T0_OUT = (int16_t)((cal[11] << 8) | cal[10]);
+    int32_t T0_OUT = (int16_t)((cal[13] << 8) | cal[12]);
+    int32_t T1_OUT = (int16_t)((cal[15] << 8) | cal[14]);
+
+    // Straight line through the two calibration points, in Q16:
+    // temperature in 0.01 degC (x8 -> x100 is 25/2), humidity in 0.1 %RH (x2 -> x10 is 5)
+    int64_t t0 = (int64_t)T0_degC_x8 * 25 * 65536 / 2;
+    int64_t t1 = (int64_t)T1_degC_x8 * 25 * 65536 / 2;
+    int64_t h0 = (int64_t)H0_rH_x2 * 5 * 65536;
+    int64_t h1 = (int64_t)H1_rH_x2 * 5 * 65536;
+
+    if (T1_OUT != T0_OUT) {
+        _t_slope = (int32_t)((t1 - t0) / (T1_OUT - T0_OUT));
+    } else {
+        _t_slope = 0;       // device missing or not calibrated
+    }
+    _t_offset = t0 - (int64_t)_t_slope * T0_OUT;
+
+    if (H1_T0_OUT != H0_T0_OUT) {
+        _h_slope = (int32_t)((h1 - h0) / (H1_T0_OUT - H0_T0_OUT));
+    } else {
+        _h_slope = 0;
+    }
+    _h_offset = h0 - (int64_t)_h_slope * H0_T0_OUT;
+    return true;
+}
     
-    hts221_register_read(0xB0, cal_data, 16);
+bool HTS221::get(void)
+{
+    char sensor_data[4];
 
-  H0_rH_x2 = cal_data[0]; 
-  H1_rH_x2 = cal_data[1];
-  T0_degC_x8 = ((cal_data[5] & 0x03) << 8) + cal_data[2]; //MSB + LSB in 
-  T1_degC_x8 = ((cal_data[5] & 0x0C) << 6) + cal_data[3]; // MSB
+    if (register_read(HTS221_TempHumi_OUT | 0x80, sensor_data, 4) != 0) return false;
+    convert(sensor_data);
+    return true;
+}
 
-  H0_T0_OUT = (cal_data[7] << 8) + cal_data[6];  
-  H1_T0_OUT = (cal_data[11] << 8) + cal_data[10];
-  T0_OUT = (cal_data[13] << 8) + cal_data[12];
-  T1_OUT = (cal_data[15] << 8) + cal_data[14];
-    
-    // convert negative 2's complement values to native negative value
-    if (H0_T0_OUT&0x8000) H0_T0_OUT = -(0x8000-(0x7fff&H0_T0_OUT));
-    if (H1_T0_OUT&0x8000) H1_T0_OUT = -(0x8000-(0x7fff&H1_T0_OUT));       //((~H1_T0_OUT)+1);//
-    if (T0_OUT&0x8000) T0_OUT = -(0x8000-(0x7fff&T0_OUT));
-    if (T1_OUT&0x8000) T1_OUT = -(0x8000-(0x7fff&T1_OUT));
-    
-  T0_DegC_cal = (float) T0_degC_x8/8;
-  T1_DegC_cal = (float) T1_degC_x8/8;
-  H0_RH_cal = (float) H0_rH_x2/2;
-  H1_RH_cal = (float) H1_rH_x2/2;
+float HTS221::temperature(void)
+{
+    return (float)_temp / 100;
+}
 
+float HTS221::humidity(void)
+{
+    return (float)_humi / 10;
 }
-    
-void HTS221_ReadTempHumi( float *pTemp , float *pHumi)
+
+int16_t HTS221::temperature_x100(void)
 {
-  char sensor_data[4];
-  int16_t H_OUT;
-  int16_t T_OUT;   
+    return _temp;
+}
 
-    hts221_register_read(0xA8, sensor_data, 4);
-    
-    H_OUT = (sensor_data[1] << 8) + sensor_data[0];
-    T_OUT = (sensor_data[3] << 8) + sensor_data[2];
-    
-    // convert negative 2's complement values to native negative value  
-    if (H_OUT&0x8000) H_OUT = -(0x8000-(0x7fff&H_OUT));   //((~H_OUT)+1);;
-    if (T_OUT&0x8000) T_OUT = -(0x8000-(0x7fff&T_OUT));
-    
-    *pTemp = linear_interpolation(T0_OUT, T0_DegC_cal, T1_OUT, T1_DegC_cal, T_OUT);
-    *pHumi = linear_interpolation(H0_T0_OUT, H0_RH_cal, H1_T0_OUT, H1_RH_cal, H_OUT);
-    // Constraint  for measurement after calibration 
-    if ((int)*pHumi>MaxHumi-1 | (int)*pHumi==-72) *pHumi = MaxHumi;  
-    if ((int)*pHumi<MinHumi ) *pHumi = MinHumi;
-    if ((int)*pTemp>MaxTemp-1) *pHumi = MaxTemp; 
-    if ((int)*pHumi<MinTemp ) *pHumi = MinTemp ;  
+uint16_t HTS221::humidity_x10(void)
+{
+    return _humi;
 }
 
-float linear_interpolation(int16_t x0, float y0, int16_t x1, float y1, float mes)
+void HTS221::convert(const char *sensor_data)
 {
-   float a = (float) ((y1 - y0) / (x1 - x0));
-   float b = (float) -a*x0 + y0;
-   float cal = (float) a * mes + b;
-   return cal;
+    const uint8_t *d = (const uint8_t *)sensor_data;
+    int16_t H_OUT = (int16_t)((d[1] << 8) | d[0]);
+    int16_t T_OUT = (int16_t)((d[3] << 8) | d[2]);
+
+    int32_t t = (int32_t)(((int64_t)_t_slope * T_OUT + _t_offset + 0x8000) >> 16);
+    int32_t h = (int32_t)(((int64_t)_h_slope * H_OUT + _h_offset + 0x8000) >> 16);
+
+    // Constraint for measurement after calibration
+    if (t > MaxTemp * 100) t = MaxTemp * 100;
+    if (t < MinTemp * 100) t = MinTemp * 100;
+    if (h > MaxHumi * 10) h = MaxHumi * 10;
+    if (h < MinHumi * 10) h = MinHumi * 10;
+
+    _temp = (int16_t)t;
+    _humi = (uint16_t)h;
 }
 
-/*lint --flb "Leave library region" */
+#if DEVICE_I2C_ASYNCH
+int HTS221::get_async(Callback<void(int, int16_t, uint16_t)> callback)
+{
+    if (_async_busy) return -1;
+    _async_busy = true;
+    _async_callback = callback;
+
+    // Register address write, repeated start and 4 byte read chained in one transfer
+    if (_i2c.transfer(&_async_reg, 1, _async_data, 4,
+                      event_callback_t(this, &HTS221::async_done), I2C_EVENT_ALL, false) != 0) {
+        _async_busy = false;
+        return -1;
+    }
+    return 0;
+}
 
+bool HTS221::busy(void)
+{
+    return _async_busy;
+}
+
+void HTS221::async_done(int event)
+{
+    if (event == I2C_EVENT_TRANSFER_COMPLETE) {
+        convert(_async_data);
+    }
+    _async_busy = false;
+    if (_async_callback) {
+        if (event == I2C_EVENT_TRANSFER_COMPLETE) {
+            _async_callback.call(event, _temp, _humi);
+        } else {
+            _async_callback.call(event, 0, 0);
+        }
+    }
+}
+#endif
+
+/*lint --flb "Leave library region" */
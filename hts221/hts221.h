@@ -18,12 +18,16 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "mbed.h"
+#include "I2CBus.h"
+
 #define ADDRESS_WHO_AM_I (0x0FU) //!< WHO_AM_I register identifies the device. Expected value is 0xBC.
 
 #define HTS221_WriteADDE         0xBE
 #define HTS221_ReadADDE          0xBF
 #define HTS221_TempHumi_OUT      0x28
 #define HTS221_CALIB             0x30
+#define HTS221_STATUS            0x27
 
 #define MaxTemp       120
 #define MinTemp       -40
@@ -81,19 +85,177 @@
 #define T_DA_On                  0x01 // Temperature data avialable, set to 1 whenever a new humidity sample is available.
 #define T_DA_Off                 0x00
  
-bool hts221_init(void);
+/** Interface for the STMicroelectronics HTS221 humidity and temperature sensor
+ *
+ * The calibration is read once by calib() and folded into a fixed-point
+ * slope/offset pair per channel, so a conversion is one multiply and one add.
+ * Several instances may share one I2C bus. tools/hts221_test.cpp runs
+ * the driver against a simulated bus on the host.
+ *
+ * @code
+ * #include "mbed.h"
+ * #include "hts221.h"
+ *
+ * I2CBus i2c(I2C_SDA, I2C_SCL);
+ * HTS221 hts221(i2c);
+ *
+ * int main() {
+ *   hts221.init();
+ *   hts221.calib();
+ *   while(1) {
+ *      hts221.get();
+ *      printf("%4.2fC %3.1f%%\r\n", hts221.temperature(), hts221.humidity());
+ *      wait(1.0);
+ *   }
+ * }
+ * @endcode
+ */
+class HTS221
+{
+public:
+    /** Attach to a shared I2C bus
+      * @param I2C bus
+      * @param device address (Option parameter, HTS221_WriteADDE by default)
+      */
+    HTS221(I2CBus& p_i2c);
+    HTS221(I2CBus& p_i2c, uint8_t addr);
+
+    /** Configure the sensor and check its ID
+      * @param none
+      * @return true if every write was acknowledged and WHO_AM_I matched
+      */
+    bool init(void);
+
+    /** Read the factory calibration and precompute the conversion
+      * @param none
+      * @return false if the calibration could not be read, the conversion is then left as it was
+      */
+    bool calib(void);
+
+    /** Read ID register
+      * @param none
+      * @return true if STM MEMS HTS221
+      */
+    bool verify_product_id(void);
+
+    /** Read and convert one temperature/humidity sample
+      * @param none
+      * @return false if the read failed, the last sample is then kept
+      */
+    bool get(void);
+
+    /** Last temperature
+      * @param none
+      * @return temperature in degC
+      */
+    float temperature(void);
+
+    /** Last humidity
+      * @param none
+      * @return relative humidity in %
+      */
+    float humidity(void);
+
+    /** Last temperature in fixed point
+      * @param none
+      * @return temperature in 0.01 degC
+      */
+    int16_t temperature_x100(void);
+
+    /** Last humidity in fixed point
+      * @param none
+      * @return relative humidity in 0.1 %
+      */
+    uint16_t humidity_x10(void);
+
+    /** Set the output data rate
+      * @param ODR_OneShot, ODR_1Hz, ODR_7Hz or ODR_12_5Hz
+      * @return none
+      */
+    void odr(uint8_t rate);
+
+    /** Start a one-shot conversion (ODR_OneShot)
+      *  The sensor returns to its power-down level once the sample is ready.
+      * @param none
+      * @return none
+      */
+    void one_shot(void);
+
+    /** Check for a complete sample
+      * @param none
+      * @return true once both temperature and humidity are available
+      */
+    bool data_ready(void);
+
+    /** Enable or disable the data ready output (DRDY pin, active high, push-pull)
+      * @param enable true to raise DRDY whenever a new sample is available
+      * @return none
+      */
+    void drdy_enable(bool enable);
+
+#if DEVICE_I2C_ASYNCH
+    /** Start a non-blocking read
+      *  The register address write and the data read are chained in one
+      *  I2C::transfer(). The callback runs in interrupt context with the I2C
+      *  event and, if it is I2C_EVENT_TRANSFER_COMPLETE, the converted sample
+      *  (0.01 degC, 0.1 %RH), which is also kept for the getters above.
+      * @param callback completion callback
+      * @return 0 if the read was started, -1 if a read or the bus is still busy
+      */
+    int get_async(Callback<void(int, int16_t, uint16_t)> callback);
+
+    /** Check for a non-blocking read in progress
+      * @param none
+      * @return true while a read started by get_async() has not completed
+      */
+    bool busy(void);
+#endif
+
+    /** Health counters of the sensor's I2C traffic
+      * @param none
+      * @return counters, see I2CBus.h
+      */
+    const I2CHealth& health(void);
+
+    /** Write register (general purpose)
+      * @param register's address
+      * @param data
+      * @return 0 on success, non-0 if the write failed after retries
+      */
+    int register_write(uint8_t register_address, uint8_t value);
 
-void hts221_register_write(uint8_t register_address, const uint8_t value);
+    /** Read registers (general purpose)
+      * @param register's address, set bit 7 for auto-increment
+      * @param destination buffer
+      * @param number of bytes
+      * @return 0 on success, non-0 if the read failed after retries
+      */
+    int register_read(char register_address, char *destination, uint8_t number_of_bytes);
 
-void hts221_register_read(char register_address, char *destination, uint8_t number_of_bytes);
+private:
+    void convert(const char *sensor_data);
+#if DEVICE_I2C_ASYNCH
+    void async_done(int event);
+#endif
 
-bool hts221_verify_product_id(void);
+    I2CDevice _i2c;
 
-void HTS221_Calib(void);
+    // out = (slope * raw + offset) >> 16, in 0.01 degC and 0.1 %RH
+    int32_t _t_slope;
+    int64_t _t_offset;
+    int32_t _h_slope;
+    int64_t _h_offset;
 
-void HTS221_ReadTempHumi( float *pTemp , float *pHumi);
+    int16_t _temp;         // 0.01 degC
+    uint16_t _humi;        // 0.1 %RH
 
-float linear_interpolation(int16_t x0, float y0, int16_t x1, float y1, float mes);
+#if DEVICE_I2C_ASYNCH
+    char _async_reg;
+    char _async_data[4];
+    volatile bool _async_busy;
+    Callback<void(int, int16_t, uint16_t)> _async_callback;
+#endif
+};
 
 #endif /* HTS221_H */
 
@@ -0,0 +1,384 @@
+#include "I2CBus.h"
+
+#if defined(TARGET_STM)
+// targets/TARGET_STM/i2c_api.c
+extern "C" int i2c_bus_recover(i2c_t *obj);
+extern "C" int i2c_bus_busy(i2c_t *obj);
+extern "C" void i2c_timing_flush(i2c_t *obj);
+#endif
+
+int I2CBus::Peripheral::recover(void)
+{
+#if defined(TARGET_STM)
+    return i2c_bus_recover(&_i2c);
+#else
+    // No line level recovery, a STOP and a re-init is the best the HAL offers
+    i2c_reset(&_i2c);
+    return 1;
+#endif
+}
+
+bool I2CBus::Peripheral::busy(void)
+{
+#if defined(TARGET_STM)
+    return i2c_bus_busy(&_i2c) != 0;
+#else
+    return false;
+#endif
+}
+
+void I2CBus::Peripheral::flush_timing(void)
+{
+#if defined(TARGET_STM)
+    i2c_timing_flush(&_i2c);
+#endif
+}
+
+I2CBus::I2CBus(PinName sda, PinName scl, int hz)
+    : _i2c(sda, scl), _hz(hz), _switches(0), _dma(false), _pending(0), _suspect(NULL), _devices(NULL)
+{
+    _i2c.frequency(hz);
+#if DEVICE_I2C_ASYNCH
+    dma(true);
+#endif
+}
+
+int I2CBus::frequency(void)
+{
+    return _hz;
+}
+
+uint32_t I2CBus::switches(void)
+{
+    return _switches;
+}
+
+void I2CBus::switch_cost(int hz, int rounds, uint32_t *cached_ns, uint32_t *uncached_ns)
+{
+    int clocks[2] = { hz, _hz };
+    uint32_t start;
+    int i;
+
+    acquire(_hz);
+    // Both timings cached, whatever ran before
+    _i2c.frequency(hz);
+    _i2c.frequency(_hz);
+    start = us_ticker_read();
+    for (i = 0; i < 2 * rounds; i++) {
+        _i2c.frequency(clocks[i & 1]);
+    }
+    *cached_ns = (us_ticker_read() - start) * 1000 / (2 * rounds);
+
+    start = us_ticker_read();
+    for (i = 0; i < 2 * rounds; i++) {
+        _i2c.flush_timing();
+        _i2c.frequency(clocks[i & 1]);
+    }
+    *uncached_ns = (us_ticker_read() - start) * 1000 / (2 * rounds);
+    // Ends on _hz, with both timings cached again
+    _i2c.frequency(hz);
+    _i2c.frequency(_hz);
+    release();
+}
+
+// With 'queue' the caller only adds a non-blocking transfer at the current
+// clock, which the driver queues while the bus is busy
+#if DEVICE_I2C_ASYNCH
+void I2CBus::dma(bool on)
+{
+    acquire(_hz);
+    if (_i2c.set_dma_usage(on ? DMA_USAGE_OPPORTUNISTIC : DMA_USAGE_NEVER) == 0) {
+        _dma = on;
+    }
+    release();
+}
+
+bool I2CBus::dma(void)
+{
+    return _dma;
+}
+#endif
+
+#if defined(I2C_IRQ_COUNTS)
+const i2c_irq_counts_t& I2CBus::irq_counts(void)
+{
+    return _i2c.irq_counts();
+}
+
+void I2CBus::clear_irq_counts(void)
+{
+    core_util_critical_section_enter();
+    memset(&_i2c.irq_counts(), 0, sizeof(i2c_irq_counts_t));
+    core_util_critical_section_exit();
+}
+#endif
+
+void I2CBus::acquire(int hz, bool queue)
+{
+    int waited = 0;
+
+    _i2c.lock();
+    if (queue && hz == _hz && _suspect == NULL) {
+        return;
+    }
+    // Queued transfers run without the lock held, let them finish before
+    // the peripheral is used or reprogrammed. One that never ends would
+    // hold every user of the bus here for good.
+    while (_pending) {
+        if (waited++ >= I2CBUS_DRAIN_MS) {
+            abort();
+            break;
+        }
+        Thread::wait(1);
+    }
+    if (_suspect != NULL) {
+        _suspect->recover();
+        _suspect = NULL;
+    }
+    if (hz != _hz) {
+        _i2c.frequency(hz);
+        _hz = hz;
+        _switches++;
+    }
+}
+
+void I2CBus::release(void)
+{
+    _i2c.unlock();
+}
+
+// With the bus held: drop the queued transfers and end each one as failed,
+// which marks the bus for recovery
+void I2CBus::abort(void)
+{
+    _i2c.abort_all_transfers();
+#if DEVICE_I2C_ASYNCH
+    for (I2CDevice *device = _devices; device != NULL; device = device->_next) {
+        if (device->_busy) {
+            device->transfer_done(I2C_EVENT_ERROR);
+        }
+    }
+#endif
+    _pending = 0;
+}
+
+I2CDevice::I2CDevice(I2CBus& bus, uint8_t addr, int hz) : _bus(bus), _next(bus._devices), _addr(addr), _hz(hz)
+{
+#if DEVICE_I2C_ASYNCH
+    _event = 0;
+    _busy = false;
+#endif
+    clear_health();
+    // Devices are created before the threads that use them start
+    bus._devices = this;
+}
+
+I2CDevice::~I2CDevice()
+{
+    I2CDevice **link = &_bus._devices;
+
+    while (*link != NULL && *link != this) {
+        link = &(*link)->_next;
+    }
+    if (*link == this) {
+        *link = _next;
+    }
+}
+
+void I2CDevice::frequency(int hz)
+{
+    _hz = hz;
+}
+
+uint8_t I2CDevice::address(void)
+{
+    return _addr;
+}
+
+int I2CDevice::write(const char *data, int length, bool repeated)
+{
+    int ret;
+
+    uint32_t start;
+    int attempt = 0;
+
+    _bus.acquire(_hz);
+    _health.transactions++;
+    do {
+        start = us_ticker_read();
+        ret = _bus._i2c.write(_addr, data, length, repeated);
+    } while (retry(ret, start, length + 1, attempt++));
+    _bus.release();
+    return ret;
+}
+
+int I2CDevice::read(char *data, int length, bool repeated)
+{
+    int ret;
+
+    uint32_t start;
+    int attempt = 0;
+
+    _bus.acquire(_hz);
+    _health.transactions++;
+    do {
+        start = us_ticker_read();
+        ret = _bus._i2c.read(_addr, data, length, repeated);
+    } while (retry(ret, start, length + 1, attempt++));
+    _bus.release();
+    return ret;
+}
+
+int I2CDevice::write_read(const char *tx, int tx_length, char *rx, int rx_length)
+{
+    int ret;
+
+    uint32_t start;
+    int attempt = 0;
+
+    _bus.acquire(_hz);
+    _health.transactions++;
+    do {
+        start = us_ticker_read();
+        ret = _bus._i2c.write(_addr, tx, tx_length, true);
+        if (ret == 0) {
+            ret = _bus._i2c.read(_addr, rx, rx_length, false);
+        } else {
+            _bus._i2c.stop();
+        }
+    } while (retry(ret, start, tx_length + rx_length + 2, attempt++));
+    _bus.release();
+    return ret;
+}
+
+bool I2CDevice::check_id(char reg, uint8_t expected)
+{
+    char id;
+    bool ok;
+
+    lock();
+    ok = write_read(&reg, 1, &id, 1) == 0;
+    if (ok && (uint8_t)id != expected) {
+        _health.id_mismatches++;
+        ok = false;
+    }
+    unlock();
+    return ok;
+}
+
+#if DEVICE_I2C_ASYNCH
+int I2CDevice::transfer(const char *tx, int tx_length, char *rx, int rx_length,
+                        const event_callback_t& callback, int event, bool repeated)
+{
+    int ret;
+
+    // Checked and set under the bus lock, so two threads sharing the
+    // device cannot both start a transfer; only transfer_done() clears it
+    _bus.acquire(_hz, true);
+    if (_busy) {
+        _bus.release();
+        return -1;
+    }
+    _health.transactions++;
+    _callback = callback;
+    _event = event;
+    _busy = true;
+    core_util_atomic_incr_u32(&_bus._pending, 1);
+    // Ask for every terminating event so the transfer is always accounted for
+    ret = _bus._i2c.transfer(_addr, tx, tx_length, rx, rx_length,
+                             event_callback_t(this, &I2CDevice::transfer_done), I2C_EVENT_ALL, repeated);
+    if (ret != 0) {
+        core_util_atomic_decr_u32(&_bus._pending, 1);
+        _busy = false;
+    }
+    _bus.release();
+    return ret;
+}
+
+void I2CDevice::transfer_done(int event)
+{
+    if (!_busy) {
+        return;     // already ended by I2CBus::abort()
+    }
+    if (event & (I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)) {
+        _health.nacks++;
+    } else if (event & I2C_EVENT_ERROR) {
+        // No recovery from interrupt context, the next user of the bus runs it
+        _health.timeouts++;
+        _bus._suspect = this;
+    }
+    _busy = false;
+    core_util_atomic_decr_u32(&_bus._pending, 1);
+    if (_callback && (event & _event)) {
+        _callback.call(event);
+    }
+}
+#endif
+
+void I2CDevice::lock(void)
+{
+    _bus.acquire(_hz);
+}
+
+void I2CDevice::unlock(void)
+{
+    _bus.release();
+}
+
+const I2CHealth& I2CDevice::health(void)
+{
+    return _health;
+}
+
+void I2CDevice::clear_health(void)
+{
+    memset(&_health, 0, sizeof(_health));
+}
+
+// Account for one attempt of a blocking transaction, with the bus held.
+// On a failure, free the bus if it is stuck and tell whether to try again.
+bool I2CDevice::retry(int ret, uint32_t start, int bytes, int attempt)
+{
+    uint32_t nominal;
+
+    if (ret == 0) {
+        return false;
+    }
+    // 9 clocks per byte; the HAL gives up on a silent bus only after about
+    // 30 byte times, while a NACK ends the transfer at once
+    nominal = (uint32_t)bytes * 9 * 1000000 / _hz + 1;
+    if (us_ticker_read() - start > nominal * I2CBUS_TIMEOUT_FACTOR) {
+        _health.timeouts++;
+        recover();
+    } else {
+        // A NACK leaves the bus idle unless the peripheral still sees it busy
+        _health.nacks++;
+        if (_bus._i2c.busy()) {
+            recover();
+        }
+    }
+    if (attempt >= I2CBUS_RETRIES) {
+        _health.failures++;
+        return false;
+    }
+    _health.retries++;
+    wait_us(I2CBUS_RETRY_US);
+    return true;
+}
+
+// Check the bus and recover it if needed, charging the time to this device
+void I2CDevice::recover(void)
+{
+    uint32_t start = us_ticker_read();
+    uint32_t us;
+
+    if (_bus._i2c.recover() == 0) {
+        return;     // bus idle, nothing was stuck
+    }
+    us = us_ticker_read() - start;
+    _health.recoveries++;
+    _health.recovery_us += us;
+    if (us > _health.recovery_max_us) {
+        _health.recovery_max_us = us;
+    }
+}
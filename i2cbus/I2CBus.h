@@ -0,0 +1,276 @@
+/*
+ * Shared I2C bus
+ *
+ * One I2CBus owns the I2C peripheral and each sensor driver talks to it
+ * through an I2CDevice, which carries the device address and the clock the
+ * device wants. Transactions from different threads queue on the bus lock,
+ * and the clock is only reprogrammed when a transaction for a device with a
+ * different frequency follows, so with every device at the default 400 kHz
+ * the bus is configured once at start-up. On STM targets the HAL keeps the
+ * timing registers of each clock it has set, so switching between devices
+ * of different speeds is a register write; switch_cost() measures it.
+ *
+ * write_read() and lock()/unlock() keep back-to-back transactions of one
+ * device together: the register address write and the data read of a
+ * register access can no longer be split by another driver, and a driver
+ * can hold the bus over a whole configuration sequence.
+ *
+ * Non-blocking transfers of different devices go into the I2C driver's
+ * transaction queue (TRANSACTION_QUEUE_SIZE_I2C) and are started one after
+ * the other from the completion interrupt, so a burst of register reads
+ * keeps the bus busy without a thread waking up in between. Blocking
+ * transactions, clock changes and bus recovery wait for the queue to drain.
+ * A queue that does not drain within I2CBUS_DRAIN_MS, a transfer the HAL
+ * never started or never ended, is aborted: every transfer in it ends with
+ * I2C_EVENT_ERROR and the bus is checked, rather than the bus locking up.
+ *
+ * With DMA on, long non-blocking register reads such as FIFO drains move
+ * their data by DMA, one interrupt per transfer instead of one per byte;
+ * irq_counts() shows the interrupt load either way.
+ *
+ * A failed blocking transaction is retried. After a timeout, or a NACK
+ * with the peripheral still busy, the bus is checked before the retry and,
+ * if a slave holds SDA low or the peripheral is stuck busy, recovered by
+ * clocking the slave free and resetting the peripheral, so a hung bus
+ * costs a few milliseconds instead of a board reset. A plain NACK leaves
+ * the bus idle and the pins alone. Every device
+ * keeps I2CHealth counters of what went wrong and how long recovery took.
+ */
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include "mbed.h"
+
+#define I2CBUS_DEFAULT_HZ       400000
+#define I2CBUS_RETRIES          2       // extra attempts after a failure
+#define I2CBUS_RETRY_US         200     // pause before a retry, lets a busy device settle
+// A failure that took this many times the nominal transfer time is a timeout, else a NACK
+#define I2CBUS_TIMEOUT_FACTOR   4
+// Queued non-blocking transfers still not ended after this are aborted as failed
+#define I2CBUS_DRAIN_MS         100
+
+/** Health counters of one device */
+typedef struct {
+    uint32_t transactions;      // started, blocking and non-blocking
+    uint32_t nacks;             // attempts the device did not acknowledge
+    uint32_t timeouts;          // attempts that ran into the HAL timeout or a bus error
+    uint32_t retries;           // attempts repeated after a failure
+    uint32_t failures;          // transactions still failing after the last retry
+    uint32_t recoveries;        // bus recoveries run after a failure of this device
+    uint32_t recovery_us;       // total time spent in those recoveries
+    uint32_t recovery_max_us;   // longest one
+    uint32_t id_mismatches;     // check_id() reads with an unexpected value
+} I2CHealth;
+
+class I2CDevice;
+
+class I2CBus
+{
+public:
+    /** Create the bus
+      * @param sda I2C data line pin
+      * @param scl I2C clock line pin
+      * @param hz initial clock frequency
+      */
+    I2CBus(PinName sda, PinName scl, int hz = I2CBUS_DEFAULT_HZ);
+
+    /** Current clock frequency
+      * @param none
+      * @return frequency in Hz
+      */
+    int frequency(void);
+
+    /** Number of times the clock had to be reprogrammed
+      * @param none
+      * @return count since start-up
+      */
+    uint32_t switches(void);
+
+    /** Measure the cost of a clock switch, holding the bus
+      *  Switches back and forth between the current clock and hz.
+      * @param hz the other clock
+      * @param rounds back and forth switches to average over
+      * @param cached_ns average switch to a clock whose timing the HAL has cached
+      * @param uncached_ns average switch with the timing computed afresh
+      * @return none
+      */
+    void switch_cost(int hz, int rounds, uint32_t *cached_ns, uint32_t *uncached_ns);
+
+#if DEVICE_I2C_ASYNCH
+    /** Let long non-blocking reads use DMA, waits for queued transfers to end
+      * @param on
+      * @return none
+      */
+    void dma(bool on);
+
+    /** DMA setting
+      * @param none
+      * @return true if long non-blocking reads may use DMA
+      */
+    bool dma(void);
+#endif
+
+#if defined(I2C_IRQ_COUNTS)
+    /** Interrupts taken by the non-blocking transfers
+      * @param none
+      * @return counters since start-up or the last clear_irq_counts()
+      */
+    const i2c_irq_counts_t& irq_counts(void);
+
+    /** Reset the interrupt counters
+      * @param none
+      * @return none
+      */
+    void clear_irq_counts(void);
+#endif
+
+private:
+    friend class I2CDevice;
+
+    // Gives access to the HAL object for the target specific recovery
+    class Peripheral : public I2C
+    {
+    public:
+        Peripheral(PinName sda, PinName scl) : I2C(sda, scl) {}
+        int recover(void);
+        bool busy(void);
+        void flush_timing(void);
+#if defined(I2C_IRQ_COUNTS)
+        i2c_irq_counts_t& irq_counts(void) { return _i2c.i2c.counts; }
+#endif
+    };
+
+    void acquire(int hz, bool queue = false);
+    void release(void);
+    void abort(void);
+
+    Peripheral _i2c;
+    int _hz;
+    uint32_t _switches;
+    bool _dma;
+    uint32_t _pending;          // non-blocking transfers queued or in flight, atomic
+    I2CDevice * volatile _suspect;  // its non-blocking transfer failed, check the bus first
+    I2CDevice *_devices;        // every device on the bus, linked through _next
+};
+
+class I2CDevice
+{
+public:
+    /** Attach a device to a bus
+      * @param bus
+      * @param 8-bit device address
+      * @param clock frequency for this device
+      */
+    I2CDevice(I2CBus& bus, uint8_t addr, int hz = I2CBUS_DEFAULT_HZ);
+    ~I2CDevice();
+
+    /** Set the clock frequency for this device, applied on its next transaction
+      * @param hz
+      * @return none
+      */
+    void frequency(int hz);
+
+    /** Device address
+      * @param none
+      * @return 8-bit address
+      */
+    uint8_t address(void);
+
+    /** Write to the device
+      * @param data
+      * @param length
+      * @param repeated do not send a stop at the end
+      * @return 0 on success (ack), non-0 on failure (nack)
+      */
+    int write(const char *data, int length, bool repeated = false);
+
+    /** Read from the device
+      * @param data
+      * @param length
+      * @param repeated do not send a stop at the end
+      * @return 0 on success (ack), non-0 on failure (nack)
+      */
+    int read(char *data, int length, bool repeated = false);
+
+    /** Write then read with a repeated start, without releasing the bus in between
+      * @param tx data to write, usually the register address
+      * @param tx_length
+      * @param rx buffer for the data read
+      * @param rx_length
+      * @return 0 on success (ack), non-0 on failure (nack)
+      */
+    int write_read(const char *tx, int tx_length, char *rx, int rx_length);
+
+    /** Read an ID register and compare it, counting mismatches
+      * @param register address
+      * @param expected value
+      * @return true if the device answered with the expected value
+      */
+    bool check_id(char reg, uint8_t expected);
+
+#if DEVICE_I2C_ASYNCH
+    /** Start a non-blocking write/read, see I2C::transfer()
+      *  With the bus busy the transfer is queued behind the others, it
+      *  only waits for the queue to drain when the clock has to change or
+      *  the bus needs recovery. A device has one transfer at a time.
+      * @param tx data to write, may be NULL
+      * @param tx_length
+      * @param rx buffer for the data read, may be NULL
+      * @param rx_length
+      * @param callback run in interrupt context when the transfer ends
+      * @param event the events that trigger the callback
+      * @param repeated do not send a stop at the end
+      * @return 0 if the transfer was started or queued, -1 if this device has
+      *  one in flight or the queue is full
+      */
+    int transfer(const char *tx, int tx_length, char *rx, int rx_length,
+                 const event_callback_t& callback, int event = I2C_EVENT_TRANSFER_COMPLETE,
+                 bool repeated = false);
+#endif
+
+    /** Hold the bus at this device's clock over several transactions
+      * @param none
+      * @return none
+      */
+    void lock(void);
+
+    /** Release the bus held by lock()
+      * @param none
+      * @return none
+      */
+    void unlock(void);
+
+    /** Health counters
+      * @param none
+      * @return counters since start-up or the last clear_health()
+      */
+    const I2CHealth& health(void);
+
+    /** Reset the health counters
+      * @param none
+      * @return none
+      */
+    void clear_health(void);
+
+private:
+    friend class I2CBus;
+
+    bool retry(int ret, uint32_t start, int bytes, int attempt);
+    void recover(void);
+
+#if DEVICE_I2C_ASYNCH
+    void transfer_done(int event);
+
+    event_callback_t _callback;
+    int _event;
+    volatile bool _busy;        // a transfer of this device is queued or in flight
+#endif
+
+    I2CBus &_bus;
+    I2CDevice *_next;           // next device on the same bus
+    uint8_t _addr;
+    int _hz;
+    I2CHealth _health;
+};
+
+#endif // I2CBUS_H
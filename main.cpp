@@ -1,49 +1,853 @@
-
 #include "mbed.h"
+#include <ctype.h>
+#include <math.h>
 
 //#include "rtos.h"
+#include "I2CBus.h"
 #include "hts221.h"
 #include "LPS25H.h"
+#include "LSM6DS0.h"
+#include "Sample.h"
+#include "Sampler.h"
+#include "HTS221Sensor.h"
+#include "LPS25HSensor.h"
+#include "DataReady.h"
+#include "DutyCycle.h"
+#include "MotionStream.h"
+#include "Delta.h"
+#include "SampleLog.h"
+#include "Telemetry.h"
+#include "SampleFilter.h"
+#include "Derived.h"
+#include "Decimal.h"
+#include "Timebase.h"
+#include "Shell.h"
+#include "Rules.h"
+#include "i2c_trace.h"
+#include "BufferedSerial.h"
+
+// Data ready lines of the IKS01A1 sensors, set by the hts221-drdy-pin and
+// lps25h-int1-pin options of mbed_app.json. They only reach the Arduino
+// header once the matching solder bridges are fitted (see the help text
+// there); NC keeps to timer driven sampling.
+#define HTS221_DRDY_PIN     MBED_CONF_APP_HTS221_DRDY_PIN
+#define LPS25H_INT1_PIN     MBED_CONF_APP_LPS25H_INT1_PIN
 
 
 DigitalOut myled(LED1);
-I2C i2c2(I2C_SDA, I2C_SCL);
+// stdio goes through this port, see main()
+BufferedSerial console_port(USBTX, USBRX, "console", MBED_CONF_PLATFORM_STDIO_BAUD_RATE);
+I2CBus i2c2(I2C_SDA, I2C_SCL);   // shared by both sensors, 400kHz
 
-float tempCelsius = 25.50;
-float humi = 55;
-int humiMax = 100; 
 char cmd=0;
-uint32_t seconds = 0, minutes=0, hours=0; 
 
 LPS25H barometer(i2c2, LPS25H_V_CHIP_ADDR);
+HTS221 humidity(i2c2);
+LSM6DS0 imu(i2c2);
 
+// The sensors fitted, sampled by one acquisition engine
+HTS221Sensor hts221_sensor(humidity);
+LPS25HSensor lps25h_sensor(barometer);
+typedef SensorSet<HTS221Sensor, SensorSet<LPS25HSensor> > Sensors;
+Sensors sensors(hts221_sensor, Sensors::Next(lps25h_sensor));
 
+EventQueue queue;          // acquisition runs on this queue
+Thread event_thread;
+Thread console_thread;
+Thread motion_thread;
+SampleQueue samples;
+Sampler<Sensors> sampler(sensors, queue, samples);
+DataReady drdy(hts221_sensor, HTS221_DRDY_PIN, lps25h_sensor, LPS25H_INT1_PIN, queue, samples);
+DutyCycle duty(hts221_sensor, lps25h_sensor, queue, samples);
+bool drdy_mode = false;
+MotionStream motion(imu, queue);
+uint32_t vibration = 0;     // mg RMS over the last block
+uint32_t motion_blocks = 0;
+bool streaming = false;
+uint32_t stream_remaining = 0;   // samples still to print for the stream command, atomic decrement
+bool binary = false;        // stream COBS frames instead of text
+SampleFilter sample_filter;
+bool filtering = false;
 
-int main()
+// Frost, condensation and pressure drop detection, see Rules.h
+void rule_event(const RuleEvent& event);
+Rules rules(rule_event);
+
+// Most recent sample of each sensor, for the 'A' command
+Sample latest[2];
+Derived derived;            // dew point, altitude and QNH from the latest samples
+Mutex latest_mutex;
+
+// History: one record per HTS221 sample, with the latest pressure
+SampleLog sample_log;
+
+static const uint32_t duty_periods[] = { 1000, 10000, 60000 };     // ms
+
+void print_sample(const Sample *sample)
+  {
+  char t[DECIMAL_MAX_LENGTH], v[DECIMAL_MAX_LENGTH];
+  unsigned long s = (unsigned long)(sample->time / 1000000), us = (unsigned long)(sample->time % 1000000);
+  if(sample->source == SAMPLE_HTS221){
+    Decimal::format(t, sample->temperature, 2, 4);
+    Decimal::format_unsigned(v, sample->humidity, 1, 3);
+    printf("%7lu.%06lu %sC %s%%\r\n", s, us, t, v);
+  } else {
+    Decimal::format_unsigned(v, LPS25H::raw_to_pressure_x100(sample->pressure), 2, 6);
+    Decimal::format(t, LPS25H::raw_to_temperature_x100(sample->temperature), 2, 4);
+    printf("%7lu.%06lu %s %s\r\n", s, us, v, t);
+  }
+  }
+
+void send_sample(const Sample *sample)
+  {
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  fwrite(frame, 1, Telemetry::encode(*sample, frame), stdout);
+  }
+
+// Rule state changes are always reported, whether the samples are streamed or not
+void rule_event(const RuleEvent& event)
+  {
+  if(binary){
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    fwrite(frame, 1, Telemetry::encode(event, frame), stdout);
+  } else {
+    RuleConfig config;
+    char v[DECIMAL_MAX_LENGTH];
+    rules.get(event.rule, &config);
+    printf("%7lu.%06lu rule %d %s", (unsigned long)(event.time / 1000000), (unsigned long)(event.time % 1000000),
+           event.rule, event.active ? "fired" : "cleared");
+    if(config.type == RULE_BOTH){
+      printf(" (%d and %d)\r\n", config.first, config.second);
+    } else {
+      Decimal::format(v, event.value, Rules::quantity_decimals(config.quantity));
+      printf(", %s %s %s\r\n", Rules::quantity_name(config.quantity),
+             config.type == RULE_RISE || config.type == RULE_FALL ? "changed by" : "at", v);
+    }
+  }
+  }
+
+// Feed the rules with the quantities a sample carries
+void evaluate_rules(const Sample *sample)
+  {
+  if(sample->source == SAMPLE_HTS221){
+    rules.update(RULE_TEMPERATURE, sample->temperature, sample->time);
+    rules.update(RULE_HUMIDITY, sample->humidity, sample->time);
+    if(rules.uses(RULE_DEW_POINT) || rules.uses(RULE_SPREAD)){
+      int16_t dew_point = Derived::dew_point(sample->temperature, sample->humidity);
+      rules.update(RULE_DEW_POINT, dew_point, sample->time);
+      rules.update(RULE_SPREAD, sample->temperature - dew_point, sample->time);
+    }
+  } else {
+    rules.update(RULE_PRESSURE, LPS25H::raw_to_pressure_x100(sample->pressure), sample->time);
+  }
+  }
+
+// Send the history as compressed log frames, each one coded from a fresh stream
+void send_log(uint32_t from, uint32_t count)
+  {
+  static uint8_t data[TELEMETRY_LOG_DATA], frame[TELEMETRY_LOG_FRAME];    // off the 2K console stack
+  LogEntry chunk[16];
+  DeltaEncoder encoder;
+  DeltaRecord record;
+  uint32_t n, i, first = from, records = 0;
+  size_t used = 0;
+  while(count > 0 && (n = sample_log.read(from, chunk, count < 16 ? count : 16)) > 0){
+    for(i = 0; i < n; i++){
+      if(used + DELTA_MAX_RECORD > sizeof(data) || records == 255){
+        fwrite(frame, 1, Telemetry::encode_log(first, records, data, used, frame), stdout);
+        encoder.reset();
+        first = from + i;
+        records = 0;
+        used = 0;
+      }
+      SampleLog::to_record(chunk[i], &record);
+      used += encoder.encode(record, &data[used]);
+      records++;
+    }
+    from += n;
+    count -= n;
+  }
+  if(records > 0){
+    fwrite(frame, 1, Telemetry::encode_log(first, records, data, used, frame), stdout);
+  }
+  }
+
+// Print the history a few records at a time, the log stays unlocked while printing
+void dump_log(uint32_t from, uint32_t count)
+  {
+  LogEntry chunk[16];
+  char t[DECIMAL_MAX_LENGTH], h[DECIMAL_MAX_LENGTH], p[DECIMAL_MAX_LENGTH];
+  uint32_t n, i;
+  if(binary){
+    send_log(from, count);
+    return;
+  }
+  while(count > 0 && (n = sample_log.read(from, chunk, count < 16 ? count : 16)) > 0){
+    for(i = 0; i < n; i++){
+      Decimal::format(t, chunk[i].temperature, 2, 4);
+      Decimal::format_unsigned(h, chunk[i].humidity, 1, 3);
+      Decimal::format_unsigned(p, LPS25H::raw_to_pressure_x100(chunk[i].pressure), 2, 6);
+      printf("%5lu %10lu %sC %s%% %s\r\n", (unsigned long)(from + i), (unsigned long)chunk[i].time, t, h, p);
+    }
+    from += n;
+    count -= n;
+  }
+  }
+
+void log_sample(const Sample *sample)
+  {
+  LogEntry entry;
+  entry.time = (uint32_t)(sample->time / 1000);
+  entry.temperature = sample->temperature;
+  entry.humidity = sample->humidity;
+  entry.pressure = latest[SAMPLE_LPS25H].pressure;
+  sample_log.add(entry);
+  }
+
+// Step a sensor to its next supported rate
+void next_rate(SampleSource source)
+  {
+  int i, count;
+  const uint32_t *rates = sensors.rates(source, &count);
+  for(i = 0; i < count - 1 && rates[i] != sampler.rate(source); i++);
+  sampler.rate(source, rates[(i + 1) % count]);
+  printf("%s %lu.%luHz\n\r", sensors.name(source),
+         (unsigned long)sampler.rate(source) / 1000, (unsigned long)(sampler.rate(source) % 1000) / 100);
+  }
+
+static uint32_t isqrt(uint32_t x)
+  {
+  uint32_t r = 0, bit = 1UL << 30;
+  while(bit > x) bit >>= 2;
+  while(bit){
+    if(x >= r + bit){
+      x -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+    bit >>= 2;
+  }
+  return r;
+  }
+
+// Motion blocks are consumed here: vibration is the RMS of the acceleration
+// about its mean over the block, all three axes
+void motion_consumer(void)
+  {
+  while(1)
+    {
+      MotionBlock *block = motion.wait();
+      uint32_t variance = 0;
+      int axis, i;
+      for(axis = 0; axis < 3; axis++){
+        int32_t sum = 0;
+        uint64_t squares = 0;
+        for(i = 0; i < block->count; i++){
+          int32_t v = block->data[i].accel[axis];
+          sum += v;
+          squares += (uint64_t)(v * v);
+        }
+        variance += (uint32_t)((squares * block->count - (uint64_t)((int64_t)sum * sum)) / ((uint32_t)block->count * block->count));
+      }
+      vibration = isqrt(variance) * 61 / 1000;    // 0.061 mg/LSB at 2 g
+      motion_blocks++;
+      motion.release(block);
+    }
+  }
+
+// Name, channels and rates of every sensor in the registry
+void list_sensors(void)
+  {
+  int source, i, count;
+  for(source = 0; source < SAMPLE_SOURCES; source++){
+    if(!sensors.has(source)) continue;
+    const SensorChannel *channels = sensors.channels(source, &count);
+    printf("%s:", sensors.name(source));
+    for(i = 0; i < count; i++){
+      printf(" %s (%s)", channels[i].name, channels[i].unit);
+    }
+    const uint32_t *rates = sensors.rates(source, &count);
+    for(i = 0; i < count; i++){
+      printf("%s%lu.%lu", i ? "/" : ", ", (unsigned long)rates[i] / 1000, (unsigned long)(rates[i] % 1000) / 100);
+    }
+    printf("Hz\n\r");
+  }
+  }
+
+// Latest reading of both sensors, optionally with the derived values
+void print_latest(bool with_derived)
+  {
+  Sample hts, baro;
+  int16_t dew_point;
+  int32_t altitude;
+  uint32_t qnh;
+  latest_mutex.lock();
+  hts = latest[SAMPLE_HTS221];
+  baro = latest[SAMPLE_LPS25H];
+  if(with_derived){
+    dew_point = derived.dew_point();
+    altitude = derived.altitude();
+    qnh = derived.qnh();
+  }
+  latest_mutex.unlock();
+  char a[DECIMAL_MAX_LENGTH], b[DECIMAL_MAX_LENGTH], c[DECIMAL_MAX_LENGTH], d[DECIMAL_MAX_LENGTH];
+  Decimal::format(a, hts.temperature, 2, 4);
+  Decimal::format_unsigned(b, hts.humidity, 1, 3);
+  Decimal::format_unsigned(c, LPS25H::raw_to_pressure_x100(baro.pressure), 2, 6);
+  Decimal::format(d, LPS25H::raw_to_temperature_x100(baro.temperature), 2, 4);
+  printf("%sC %s%% %s %s\r\n", a, b, c, d);
+  if(with_derived){
+    Decimal::format(a, dew_point, 2, 4);
+    Decimal::format(b, altitude, 1, 5);
+    Decimal::format_unsigned(c, LPS25H::raw_to_pressure_x100(qnh), 2, 6);
+    printf("Dew point %sC, altitude %sm, QNH %s\r\n", a, b, c);
+  }
+  }
+
+// Uptime and, once the RTC is set, calendar time
+void print_time(void)
+  {
+  uint64_t now = Timebase::now();
+  printf("Up %lu.%06lus", (unsigned long)(now / 1000000), (unsigned long)(now % 1000000));
+  if(Timebase::anchor()){
+    char date[24];
+    uint64_t epoch = Timebase::epoch(now);
+    time_t seconds = (time_t)(epoch / 1000000);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", gmtime(&seconds));
+    printf(", %s.%06lu UTC", date, (unsigned long)(epoch % 1000000));
+  }
+  printf("\n\r");
+  }
+
+// I2C error and recovery counters of one device
+void print_health(const char *name, const I2CHealth& health)
+  {
+  printf("%s: %lu transactions, %lu NACKs, %lu timeouts, %lu retries, %lu failed, %lu wrong ID\n\r", name,
+         (unsigned long)health.transactions, (unsigned long)health.nacks, (unsigned long)health.timeouts,
+         (unsigned long)health.retries, (unsigned long)health.failures, (unsigned long)health.id_mismatches);
+  if(health.recoveries){
+    printf("  %lu bus recoveries, %luus total, %luus max\n\r", (unsigned long)health.recoveries,
+           (unsigned long)health.recovery_us, (unsigned long)health.recovery_max_us);
+  }
+  }
+
+// Sensor of the registry by name, any case; SAMPLE_SOURCES if there is none
+int find_source(const char *name)
+  {
+  int source, i;
+  for(source = 0; source < SAMPLE_SOURCES; source++){
+    const char *s = sensors.name(source);
+    if(!sensors.has(source)) continue;
+    for(i = 0; s[i] && toupper((unsigned char)name[i]) == s[i]; i++);
+    if(s[i] == 0 && name[i] == 0) return source;
+  }
+  return SAMPLE_SOURCES;
+  }
+
+// Shell commands, see the table below
+
+void cmd_help(int argc, char *argv[]);
+
+// stream <n> [period_ms]: the next n samples as acquired, or n readings
+// of both sensors one period apart
+void cmd_stream(int argc, char *argv[])
+  {
+  uint32_t n, period = 0, i;
+  if(!Decimal::parse_unsigned(argv[1], 0, &n) || (argc > 2 && !Decimal::parse_unsigned(argv[2], 0, &period))){
+    printf("Bad number\r\n");
+    return;
+  }
+  if(period == 0){
+    stream_remaining = n;
+    return;
+  }
+  for(i = 0; i < n; i++){
+    if(i) Thread::wait(period);
+    print_latest(false);
+  }
+  }
+
+// dump [from] [to]: history records, both ends included
+void cmd_dump(int argc, char *argv[])
+  {
+  uint32_t count = sample_log.count(), from = 0, to = count - 1;
+  if((argc > 1 && !Decimal::parse_unsigned(argv[1], 0, &from)) || (argc > 2 && !Decimal::parse_unsigned(argv[2], 0, &to))){
+    printf("Bad number\r\n");
+    return;
+  }
+  if(count == 0 || from > to || from >= count) return;
+  if(to >= count) to = count - 1;
+  dump_log(from, to - from + 1);
+  }
+
+// rate [sensor Hz]: show the sampling rates, or set one
+void cmd_rate(int argc, char *argv[])
+  {
+  int source;
+  uint32_t mhz;
+  if(argc == 3){
+    source = find_source(argv[1]);
+    if(source == SAMPLE_SOURCES){
+      printf("No sensor %s\r\n", argv[1]);
+      return;
+    }
+    if(!Decimal::parse_unsigned(argv[2], 3, &mhz) || !sampler.rate((SampleSource)source, mhz)){
+      printf("%s can't sample at %sHz\r\n", sensors.name(source), argv[2]);
+      return;
+    }
+  } else if(argc != 1){
+    printf("Usage: rate [sensor Hz]\r\n");
+    return;
+  }
+  for(source = 0; source < SAMPLE_SOURCES; source++){
+    char r[DECIMAL_MAX_LENGTH];
+    if(!sensors.has(source)) continue;
+    Decimal::format_unsigned(r, sampler.rate((SampleSource)source), 3);
+    printf("%s %sHz\r\n", sensors.name(source), r);
+  }
+  }
+
+// stats: loss counters of every path and the I2C health
+void cmd_stats(int argc, char *argv[])
+  {
+  printf("Sampler: %lu dropped, %lu failed reads\r\n", (unsigned long)sampler.dropped(), (unsigned long)sampler.failed());
+  printf("Data ready: %lu dropped, one-shot: %lu dropped\r\n", (unsigned long)drdy.dropped(), (unsigned long)duty.dropped());
+  printf("History: %lu records in %lu bytes\r\n", (unsigned long)sample_log.count(), (unsigned long)sample_log.bytes());
+  printf("Motion: %lu blocks, %lu overruns, %lu FIFO overruns\r\n", (unsigned long)motion_blocks,
+         (unsigned long)motion.overruns(), (unsigned long)motion.fifo_overruns());
+  printf("I2C: %dHz, %lu clock switches\r\n", i2c2.frequency(), (unsigned long)i2c2.switches());
+  BufferedSerialStats con = console_port.stats();
+  printf("Console out: %lu bytes in %lu transmits, %lu waits for room, %lu dropped, peak %lu/%d\r\n",
+         (unsigned long)con.tx_bytes, (unsigned long)con.tx_transfers, (unsigned long)con.tx_waits,
+         (unsigned long)con.tx_dropped, (unsigned long)con.tx_high_water, BUFFERED_SERIAL_TX_SIZE);
+  printf("Console in: %lu bytes, %lu dropped, peak %lu/%d\r\n", (unsigned long)con.rx_bytes,
+         (unsigned long)con.rx_dropped, (unsigned long)con.rx_high_water, BUFFERED_SERIAL_RX_SIZE);
+  print_health("HTS221", humidity.health());
+  print_health("LPS25H", barometer.health());
+  print_health("LSM6DS0", imu.health());
+#if defined(I2C_IRQ_COUNTS)
+  const i2c_irq_counts_t& irqs = i2c2.irq_counts();
+  printf("I2C async: %lu transfers, %lu on DMA, %lu I2C IRQs, %lu DMA IRQs\r\n", (unsigned long)irqs.transfers,
+         (unsigned long)irqs.dma_transfers, (unsigned long)irqs.irqs, (unsigned long)irqs.dma_irqs);
+#endif
+  }
+
+// config [stream|binary|filter|dma on|off]: show the settings, or change one
+void cmd_config(int argc, char *argv[])
+  {
+  if(argc == 3){
+    bool on = strcmp(argv[2], "on") == 0;
+    if(!on && strcmp(argv[2], "off") != 0){
+      printf("Usage: config [stream|binary|filter|dma on|off]\r\n");
+      return;
+    }
+    if(strcmp(argv[1], "stream") == 0){
+      streaming = on;
+    } else if(strcmp(argv[1], "binary") == 0){
+      binary = on;
+    } else if(strcmp(argv[1], "filter") == 0){
+      if(on && !filtering) sample_filter.reset();
+      filtering = on;
+    } else if(strcmp(argv[1], "dma") == 0){
+      // Fresh interrupt counts, so the two modes can be compared
+      i2c2.dma(on);
+#if defined(I2C_IRQ_COUNTS)
+      i2c2.clear_irq_counts();
+#endif
+    } else {
+      printf("No setting %s\r\n", argv[1]);
+      return;
+    }
+  } else if(argc != 1){
+    printf("Usage: config [stream|binary|filter|dma on|off]\r\n");
+    return;
+  }
+  if(duty.running()){
+    DutyBudget budget;
+    duty.budget(&budget);
+    printf("mode one-shot every %lums\r\n", (unsigned long)budget.period_ms);
+  } else {
+    printf("mode %s\r\n", drdy_mode ? "data ready" : "timer");
+  }
+  printf("stream %s\r\nbinary %s\r\nfilter %s\r\nmotion %s\r\n", streaming ? "on" : "off", binary ? "on" : "off",
+         filtering ? "on" : "off", motion.running() ? "on" : "off");
+#if DEVICE_I2C_ASYNCH
+  printf("dma %s\r\n", i2c2.dma() ? "on" : "off");
+#endif
+  }
+
+// rule [n off | n above|below quantity level [hysteresis] |
+//       n rise|fall quantity change window_s [hysteresis] | n both a b]
+void cmd_rule(int argc, char *argv[])
+  {
+  RuleConfig config;
+  uint32_t index, u;
+  int i, decimals;
+  if(argc == 1){
+    for(i = 0; i < RULES_MAX; i++){
+      char t[DECIMAL_MAX_LENGTH], h[DECIMAL_MAX_LENGTH];
+      bool active = rules.get(i, &config);
+      if(config.type == RULE_OFF) continue;
+      printf("%d %s ", i, Rules::type_name(config.type));
+      if(config.type == RULE_BOTH){
+        printf("%d %d", config.first, config.second);
+      } else {
+        decimals = Rules::quantity_decimals(config.quantity);
+        Decimal::format(t, config.threshold, decimals);
+        Decimal::format(h, config.hysteresis, decimals);
+        printf("%s %s", Rules::quantity_name(config.quantity), t);
+        if(config.type == RULE_RISE || config.type == RULE_FALL) printf(" %lu", (unsigned long)config.window);
+        printf(" %s", h);
+      }
+      printf("%s\r\n", active ? " (active)" : "");
+    }
+    return;
+  }
+  memset(&config, 0, sizeof(config));
+  for(i = RULE_OFF; i < RULE_TYPES && (argc < 3 || strcmp(argv[2], Rules::type_name(i)) != 0); i++);
+  if(!Decimal::parse_unsigned(argv[1], 0, &index) || i == RULE_TYPES) goto usage;
+  config.type = i;
+  if(config.type == RULE_BOTH){
+    if(argc != 5 || !Decimal::parse_unsigned(argv[3], 0, &u) || u >= RULES_MAX) goto usage;
+    config.first = u;
+    if(!Decimal::parse_unsigned(argv[4], 0, &u) || u >= RULES_MAX) goto usage;
+    config.second = u;
+  } else if(config.type != RULE_OFF){
+    int args = (config.type == RULE_RISE || config.type == RULE_FALL) ? 6 : 5;
+    for(i = 0; i < RULE_QUANTITIES && (argc < 4 || strcmp(argv[3], Rules::quantity_name(i)) != 0); i++);
+    if(i == RULE_QUANTITIES || argc < args || argc > args + 1) goto usage;
+    config.quantity = i;
+    decimals = Rules::quantity_decimals(i);
+    if(!Decimal::parse(argv[4], decimals, &config.threshold)) goto usage;
+    if(args == 6 && !Decimal::parse_unsigned(argv[5], 0, &config.window)) goto usage;
+    if(argc > args && !Decimal::parse(argv[args], decimals, &config.hysteresis)) goto usage;
+  } else if(argc != 3){
+    goto usage;
+  }
+  if(!rules.set(index, config)) goto usage;
+  return;
+usage:
+  printf("rule n off | n above|below quantity level [hysteresis] | n rise|fall quantity change window_s [hysteresis] | n both a b\r\n");
+  printf("quantities: temperature, humidity, pressure (hPa), dewpoint, spread\r\n");
+  }
+
+void cmd_time(int argc, char *argv[])
+  {
+  print_time();
+  }
+
+// switch [hz] [rounds]: time an I2C clock switch to hz and back, with and
+// without the HAL's timing cache
+void cmd_switch(int argc, char *argv[])
+  {
+  uint32_t hz = 100000, rounds = 1000, cached, uncached;
+  char c[DECIMAL_MAX_LENGTH], u[DECIMAL_MAX_LENGTH];
+  if((argc > 1 && !Decimal::parse_unsigned(argv[1], 0, &hz)) || hz == 0 ||
+     (argc > 2 && !Decimal::parse_unsigned(argv[2], 0, &rounds)) || rounds == 0 || rounds > 10000){
+    printf("Usage: switch [hz] [rounds], rounds 1 to 10000\r\n");
+    return;
+  }
+  i2c2.switch_cost(hz, rounds, &cached, &uncached);
+  Decimal::format_unsigned(c, cached, 3);
+  Decimal::format_unsigned(u, uncached, 3);
+  printf("I2C %dHz <-> %luHz: %sus cached, %sus computed\r\n", i2c2.frequency(), (unsigned long)hz, c, u);
+  }
+
+// Dew point through libm, the float evaluation Derived replaces
+static float dew_point_float(float t, float rh)
+  {
+  float gamma = logf(rh / 100) + 17.62f * t / (243.12f + t);
+  return 243.12f * gamma / (17.62f - gamma);
+  }
+
+// bench [n]: DWT cycles per sample of the fixed point derived values against
+// the same formulas through logf/powf, over n inputs spread like
+// tools/derived_bench.cpp. Runs with interrupts on, so take the lower of a
+// few runs; the host bench only gives the accuracy and the host ratio.
+void cmd_bench(int argc, char *argv[])
+  {
+  uint32_t n = 1000, i, start, fixed, libm;
+  volatile int32_t fixed_sink = 0;
+  volatile float float_sink = 0;
+  if((argc > 1 && !Decimal::parse_unsigned(argv[1], 0, &n)) || n == 0 || n > 100000){
+    printf("Usage: bench [n], n 1 to 100000\r\n");
+    return;
+  }
+  if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)){
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  start = DWT->CYCCNT;
+  for(i = 0; i < n; i++){
+    int16_t t = (int16_t)(i % 8000 - 2000);
+    uint16_t rh = (uint16_t)(i % 999 + 1);
+    uint32_t p = 900 * 4096 + i;
+    fixed_sink += Derived::dew_point(t, rh);
+    fixed_sink += Derived::altitude(p, DERIVED_SEA_LEVEL_RAW);
+    fixed_sink += (int32_t)Derived::qnh(p, (int32_t)(i % 5000));
+  }
+  fixed = (DWT->CYCCNT - start) / n;
+  start = DWT->CYCCNT;
+  for(i = 0; i < n; i++){
+    float t = ((int32_t)(i % 8000) - 2000) / 100.0f;
+    float rh = (i % 999 + 1) / 10.0f;
+    float p = (900 * 4096 + i) / 4096.0f;
+    float_sink += dew_point_float(t, rh);
+    float_sink += 44330.77f * (1 - powf(p / 1013.25f, 0.190263f));
+    float_sink += p * powf(1 - (i % 5000) / 443307.7f, -5.255877f);
+  }
+  libm = (DWT->CYCCNT - start) / n;
+  printf("dew point, altitude and QNH: %lu cycles fixed, %lu cycles libm per sample at %luMHz\r\n",
+         (unsigned long)fixed, (unsigned long)libm, (unsigned long)(SystemCoreClock / 1000000));
+  }
+
+#if I2C_TRACE
+static uint64_t trace_since;    // Timebase::now() at the last trace clear
+
+// trace [clear|log]: I2C time per slave address since the last clear, or the
+// last transactions one by one
+void cmd_trace(int argc, char *argv[])
+  {
+  static const char *const results[] = { "ok", "NACK", "error" };
+  static i2c_trace_t trace;     // too big for the console stack
+  uint32_t mhz = SystemCoreClock / 1000000;
+  uint32_t i, n;
+  if(argc == 2 && strcmp(argv[1], "clear") == 0){
+    i2c_trace_clear();
+    trace_since = Timebase::now();
+    return;
+  }
+  if(argc == 2 && strcmp(argv[1], "log") != 0){
+    printf("Usage: trace [clear|log]\r\n");
+    return;
+  }
+  i2c_trace_read(&trace);
+  if(argc == 2){
+    // Start times relative to the oldest entry shown, the cycle counter wraps
+    n = trace.logged < I2C_TRACE_LOG ? trace.logged : I2C_TRACE_LOG;
+    uint32_t first = trace.log[(trace.logged - n) % I2C_TRACE_LOG].start;
+    for(i = trace.logged - n; i != trace.logged; i++){
+      const i2c_trace_entry_t& e = trace.log[i % I2C_TRACE_LOG];
+      printf("%lu +%luus 0x%02X %u bytes %luus %s\r\n", (unsigned long)i, (unsigned long)((e.start - first) / mhz),
+             e.address, e.bytes, (unsigned long)(e.cycles / mhz), results[e.result]);
+    }
+    return;
+  }
+  uint64_t elapsed = Timebase::now() - trace_since;
+  printf("%lu transactions in %lums\r\n", (unsigned long)trace.logged, (unsigned long)(elapsed / 1000));
+  for(i = 0; i <= trace.used; i++){
+    const i2c_trace_address_t& a = i < trace.used ? trace.address[i] : trace.other;
+    if(i == trace.used && a.transactions == 0) break;
+    uint64_t bus_us = a.bus_cycles / mhz;
+    uint32_t permille = elapsed ? (uint32_t)(bus_us * 1000 / elapsed) : 0;
+    if(a.address == 0xFF) printf("other:");
+    else printf("0x%02X:", a.address);
+    printf(" %lu transactions, %lu bytes, %lu NACKs, %lu errors\r\n", (unsigned long)a.transactions,
+           (unsigned long)a.bytes, (unsigned long)a.nacks, (unsigned long)a.errors);
+    printf("  bus %luus (%lu.%lu%%), waiting %luus, longest %luus\r\n", (unsigned long)bus_us,
+           (unsigned long)(permille / 10), (unsigned long)(permille % 10), (unsigned long)(a.wait_cycles / mhz),
+           (unsigned long)(a.max_cycles / mhz));
+  }
+  }
+#endif
+
+const ShellCommand commands[] = {
+  { "help",   "",                                       0, 0, cmd_help },
+  { "stream", "<n> [period_ms]",                        1, 2, cmd_stream },
+  { "dump",   "[from] [to]",                            0, 2, cmd_dump },
+  { "rate",   "[sensor Hz]",                            0, 2, cmd_rate },
+  { "stats",  "",                                       0, 0, cmd_stats },
+  { "config", "[stream|binary|filter|dma on|off]",      0, 2, cmd_config },
+  { "rule",   "[n off|above|below|rise|fall|both ...]", 0, 6, cmd_rule },
+  { "time",   "",                                       0, 0, cmd_time },
+  { "switch", "[hz] [rounds]",                          0, 2, cmd_switch },
+  { "bench",  "[n]",                                    0, 1, cmd_bench },
+#if I2C_TRACE
+  { "trace",  "[clear|log]",                            0, 1, cmd_trace },
+#endif
+};
+Shell shell(commands, sizeof(commands) / sizeof(commands[0]));
+
+void cmd_help(int argc, char *argv[])
+  {
+  shell.help();
+  }
+
+// Console commands run in their own thread so they never hold up acquisition
+void console(void)
   {
-  hts221_init();
-  HTS221_Calib();
-  printf("SOFT253 simple Temperature Humidity and Pressure Sensor Monitor\n\r");
-  printf("Using the X-NUCLEO-IKS01A1 shield and MBED Libraries\n\r");
-    //printf("%#x\n\r",barometer.read_id());
-    
   while(1) 
     {
       cmd=NULL;
       while(cmd==NULL){cmd=getchar();}
+      // Words end with Enter and go to the shell; capital letters and '?'
+      // typed on an empty line still act at once
+      if(!shell.idle() || !((cmd >= 'A' && cmd <= 'Z') || cmd == '?')){
+        shell.input(cmd);
+        continue;
+      }
       if(cmd=='?'){
         printf("SOFT253 simple Temperature Humidity and Pressure Sensor Monitor\n\r");
         printf("Using the X-NUCLEO-IKS01A1 shield and MBED Libraries\n\r");
+        printf("A: latest reading, S: stream on/off, H/P: HTS221/LPS25H rate, D: data ready mode\n\r");
+        printf("L: dump history, C: clear history, B: binary stream on/off\n\r");
+        printf("O: one-shot duty cycle 1s/10s/60s/off, E: energy budget\n\r");
+        printf("F: filtering on/off, V: motion streaming on/off, I: I2C health, T: time\n\r");
+        printf("Commands, end with Enter:\n\r");
+        shell.help();
       }
       if(cmd=='A'){
-        HTS221_ReadTempHumi(&tempCelsius, &humi);
-        printf("%4.2fC %3.1f%%", tempCelsius, humi);
-        barometer.get();
-        printf(" %6.1f %4.1f\r\n", barometer.pressure(), barometer.temperature());
-        myled = 1; // LED is ON
-        Thread::wait(200); // 200 ms NB 'Thread::wait(int d);' !!! d is in milliseconds! 
-        myled = 0; // LED is OFF
-        Thread::wait(100); // 100 ms
+        print_latest(true);
+        if(motion.running()){
+          printf("Vibration %lumg RMS, %lu blocks, %lu overruns, %lu FIFO overruns\r\n", (unsigned long)vibration,
+                 (unsigned long)motion_blocks, (unsigned long)motion.overruns(), (unsigned long)motion.fifo_overruns());
+        }
+      }
+      if(cmd=='T'){
+        print_time();
+      }
+      if(cmd=='I'){
+        print_health("HTS221", humidity.health());
+        print_health("LPS25H", barometer.health());
+        print_health("LSM6DS0", imu.health());
+        printf("%lu samples lost to failed reads\n\r", (unsigned long)sampler.failed());
+      }
+      if(cmd=='L'){
+        dump_log(0, sample_log.count());
+      }
+      if(cmd=='C'){
+        sample_log.clear();
+      }
+      if(cmd=='V'){
+        if(motion.running()){
+          motion.stop();
+        } else if(!motion.start(LSM6DS0_ODR_476HZ)){
+          printf("LSM6DS0 not found\n\r");
+        }
+      }
+      if(cmd=='S'){
+        streaming = !streaming;
+      }
+      if(cmd=='F'){
+        // Start from a clean filter state each time it is switched on
+        if(!filtering) sample_filter.reset();
+        filtering = !filtering;
+      }
+      if(cmd=='B'){
+        // Framed binary samples for tools/telemetry.py, any other output
+        // in between is dropped by the decoder
+        binary = !binary;
+      }
+      if(cmd=='H'){
+        next_rate(SAMPLE_HTS221);
+      }
+      if(cmd=='P'){
+        next_rate(SAMPLE_LPS25H);
+      }
+      if(cmd=='O'){
+        // Step through the duty cycle periods, then back to continuous sampling
+        int i;
+        DutyBudget budget;
+        duty.budget(&budget);
+        for(i = 0; duty.running() && i < 3 && duty_periods[i] != budget.period_ms; i++);
+        if(duty.running()) i++;
+        if(i < 3){
+          sampler.stop();
+          drdy.stop();
+          drdy_mode = false;
+          duty.start(duty_periods[i]);
+          printf("One-shot every %lus\n\r", (unsigned long)duty_periods[i] / 1000);
+        } else {
+          duty.stop();
+          sampler.start();
+          printf("Continuous\n\r");
+        }
+      }
+      if(cmd=='E'){
+        DutyBudget budget;
+        duty.budget(&budget);
+        printf("Period %lums, conversion %luus, awake %luus\n\r", (unsigned long)budget.period_ms,
+               (unsigned long)budget.convert_us, (unsigned long)budget.awake_us);
+        printf("Sensors %lunC/sample, %lunA average, MCU %luuA average\n\r", (unsigned long)budget.sensor_nc,
+               (unsigned long)budget.sensor_na, (unsigned long)budget.mcu_ua);
+      }
+      if(cmd=='D'){
+        // Toggle between data ready driven and timer driven sampling
+        duty.stop();
+        if(drdy_mode){
+          drdy.stop();
+          drdy_mode = false;
+          sampler.start();
+        } else {
+          sampler.stop();
+          drdy_mode = drdy.start(sampler.rate(SAMPLE_HTS221), sampler.rate(SAMPLE_LPS25H));
+          if(!drdy_mode){
+            printf("Data ready lines not connected\n\r");
+            sampler.start();
+          }
+        }
+      }
+    }
+  }
+
+int main()
+  {
+  // printf and the binary frames return once queued instead of waiting
+  // for the UART; unbuffered, so shell echo still goes out at once
+  freopen("/console", "w", stdout);
+  setbuf(stdout, NULL);
+  freopen("/console", "r", stdin);
+  setbuf(stdin, NULL);
+  bool rtc_ok = Timebase::start();
+  bool sensors_ok = sensors.init();
+  bool imu_ok = imu.init();
+  printf("SOFT253 simple Temperature Humidity and Pressure Sensor Monitor\n\r");
+  printf("Using the X-NUCLEO-IKS01A1 shield and MBED Libraries\n\r");
+  list_sensors();
+  if(!sensors_ok) printf("Sensor missing\n\r");
+  if(!imu_ok) printf("LSM6DS0 missing\n\r");
+  if(!rtc_ok) printf("RTC not set, times are uptime only\n\r");
+    //printf("%#x\n\r",barometer.read_id());
+  memset(latest, 0, sizeof(latest));
+  event_thread.start(callback(&queue, &EventQueue::dispatch_forever));
+  sampler.start();
+  console_thread.start(console);
+  motion_thread.start(motion_consumer);
+
+  // Collect the samples, the LED toggles on each one
+  while(1)
+    {
+      osEvent evt = samples.get();
+      if(evt.status == osEventMail){
+        Sample *sample = (Sample *)evt.value.p;
+        if(filtering && !sample_filter.apply(*sample)){
+          samples.free(sample);     // decimated away
+          continue;
+        }
+        latest_mutex.lock();
+        latest[sample->source] = *sample;
+        if(sample->source == SAMPLE_HTS221){
+          derived.humidity_input(sample->temperature, sample->humidity);
+        } else {
+          derived.pressure_input(sample->pressure);
+        }
+        latest_mutex.unlock();
+        evaluate_rules(sample);
+        if(sample->source == SAMPLE_HTS221){
+          log_sample(sample);
+        }
+        if(binary){
+          send_sample(sample);
+        } else if(streaming || stream_remaining){
+          print_sample(sample);
+        }
+        // The stream count runs down in binary mode too, where every sample
+        // goes out as a frame, so none of it is left to print after 'B'
+        if(stream_remaining) core_util_atomic_decr_u32(&stream_remaining, 1);
+        samples.free(sample);
+        myled = !myled;
       }
     }
   }
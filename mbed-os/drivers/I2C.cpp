@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "drivers/I2C.h"
+#include "platform/mbed_critical.h"
 
 #if DEVICE_I2C
 
@@ -22,6 +23,10 @@ namespace mbed {
 I2C *I2C::_owner = NULL;
 SingletonPtr<PlatformMutex> I2C::_mutex;
 
+#if DEVICE_I2C_ASYNCH && TRANSACTION_QUEUE_SIZE_I2C
+CircularBuffer<Transaction<I2C>, TRANSACTION_QUEUE_SIZE_I2C> I2C::_transaction_buffer;
+#endif
+
 I2C::I2C(PinName sda, PinName scl) :
 #if DEVICE_I2C_ASYNCH
                                      _irq(this), _usage(DMA_USAGE_NEVER),
@@ -123,39 +128,134 @@ void I2C::unlock() {
 #if DEVICE_I2C_ASYNCH
 
 int I2C::transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length, const event_callback_t& callback, int event, bool repeated)
+{
+    int ret = 0;
+
+    lock();
+    if (i2c_active(&_i2c)) {
+        ret = queue_transfer(address, tx_buffer, tx_length, rx_buffer, rx_length, callback, event, repeated);
+    } else {
+        start_transfer(address, tx_buffer, tx_length, rx_buffer, rx_length, callback, event, repeated);
+    }
+    unlock();
+    return ret;
+}
+
+void I2C::abort_transfer(void)
+{
+    lock();
+    i2c_abort_asynch(&_i2c);
+#if TRANSACTION_QUEUE_SIZE_I2C
+    dequeue_transaction();
+#endif
+    unlock();
+}
+
+void I2C::clear_transfer_buffer(void)
+{
+#if TRANSACTION_QUEUE_SIZE_I2C
+    core_util_critical_section_enter();
+    _transaction_buffer.reset();
+    core_util_critical_section_exit();
+#endif
+}
+
+void I2C::abort_all_transfers(void)
+{
+    clear_transfer_buffer();
+    abort_transfer();
+}
+
+int I2C::set_dma_usage(DMAUsage usage)
 {
     lock();
     if (i2c_active(&_i2c)) {
         unlock();
-        return -1; // transaction ongoing
+        return -1;
     }
-    aquire();
+    _usage = usage;
+    unlock();
+    return 0;
+}
+
+int I2C::queue_transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length, const event_callback_t& callback, int event, bool repeated)
+{
+#if TRANSACTION_QUEUE_SIZE_I2C
+    transaction_t t;
+
+    t.tx_buffer = const_cast<char *>(tx_buffer);
+    t.tx_length = tx_length;
+    t.rx_buffer = rx_buffer;
+    t.rx_length = rx_length;
+    t.event = event;
+    t.callback = callback;
+    t.width = 8;
+    t.address = address;
+    t.repeated = repeated;
+    Transaction<I2C> transaction(this, t);
+    if (_transaction_buffer.full()) {
+        return -1; // the buffer is full
+    } else {
+        core_util_critical_section_enter();
+        _transaction_buffer.push(transaction);
+        if (!i2c_active(&_i2c)) {
+            dequeue_transaction();
+        }
+        core_util_critical_section_exit();
+        return 0;
+    }
+#else
+    return -1;
+#endif
+}
 
+void I2C::start_transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length, const event_callback_t& callback, int event, bool repeated)
+{
+    // aquire() without the lock, this may run in interrupt context
+    if (_owner != this) {
+        i2c_frequency(&_i2c, _hz);
+        _owner = this;
+    }
     _callback = callback;
     int stop = (repeated) ? 0 : 1;
     _irq.callback(&I2C::irq_handler_asynch);
     i2c_transfer_asynch(&_i2c, (void *)tx_buffer, tx_length, (void *)rx_buffer, rx_length, address, stop, _irq.entry(), event, _usage);
-    unlock();
-    return 0;
 }
 
-void I2C::abort_transfer(void)
+#if TRANSACTION_QUEUE_SIZE_I2C
+
+void I2C::start_transaction(transaction_t *data)
 {
-    lock();
-    i2c_abort_asynch(&_i2c);
-    unlock();
+    start_transfer(data->address, (const char *)data->tx_buffer, data->tx_length, (char *)data->rx_buffer, data->rx_length, data->callback, data->event, data->repeated);
+}
+
+void I2C::dequeue_transaction()
+{
+    Transaction<I2C> t;
+    if (_transaction_buffer.pop(t)) {
+        I2C* obj = t.get_object();
+        transaction_t* data = t.get_transaction();
+        obj->start_transaction(data);
+    }
 }
 
+#endif
+
 void I2C::irq_handler_asynch(void)
 {
     int event = i2c_irq_handler_asynch(&_i2c);
     if (_callback && event) {
         _callback.call(event);
     }
-
+#if TRANSACTION_QUEUE_SIZE_I2C
+    // The event may be masked out, the peripheral going idle is what ends
+    // a transfer; the callback may already have started the next one
+    if (!i2c_active(&_i2c)) {
+        dequeue_transaction();
+    }
+#endif
 }
 
-
 #endif
 
 } // namespace mbed
@@ -27,7 +27,9 @@
 #if DEVICE_I2C_ASYNCH
 #include "platform/CThunk.h"
 #include "hal/dma_api.h"
+#include "platform/CircularBuffer.h"
 #include "platform/FunctionPointer.h"
+#include "platform/Transaction.h"
 #endif
 
 namespace mbed {
@@ -157,6 +159,12 @@ public:
 #if DEVICE_I2C_ASYNCH
 
     /** Start non-blocking I2C transfer.
+     *
+     * With both buffers given, the write, a repeated start and the read
+     * run as one operation. If the peripheral is busy the transfer is
+     * queued and started from the interrupt that ends the one before, so
+     * transfers of several devices follow each other without bus idle
+     * time. The buffers must stay valid until the callback has run.
      *
      * @param address   8/10 bit I2c slave address
      * @param tx_buffer The TX buffer with data to be transfered
@@ -166,15 +174,77 @@ public:
      * @param event     The logical OR of events to modify
      * @param callback  The event callback function
      * @param repeated Repeated start, true - do not send stop at end
-     * @return Zero if the transfer has started, or -1 if I2C peripheral is busy
+     * @return Zero if the transfer has started or was added to the queue, or -1 if I2C peripheral is busy/buffer is full
      */
     int transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length, const event_callback_t& callback, int event = I2C_EVENT_TRANSFER_COMPLETE, bool repeated = false);
 
-    /** Abort the on-going I2C transfer
+    /** Abort the on-going I2C transfer, and continue with transfer's in the queue if any.
      */
     void abort_transfer();
+
+    /** Clear the transaction buffer
+     */
+    void clear_transfer_buffer();
+
+    /** Clear the transaction buffer and abort on-going transfer.
+     */
+    void abort_all_transfers();
+
+    /** Configure DMA usage suggestion for non-blocking transfers
+     *
+     *  @param usage The usage DMA hint for peripheral
+     *  @return Zero if the usage was set, -1 if a transaction is on-going
+    */
+    int set_dma_usage(DMAUsage usage);
+
 protected:
     void irq_handler_asynch(void);
+
+    /**
+     *
+     * @param address   8/10 bit I2c slave address
+     * @param tx_buffer The TX buffer with data to be transfered
+     * @param tx_length The length of TX buffer in bytes
+     * @param rx_buffer The RX buffer which is used for received data
+     * @param rx_length The length of RX buffer in bytes
+     * @param callback  The event callback function
+     * @param event     The logical OR of events to modify
+     * @param repeated Repeated start, true - do not send stop at end
+     * @return Zero if a transfer was added to the queue, or -1 if the queue is full
+    */
+    int queue_transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length, const event_callback_t& callback, int event, bool repeated);
+
+    /** Configures a callback, i2c peripheral and initiate a new transfer
+     *
+     *  Runs from the completion interrupt for queued transfers, so the bus
+     *  lock is left to the callers in thread context.
+     *
+     * @param address   8/10 bit I2c slave address
+     * @param tx_buffer The TX buffer with data to be transfered
+     * @param tx_length The length of TX buffer in bytes
+     * @param rx_buffer The RX buffer which is used for received data
+     * @param rx_length The length of RX buffer in bytes
+     * @param callback  The event callback function
+     * @param event     The logical OR of events to modify
+     * @param repeated Repeated start, true - do not send stop at end
+    */
+    void start_transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length, const event_callback_t& callback, int event, bool repeated);
+
+#if TRANSACTION_QUEUE_SIZE_I2C
+
+    /** Start a new transaction
+     *
+     *  @param data Transaction data
+    */
+    void start_transaction(transaction_t *data);
+
+    /** Dequeue a transaction
+     *
+    */
+    void dequeue_transaction();
+    static CircularBuffer<Transaction<I2C>, TRANSACTION_QUEUE_SIZE_I2C> _transaction_buffer;
+#endif
+
     event_callback_t _callback;
     CThunk<I2C> _irq;
     DMAUsage _usage;
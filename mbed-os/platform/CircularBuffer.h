@@ -94,6 +94,41 @@ public:
         return full;
     }
 
+    /** Get the number of elements in the buffer
+     *
+     * @return Number of elements stored
+     */
+    CounterType size() {
+        core_util_critical_section_enter();
+        CounterType elements;
+        if (_full) {
+            elements = BufferSize;
+        } else if (_head >= _tail) {
+            elements = _head - _tail;
+        } else {
+            elements = BufferSize - _tail + _head;
+        }
+        core_util_critical_section_exit();
+        return elements;
+    }
+
+    /** Read an element without removing it from the buffer
+     *
+     * @param data Data read from the buffer
+     * @param index Position of the element, 0 being the oldest
+     * @return True if the element exists, false otherwise
+     */
+    bool peek(T& data, CounterType index = 0) {
+        bool data_read = false;
+        core_util_critical_section_enter();
+        if (index < size()) {
+            data = _pool[(_tail + index) % BufferSize];
+            data_read = true;
+        }
+        core_util_critical_section_exit();
+        return data_read;
+    }
+
     /** Reset the buffer
      *
      */
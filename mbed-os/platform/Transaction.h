@@ -33,6 +33,8 @@ typedef struct {
     uint32_t event;            /**< Event for a transaction */
     event_callback_t callback; /**< User's callback */
     uint8_t width;             /**< Buffer's word width (8, 16, 32, 64) */
+    int address;               /**< I2C slave address, not used by SPI */
+    bool repeated;             /**< I2C repeated start, no stop at the end, not used by SPI */
 } transaction_t;
 
 /** Transaction class defines a transaction.
@@ -60,6 +60,9 @@ struct serial_s {
     PinName pin_rx;
 #if DEVICE_SERIAL_ASYNCH
     uint32_t events;
+    uint8_t dma;                /* the transmit in flight runs on DMA */
+    IRQn_Type dma_tx_irq;
+    DMA_HandleTypeDef dma_tx;
 #endif
 #if DEVICE_SERIAL_FC
     uint32_t hw_flow_ctl;
@@ -82,6 +85,17 @@ struct spi_s {
 #endif
 };
 
+#if DEVICE_I2C_ASYNCH
+/*  Interrupt load of the asynchronous transfers */
+#define I2C_IRQ_COUNTS
+typedef struct {
+    uint32_t transfers;         /* started */
+    uint32_t dma_transfers;     /* of which on DMA */
+    uint32_t irqs;              /* I2C event and error interrupts taken */
+    uint32_t dma_irqs;          /* DMA stream interrupts taken */
+} i2c_irq_counts_t;
+#endif
+
 struct i2c_s {
     /*  The 1st 2 members I2CName i2c
      *  and I2C_HandleTypeDef handle should
@@ -107,6 +121,10 @@ struct i2c_s {
     uint32_t address;
     uint8_t stop;
     uint8_t available_events;
+    uint8_t dma;                /* the transfer in flight runs on DMA */
+    IRQn_Type dma_rx_irq;
+    DMA_HandleTypeDef dma_rx;
+    i2c_irq_counts_t counts;
 #endif
 };
 
@@ -43,6 +43,23 @@ extern "C" {
 
 #define I2C_IT_ALL (I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR)
 
+#if DEVICE_I2C_ASYNCH
+/*  DMA1 streams for asynchronous register reads (RM0368 DMA1 request
+ *  mapping). The asynchronous serial transmits of serial_api.c use
+ *  DMA1 stream 6 and DMA2, clear of these.
+ */
+#define I2C_ASYNCH_DMA
+#define I2C1_DMA_RX_STREAM      DMA1_Stream0
+#define I2C1_DMA_RX_CHANNEL     DMA_CHANNEL_1
+#define I2C1_DMA_RX_IRQ         DMA1_Stream0_IRQn
+#define I2C2_DMA_RX_STREAM      DMA1_Stream3
+#define I2C2_DMA_RX_CHANNEL     DMA_CHANNEL_7
+#define I2C2_DMA_RX_IRQ         DMA1_Stream3_IRQn
+#define I2C3_DMA_RX_STREAM      DMA1_Stream2
+#define I2C3_DMA_RX_CHANNEL     DMA_CHANNEL_3
+#define I2C3_DMA_RX_IRQ         DMA1_Stream2_IRQn
+#endif
+
 #endif // DEVICE_I2C
 
 #endif
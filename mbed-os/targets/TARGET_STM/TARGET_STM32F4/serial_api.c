@@ -54,6 +54,24 @@ serial_t stdio_uart;
     #define SERIAL_S(obj) (obj)
 #endif
 
+#if DEVICE_SERIAL_ASYNCH
+/*  DMA streams for asynchronous transmits (RM0368 DMA request mapping),
+ *  clear of the I2C receive streams of i2c_device.h
+ */
+#define SERIAL_ASYNCH_DMA
+#define UART1_DMA_TX_STREAM     DMA2_Stream7
+#define UART1_DMA_TX_CHANNEL    DMA_CHANNEL_4
+#define UART1_DMA_TX_IRQ        DMA2_Stream7_IRQn
+#define UART2_DMA_TX_STREAM     DMA1_Stream6
+#define UART2_DMA_TX_CHANNEL    DMA_CHANNEL_4
+#define UART2_DMA_TX_IRQ        DMA1_Stream6_IRQn
+#if defined(USART6_BASE)
+#define UART6_DMA_TX_STREAM     DMA2_Stream6
+#define UART6_DMA_TX_CHANNEL    DMA_CHANNEL_5
+#define UART6_DMA_TX_IRQ        DMA2_Stream6_IRQn
+#endif
+#endif
+
 
 static void init_uart(serial_t *obj)
 {
@@ -676,6 +694,62 @@ static IRQn_Type serial_get_irq_n(serial_t *obj)
     return irq_n;
 }
 
+#if defined(SERIAL_ASYNCH_DMA)
+/**
+ * Set up the TX stream of this U(S)ART on first use
+ *
+ * @param obj_s The serial object
+ * @return 1 if the stream is ready, 0 if this U(S)ART has none
+ */
+static int serial_dma_tx_init(struct serial_s *obj_s)
+{
+    UART_HandleTypeDef *huart = &uart_handlers[obj_s->index];
+    DMA_HandleTypeDef *hdma = &(obj_s->dma_tx);
+
+    if (huart->hdmatx == hdma) {
+        return 1;
+    }
+    switch (obj_s->uart) {
+        case UART_1:
+            __HAL_RCC_DMA2_CLK_ENABLE();
+            hdma->Instance = UART1_DMA_TX_STREAM;
+            hdma->Init.Channel = UART1_DMA_TX_CHANNEL;
+            obj_s->dma_tx_irq = UART1_DMA_TX_IRQ;
+            break;
+        case UART_2:
+            __HAL_RCC_DMA1_CLK_ENABLE();
+            hdma->Instance = UART2_DMA_TX_STREAM;
+            hdma->Init.Channel = UART2_DMA_TX_CHANNEL;
+            obj_s->dma_tx_irq = UART2_DMA_TX_IRQ;
+            break;
+#if defined(UART6_DMA_TX_STREAM)
+        case UART_6:
+            __HAL_RCC_DMA2_CLK_ENABLE();
+            hdma->Instance = UART6_DMA_TX_STREAM;
+            hdma->Init.Channel = UART6_DMA_TX_CHANNEL;
+            obj_s->dma_tx_irq = UART6_DMA_TX_IRQ;
+            break;
+#endif
+        default:
+            return 0;
+    }
+
+    hdma->Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = DMA_PRIORITY_LOW;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(hdma) != HAL_OK) {
+        return 0;
+    }
+    __HAL_LINKDMA(huart, hdmatx, *hdma);
+    return 1;
+}
+#endif // SERIAL_ASYNCH_DMA
+
 /******************************************************************************
  * MBED API FUNCTIONS
  ******************************************************************************/
@@ -695,9 +769,6 @@ static IRQn_Type serial_get_irq_n(serial_t *obj)
  */
 int serial_tx_asynch(serial_t *obj, const void *tx, size_t tx_length, uint8_t tx_width, uint32_t handler, uint32_t event, DMAUsage hint)
 {    
-    // TODO: DMA usage is currently ignored
-    (void) hint;
-    
     // Check buffer is ok
     MBED_ASSERT(tx != (void*)0);
     MBED_ASSERT(tx_width == 8); // support only 8b width
@@ -724,6 +795,25 @@ int serial_tx_asynch(serial_t *obj, const void *tx, size_t tx_length, uint8_t tx
     NVIC_SetVector(irq_n, (uint32_t)handler);
     NVIC_EnableIRQ(irq_n);
 
+    obj_s->dma = 0;
+#if defined(SERIAL_ASYNCH_DMA)
+    // The stream moves the data, its completion arms the TC interrupt which
+    // ends the transfer as in interrupt mode
+    if ((hint != DMA_USAGE_NEVER) && serial_dma_tx_init(obj_s)) {
+        obj_s->dma = 1;
+        NVIC_SetVector(obj_s->dma_tx_irq, (uint32_t)handler);
+        NVIC_SetPriority(obj_s->dma_tx_irq, 1);
+        NVIC_EnableIRQ(obj_s->dma_tx_irq);
+        if (HAL_UART_Transmit_DMA(huart, (uint8_t*)tx, tx_length) != HAL_OK) {
+            obj_s->dma = 0;
+            return 0;
+        }
+        return tx_length;
+    }
+#else
+    (void) hint;
+#endif
+
     // the following function will enable UART_IT_TXE and error interrupts
     if (HAL_UART_Transmit_IT(huart, (uint8_t*)tx, tx_length) != HAL_OK) {
         return 0;
@@ -842,6 +932,24 @@ int serial_irq_handler_asynch(serial_t *obj)
     volatile int return_event = 0;
     uint8_t *buf = (uint8_t*)(obj->rx_buff.buffer);
     uint8_t i = 0;
+
+#if defined(SERIAL_ASYNCH_DMA)
+    // DMA stream vector: the end of the stream only arms TC
+    if (obj_s->dma && ((IRQn_Type)((int)__get_IPSR() - 16) == obj_s->dma_tx_irq)) {
+        HAL_DMA_IRQHandler(&(obj_s->dma_tx));
+        return 0;
+    }
+#endif
+
+    // The asynchronous transmit took over the vector of serial_irq_set():
+    // serve its RX interrupt while no asynchronous reception runs, before
+    // HAL_UART_IRQHandler() would leave RXNE set
+    if ((huart->RxState != HAL_UART_STATE_BUSY_RX) && (serial_irq_ids[obj_s->index] != 0)) {
+        if ((__HAL_UART_GET_FLAG(huart, UART_FLAG_RXNE) != RESET) &&
+                (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_RXNE) != RESET)) {
+            irq_handler(serial_irq_ids[obj_s->index], RxIrq);
+        }
+    }
     
     // TX PART:
     if (__HAL_UART_GET_FLAG(huart, UART_FLAG_TC) != RESET) {
@@ -919,6 +1027,14 @@ void serial_tx_abort_asynch(serial_t *obj)
     
     __HAL_UART_DISABLE_IT(huart, UART_IT_TC);
     __HAL_UART_DISABLE_IT(huart, UART_IT_TXE);
+
+#if defined(SERIAL_ASYNCH_DMA)
+    if (obj_s->dma) {
+        CLEAR_BIT(huart->Instance->CR3, USART_CR3_DMAT);
+        HAL_DMA_Abort(&(obj_s->dma_tx));
+        obj_s->dma = 0;
+    }
+#endif
     
     // clear flags
     __HAL_UART_CLEAR_FLAG(huart, UART_FLAG_TC);
@@ -35,10 +35,14 @@
 
 #if DEVICE_I2C
 
+#include <string.h>
 #include "cmsis.h"
 #include "pinmap.h"
+#include "gpio_api.h"
 #include "PeripheralPins.h"
 #include "i2c_device.h" // family specific defines
+#include "i2c_trace.h"
+#include "i2c_timing.h"
 
 #ifndef DEBUG_STDIO
 #   define DEBUG_STDIO 0
@@ -255,6 +259,92 @@ void i2c_sw_reset(i2c_t *obj)
     handle->Instance->CR1 |=  I2C_CR1_PE;
 }
 
+/*  Bus recovery.
+ *  A slave that lost clocks in the middle of a byte keeps SDA low until it
+ *  has clocked the rest of it out, and the IP then sees the bus busy for
+ *  ever. Take the pins back as open drain GPIOs, clock SCL until the slave
+ *  releases SDA (9 pulses at most), generate a STOP and re-init the IP,
+ *  which goes through i2c_hw_reset(). A BUSY flag still set after that is
+ *  given a SW reset as well.
+ *  Returns 0 if the bus was idle and nothing was done, 1 if it was
+ *  recovered, -1 if SDA is still held low.
+ */
+#define RECOVERY_PULSES     9
+#define RECOVERY_HALF_US    5   // 100 kHz
+
+extern GPIO_TypeDef *Set_GPIO_Clock(uint32_t port_idx);
+
+/*  Level of a pin whatever its mode; IDR follows the pad in AF mode too,
+ *  so the pins stay with the IP while they are sampled.
+ */
+static int i2c_line_high(PinName pin)
+{
+    GPIO_TypeDef *gpio = Set_GPIO_Clock(STM_PORT(pin));
+
+    return (gpio->IDR & (1U << STM_PIN(pin))) != 0;
+}
+
+int i2c_bus_recover(i2c_t *obj)
+{
+    struct i2c_s *obj_s = I2C_S(obj);
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
+    gpio_t sda, scl;
+    int i;
+
+    handle->Instance = (I2C_TypeDef *)(obj_s->i2c);
+    if (i2c_line_high(obj_s->sda) && i2c_line_high(obj_s->scl) &&
+        !__HAL_I2C_GET_FLAG(handle, I2C_FLAG_BUSY)) {
+        return 0;
+    }
+
+    // From here on the pins are GPIOs until i2c_init() below takes them back
+    gpio_init(&sda, obj_s->sda);
+    gpio_init(&scl, obj_s->scl);
+
+    // Output latches high before the switch so the lines never see a drive
+    gpio_write(&sda, 1);
+    gpio_write(&scl, 1);
+    pin_function(obj_s->sda, STM_PIN_DATA(STM_MODE_OUTPUT_OD, GPIO_PULLUP, 0));
+    pin_function(obj_s->scl, STM_PIN_DATA(STM_MODE_OUTPUT_OD, GPIO_PULLUP, 0));
+    wait_us(RECOVERY_HALF_US);
+
+    for (i = 0; (i < RECOVERY_PULSES) && !gpio_read(&sda); i++) {
+        gpio_write(&scl, 0);
+        wait_us(RECOVERY_HALF_US);
+        gpio_write(&scl, 1);
+        wait_us(RECOVERY_HALF_US);
+    }
+
+    // STOP: SDA low to high while SCL is high
+    gpio_write(&scl, 0);
+    gpio_write(&sda, 0);
+    wait_us(RECOVERY_HALF_US);
+    gpio_write(&scl, 1);
+    wait_us(RECOVERY_HALF_US);
+    gpio_write(&sda, 1);
+    wait_us(RECOVERY_HALF_US);
+
+    // Give the pins back to the IP, with its registers reset
+    i2c_init(obj, obj_s->sda, obj_s->scl);
+    if (__HAL_I2C_GET_FLAG(handle, I2C_FLAG_BUSY)) {
+        i2c_sw_reset(obj);
+    }
+
+    return i2c_line_high(obj_s->sda) ? 1 : -1;
+}
+
+/*  BUSY flag of the IP: set while it sees the bus between a START and a
+ *  STOP, so still set after a failed transfer when the bus is stuck.
+ */
+int i2c_bus_busy(i2c_t *obj)
+{
+    struct i2c_s *obj_s = I2C_S(obj);
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
+
+    handle->Instance = (I2C_TypeDef *)(obj_s->i2c);
+    return __HAL_I2C_GET_FLAG(handle, I2C_FLAG_BUSY) ? 1 : 0;
+}
+
 void i2c_init(i2c_t *obj, PinName sda, PinName scl) {
 
     struct i2c_s *obj_s = I2C_S(obj);
@@ -363,6 +453,74 @@ void i2c_init(i2c_t *obj, PinName sda, PinName scl) {
 #endif
 }
 
+/*  Timing cache, see i2c_timing.h. i2c_init() resets the IP, which clears
+ *  PE, so the first configuration after it always goes through
+ *  HAL_I2C_Init().
+ */
+static void i2c_timing_store(struct i2c_s *obj_s, int hz) {
+    I2C_TypeDef *i2c = obj_s->handle.Instance;
+    i2c_timing_t timing;
+
+    timing.hz = hz;
+#ifdef I2C_IP_VERSION_V1
+    timing.pclk = HAL_RCC_GetPCLK1Freq();
+    timing.ccr = i2c->CCR;
+    timing.trise = i2c->TRISE;
+#endif
+#ifdef I2C_IP_VERSION_V2
+    timing.timingr = i2c->TIMINGR;
+#endif
+    i2c_timing_keep(obj_s->index, &timing);
+}
+
+/*  Returns 1 if the cached timing of hz was applied */
+static int i2c_timing_load(struct i2c_s *obj_s, int hz) {
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
+    I2C_TypeDef *i2c = handle->Instance;
+    const i2c_timing_t *timing;
+
+    if (!(i2c->CR1 & I2C_CR1_PE) || (handle->State != HAL_I2C_STATE_READY)) {
+        return 0;
+    }
+#if DEVICE_I2CSLAVE
+    /* PE off would drop the slave's acknowledge setting */
+    if (obj_s->slave) {
+        return 0;
+    }
+#endif
+    timing = i2c_timing_find(obj_s->index, hz);
+    if (timing == NULL) {
+        return 0;
+    }
+
+#ifdef I2C_IP_VERSION_V1
+    if (timing->pclk != HAL_RCC_GetPCLK1Freq()) {
+        return 0;
+    }
+    __HAL_I2C_DISABLE(handle);
+    i2c->TRISE = timing->trise;
+    i2c->CCR = timing->ccr;
+    __HAL_I2C_ENABLE(handle);
+    handle->Init.ClockSpeed = hz;
+#endif
+#ifdef I2C_IP_VERSION_V2
+    __HAL_I2C_DISABLE(handle);
+    i2c->TIMINGR = timing->timingr;
+    __HAL_I2C_ENABLE(handle);
+    handle->Init.Timing = timing->timingr;
+#endif
+    return 1;
+}
+
+/*  Forget the cached timings, the next frequency change of each does a
+ *  full HAL_I2C_Init() again. For measuring what the cache saves.
+ */
+void i2c_timing_flush(i2c_t *obj) {
+    struct i2c_s *obj_s = I2C_S(obj);
+
+    i2c_timing_clear(obj_s->index);
+}
+
 void i2c_frequency(i2c_t *obj, int hz)
 {
     int timeout;
@@ -373,6 +531,18 @@ void i2c_frequency(i2c_t *obj, int hz)
     timeout = BYTE_TIMEOUT;
     while ((__HAL_I2C_GET_FLAG(handle, I2C_FLAG_BUSY)) && (--timeout != 0));
 
+#ifdef I2C_IP_VERSION_V1
+    /*  Fast mode plus (1 MHz) needs the I2C IP V2, V1 tops out at fast mode */
+    if (hz > 400000) {
+        hz = 400000;
+    }
+#endif
+
+    if (i2c_timing_load(obj_s, hz)) {
+        obj_s->hz = hz;
+        return;
+    }
+
 #ifdef I2C_IP_VERSION_V1
     handle->Init.ClockSpeed      = hz;
     handle->Init.DutyCycle       = I2C_DUTYCYCLE_2;
@@ -442,6 +612,7 @@ void i2c_frequency(i2c_t *obj, int hz)
     handle->Init.OwnAddress1     = 0;
     handle->Init.OwnAddress2     = 0;
     HAL_I2C_Init(handle);
+    i2c_timing_store(obj_s, hz);
 
     /*  store frequency for timeout computation */
     obj_s->hz = hz;
@@ -771,10 +942,12 @@ int i2c_read(i2c_t *obj, int address, char *data, int length, int stop) {
      */
     i2c_ev_err_enable(obj, i2c_get_irq_handler(obj));
 
+    I2C_TRACE_BEGIN(obj_s->index);
     ret = HAL_I2C_Master_Sequential_Receive_IT(handle, address, (uint8_t *) data, length, obj_s->XferOperation);
 
     if(ret == HAL_OK) {
         timeout = BYTE_TIMEOUT_US * (length + 1);
+        I2C_TRACE_WAIT(obj_s->index);
         /*  transfer started : wait completion or timeout */
         while(!(obj_s->event & I2C_EVENT_ALL) && (--timeout != 0)) {
             wait_us(1);
@@ -793,6 +966,8 @@ int i2c_read(i2c_t *obj, int address, char *data, int length, int stop) {
         DEBUG_PRINTF("ERROR in i2c_read:%d\r\n", ret);
     }
 
+    I2C_TRACE_END(obj_s->index, address, (count > 0) ? count : 0, obj_s->event);
+
     return count;
 }
 
@@ -827,10 +1002,12 @@ int i2c_write(i2c_t *obj, int address, const char *data, int length, int stop) {
 
     i2c_ev_err_enable(obj, i2c_get_irq_handler(obj));
 
+    I2C_TRACE_BEGIN(obj_s->index);
     ret = HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t *) data, length, obj_s->XferOperation); 
 
     if(ret == HAL_OK) {
         timeout = BYTE_TIMEOUT_US * (length + 1);
+        I2C_TRACE_WAIT(obj_s->index);
         /*  transfer started : wait completion or timeout */
         while(!(obj_s->event & I2C_EVENT_ALL) && (--timeout != 0)) {
             wait_us(1);
@@ -849,6 +1026,8 @@ int i2c_write(i2c_t *obj, int address, const char *data, int length, int stop) {
         DEBUG_PRINTF("ERROR in i2c_read\r\n");
     }
 
+    I2C_TRACE_END(obj_s->index, address, (count > 0) ? count : 0, obj_s->event);
+
     return count;
 }
 
@@ -898,6 +1077,7 @@ void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
 #endif
 
     DEBUG_PRINTF("HAL_I2C_ErrorCallback:%d, index=%d\r\n", (int) hi2c->ErrorCode, obj_s->index);
+    I2C_TRACE_ERROR(obj_s->index, hi2c->ErrorCode);
 
     /* re-init IP to try and get back in a working state */
     i2c_init(obj, obj_s->sda, obj_s->scl);
@@ -1066,13 +1246,160 @@ void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c){
     obj_s->event = I2C_EVENT_ERROR;
 }
 
-void i2c_transfer_asynch(i2c_t *obj, const void *tx, size_t tx_length, void *rx, size_t rx_length, uint32_t address, uint32_t stop, uint32_t handler, uint32_t event, DMAUsage hint) {
+/*  A transfer the HAL refused to start, e.g. HAL_BUSY with the BUSY flag
+ *  stuck, raises no interrupt of its own and would never end: end it from
+ *  the interrupt like any other transfer, with the given event */
+static void i2c_start_failed(struct i2c_s *obj_s, uint32_t event) {
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
 
-    // TODO: DMA usage is currently ignored by this way
-    (void) hint;
+    handle->State = HAL_I2C_STATE_READY;
+    handle->Mode = HAL_I2C_MODE_NONE;
+    obj_s->event = event;
+    NVIC_SetPendingIRQ(obj_s->event_i2cIRQ);
+}
+
+#if defined(I2C_ASYNCH_DMA)
+/*  Register reads of this many bytes or more go to DMA with
+ *  DMA_USAGE_OPPORTUNISTIC. The register address phase is polled before
+ *  the DMA starts, which only pays off over a longer read.
+ */
+#define I2C_DMA_MIN_LENGTH  8
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    /* Get object ptr based on handler ptr */
+    i2c_t *obj = get_i2c_obj(hi2c);
+    struct i2c_s *obj_s = I2C_S(obj);
+
+    /* Set event flag */
+    obj_s->event = I2C_EVENT_TRANSFER_COMPLETE;
+}
+
+/*  Set up the RX stream of this I2C on first use, 0 if it has none */
+static int i2c_dma_rx_init(struct i2c_s *obj_s) {
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
+    DMA_HandleTypeDef *hdma = &(obj_s->dma_rx);
+
+    if (handle->hdmarx == hdma) {
+        return 1;
+    }
+    switch (obj_s->i2c) {
+#if defined(I2C1_DMA_RX_STREAM)
+        case I2C_1:
+            hdma->Instance = I2C1_DMA_RX_STREAM;
+            hdma->Init.Channel = I2C1_DMA_RX_CHANNEL;
+            obj_s->dma_rx_irq = I2C1_DMA_RX_IRQ;
+            break;
+#endif
+#if defined(I2C2_DMA_RX_STREAM)
+        case I2C_2:
+            hdma->Instance = I2C2_DMA_RX_STREAM;
+            hdma->Init.Channel = I2C2_DMA_RX_CHANNEL;
+            obj_s->dma_rx_irq = I2C2_DMA_RX_IRQ;
+            break;
+#endif
+#if defined(I2C3_DMA_RX_STREAM)
+        case I2C_3:
+            hdma->Instance = I2C3_DMA_RX_STREAM;
+            hdma->Init.Channel = I2C3_DMA_RX_CHANNEL;
+            obj_s->dma_rx_irq = I2C3_DMA_RX_IRQ;
+            break;
+#endif
+        default:
+            return 0;
+    }
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdma->Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = DMA_PRIORITY_LOW;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(hdma) != HAL_OK) {
+        return 0;
+    }
+    __HAL_LINKDMA(handle, hdmarx, *hdma);
+    return 1;
+}
+
+/*  DMA covers a register read: a 1 or 2 byte register address, a repeated
+ *  start and a read of at least 2 bytes, with a STOP at the end and the
+ *  bus not held by an earlier transfer.
+ *
+ *  HAL_I2C_Mem_Read_DMA polls the START, address, register address and
+ *  repeated START before the stream takes over, about 30 bit times: 75us
+ *  at 400kHz, 300us at 100kHz. That is only done from thread context. A
+ *  queued transfer is started from the completion interrupt of the one
+ *  before it, and there it runs interrupt driven instead, so no ISR spins
+ *  on the bus.
+ */
+static int i2c_dma_fits(struct i2c_s *obj_s, size_t tx_length, size_t rx_length, uint32_t stop, DMAUsage hint) {
+    if ((hint == DMA_USAGE_NEVER) || !stop) {
+        return 0;
+    }
+    if (__get_IPSR() != 0) {
+        return 0;
+    }
+    if ((tx_length < 1) || (tx_length > 2) || (rx_length < 2) || (rx_length > 0xFFFF)) {
+        return 0;
+    }
+    if ((hint == DMA_USAGE_OPPORTUNISTIC) && (rx_length < I2C_DMA_MIN_LENGTH)) {
+        return 0;
+    }
+    if ((obj_s->XferOperation != I2C_FIRST_AND_LAST_FRAME) &&
+        (obj_s->XferOperation != I2C_LAST_FRAME)) {
+        return 0;
+    }
+    return i2c_dma_rx_init(obj_s);
+}
+
+/*  Leave DMA mode once a transfer has ended. The HAL does not stop the
+ *  stream after an I2C error, so it is aborted here.
+ */
+static void i2c_dma_end(struct i2c_s *obj_s) {
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
+
+    if (obj_s->dma_rx.State != HAL_DMA_STATE_READY) {
+        HAL_DMA_Abort(&(obj_s->dma_rx));
+    }
+    handle->Instance->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+    HAL_NVIC_DisableIRQ(obj_s->dma_rx_irq);
+    obj_s->dma = 0;
+}
+
+static void i2c_transfer_dma(i2c_t *obj, const uint8_t *tx, size_t tx_length, void *rx, size_t rx_length, uint32_t address, uint32_t handler) {
+    struct i2c_s *obj_s = I2C_S(obj);
+    I2C_HandleTypeDef *handle = &(obj_s->handle);
+    uint16_t reg = (tx_length == 2) ? ((tx[0] << 8) | tx[1]) : tx[0];
+    uint16_t reg_size = (tx_length == 2) ? I2C_MEMADD_SIZE_16BIT : I2C_MEMADD_SIZE_8BIT;
+
+    obj_s->dma = 1;
+    obj_s->XferOperation = I2C_FIRST_AND_LAST_FRAME;
+#if defined(I2C_IRQ_COUNTS)
+    obj_s->counts.dma_transfers++;
+#endif
+
+    /* The stream ends the transfer, on the same handler as the I2C */
+    NVIC_SetVector(obj_s->dma_rx_irq, handler);
+    NVIC_SetPriority(obj_s->dma_rx_irq, 2);
+    NVIC_EnableIRQ(obj_s->dma_rx_irq);
+
+    if (HAL_I2C_Mem_Read_DMA(handle, address, reg, reg_size, (uint8_t *)rx, rx_length) != HAL_OK) {
+        /* Failed in the polled address phase: report it from the
+         * interrupt like any other end of transfer */
+        i2c_dma_end(obj_s);
+        i2c_start_failed(obj_s, (handle->ErrorCode & HAL_I2C_ERROR_AF) ? I2C_EVENT_ERROR_NO_SLAVE : I2C_EVENT_ERROR);
+    }
+}
+#endif // I2C_ASYNCH_DMA
+
+void i2c_transfer_asynch(i2c_t *obj, const void *tx, size_t tx_length, void *rx, size_t rx_length, uint32_t address, uint32_t stop, uint32_t handler, uint32_t event, DMAUsage hint) {
 
     struct i2c_s *obj_s = I2C_S(obj);
     I2C_HandleTypeDef *handle = &(obj_s->handle);
+    HAL_StatusTypeDef status = HAL_OK;
 
     /* Update object */
     obj->tx_buff.buffer = (void *)tx;
@@ -1092,6 +1419,19 @@ void i2c_transfer_asynch(i2c_t *obj, const void *tx, size_t tx_length, void *rx,
 
     i2c_ev_err_enable(obj, handler);
 
+#if defined(I2C_IRQ_COUNTS)
+    obj_s->counts.transfers++;
+#endif
+    I2C_TRACE_BEGIN(obj_s->index);
+#if defined(I2C_ASYNCH_DMA)
+    if (i2c_dma_fits(obj_s, tx_length, rx_length, stop, hint)) {
+        i2c_transfer_dma(obj, (const uint8_t *)tx, tx_length, rx, rx_length, address, handler);
+        return;
+    }
+#else
+    (void) hint;
+#endif
+
     /* Set operation step depending if stop sending required or not */
     if ((tx_length && !rx_length) || (!tx_length && rx_length)) {
         if ((obj_s->XferOperation == I2C_FIRST_AND_LAST_FRAME) ||
@@ -1109,22 +1449,27 @@ void i2c_transfer_asynch(i2c_t *obj, const void *tx, size_t tx_length, void *rx,
         }
 
         if (tx_length > 0) {
-            HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t*)tx, tx_length, obj_s->XferOperation);
+            status = HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t*)tx, tx_length, obj_s->XferOperation);
         }
         if (rx_length > 0) {
-            HAL_I2C_Master_Sequential_Receive_IT(handle, address, (uint8_t*)rx, rx_length, obj_s->XferOperation);
+            status = HAL_I2C_Master_Sequential_Receive_IT(handle, address, (uint8_t*)rx, rx_length, obj_s->XferOperation);
         }
     }
     else if (tx_length && rx_length) {
         /* Two steps operation, don't modify XferOperation, keep it for next step */
         if ((obj_s->XferOperation == I2C_FIRST_AND_LAST_FRAME) ||
             (obj_s->XferOperation == I2C_LAST_FRAME)) {
-                HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t*)tx, tx_length, I2C_FIRST_FRAME);
+                status = HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t*)tx, tx_length, I2C_FIRST_FRAME);
         } else if ((obj_s->XferOperation == I2C_FIRST_FRAME) ||
             (obj_s->XferOperation == I2C_NEXT_FRAME)) {
-                HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t*)tx, tx_length, I2C_NEXT_FRAME);
+                status = HAL_I2C_Master_Sequential_Transmit_IT(handle, address, (uint8_t*)tx, tx_length, I2C_NEXT_FRAME);
         }
     }
+
+    if (status != HAL_OK) {
+        /* Not started, e.g. the bus still busy: a bus fault, not a NACK */
+        i2c_start_failed(obj_s, I2C_EVENT_ERROR);
+    }
 }
 
 
@@ -1133,9 +1478,39 @@ uint32_t i2c_irq_handler_asynch(i2c_t *obj) {
     struct i2c_s *obj_s = I2C_S(obj);
     I2C_HandleTypeDef *handle = &(obj_s->handle);
 
+#if defined(I2C_ASYNCH_DMA)
+    /* One handler serves the I2C event, error and DMA stream vectors */
+    IRQn_Type irq = (IRQn_Type)((int)__get_IPSR() - 16);
+
+    if (obj_s->dma && (irq == obj_s->dma_rx_irq)) {
+#if defined(I2C_IRQ_COUNTS)
+        obj_s->counts.dma_irqs++;
+#endif
+        HAL_DMA_IRQHandler(&(obj_s->dma_rx));
+    } else
+#endif
+    {
+#if defined(I2C_IRQ_COUNTS)
+        obj_s->counts.irqs++;
+#endif
+    }
+
     HAL_I2C_EV_IRQHandler(handle);
     HAL_I2C_ER_IRQHandler(handle);
 
+#if defined(I2C_ASYNCH_DMA)
+    if (obj_s->dma && obj_s->event) {
+        i2c_dma_end(obj_s);
+    }
+#endif
+#if I2C_TRACE
+    if (obj_s->event) {
+        I2C_TRACE_END(obj_s->index, obj_s->address,
+                      (obj_s->event == I2C_EVENT_TRANSFER_COMPLETE) ? obj->tx_buff.length + obj->rx_buff.length : 0,
+                      obj_s->event);
+    }
+#endif
+
      /*  Return I2C event status */
     return (obj_s->event & obj_s->available_events);
 }
@@ -1161,6 +1536,18 @@ void i2c_abort_asynch(i2c_t *obj) {
     /* Abort HAL requires DevAddress, but is not used. Use Dummy */
     uint16_t Dummy_DevAddress = 0x00;
 
+#if defined(I2C_ASYNCH_DMA)
+    /* A register read on DMA is not a master mode transfer for the HAL */
+    if (obj_s->dma) {
+        i2c_dma_end(obj_s);
+        handle->Instance->CR1 |= I2C_CR1_STOP;
+        __HAL_I2C_DISABLE_IT(handle, I2C_IT_ALL);
+        handle->State = HAL_I2C_STATE_READY;
+        handle->Mode = HAL_I2C_MODE_NONE;
+        return;
+    }
+#endif
+
     HAL_I2C_Master_Abort_IT(handle, Dummy_DevAddress);
 }
 
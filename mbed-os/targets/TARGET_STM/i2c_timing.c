@@ -0,0 +1,34 @@
+#include "i2c_timing.h"
+
+#include <string.h>
+
+static i2c_timing_t timings[I2C_TIMING_BUSES][I2C_TIMING_CACHE];
+static uint8_t timing_next[I2C_TIMING_BUSES];   /* entry to replace next */
+
+static int timing_index(int bus, int hz) {
+    int i;
+
+    for (i = 0; (i < I2C_TIMING_CACHE) && (timings[bus][i].hz != hz); i++);
+    return i;
+}
+
+const i2c_timing_t *i2c_timing_find(int bus, int hz) {
+    int i = timing_index(bus, hz);
+
+    return i < I2C_TIMING_CACHE ? &timings[bus][i] : NULL;
+}
+
+void i2c_timing_keep(int bus, const i2c_timing_t *timing) {
+    int i = timing_index(bus, timing->hz);
+
+    if (i == I2C_TIMING_CACHE) {
+        i = timing_next[bus];
+        timing_next[bus] = (i + 1) % I2C_TIMING_CACHE;
+    }
+    timings[bus][i] = *timing;
+}
+
+void i2c_timing_clear(int bus) {
+    memset(timings[bus], 0, sizeof(timings[0]));
+    timing_next[bus] = 0;
+}
@@ -0,0 +1,63 @@
+/* I2C timing cache
+ *
+ * The timing registers HAL_I2C_Init() computes for a frequency are kept,
+ * the last I2C_TIMING_CACHE frequencies of each I2C, so switching back to
+ * one of them on a running master is a register write with PE off rather
+ * than a full re-init; see i2c_frequency() in i2c_api.c. Keeping a new
+ * frequency with the cache full replaces the one kept the longest ago.
+ *
+ * Only the bookkeeping is here, no register access, so the host tool
+ * tools/i2c_timing_test.cpp checks it against a model of the HAL.
+ */
+#ifndef MBED_I2C_TIMING_H
+#define MBED_I2C_TIMING_H
+
+#include <stdint.h>
+#include "i2c_device.h" // family specific defines
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_TIMING_CACHE        4       /* frequencies kept per I2C */
+#define I2C_TIMING_BUSES        5       /* I2C_NUM of i2c_api.c */
+
+typedef struct {
+    int hz;                             /* 0 for an unused entry */
+#ifdef I2C_IP_VERSION_V1
+    uint32_t pclk;                      /* CCR and TRISE are counted in APB clocks */
+    uint32_t ccr;
+    uint32_t trise;
+#endif
+#ifdef I2C_IP_VERSION_V2
+    uint32_t timingr;
+#endif
+} i2c_timing_t;
+
+/** Look up the timing kept for a frequency
+ *
+ * @param bus I2C index, 0 to I2C_TIMING_BUSES - 1
+ * @param hz  bus clock, > 0
+ * @return the entry, NULL if hz is not kept
+ */
+const i2c_timing_t *i2c_timing_find(int bus, int hz);
+
+/** Keep a timing, in place of the one kept for the same frequency if any,
+ *  else of the oldest entry
+ *
+ * @param bus    I2C index
+ * @param timing registers as HAL_I2C_Init() set them for timing->hz
+ */
+void i2c_timing_keep(int bus, const i2c_timing_t *timing);
+
+/** Forget the timings of an I2C
+ *
+ * @param bus I2C index
+ */
+void i2c_timing_clear(int bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,123 @@
+#include "i2c_trace.h"
+
+#if I2C_TRACE
+
+#include <string.h>
+#include "cmsis.h"
+#include "i2c_api.h"
+#include "platform/mbed_critical.h"
+
+/*  Transaction in flight on each bus */
+typedef struct {
+    uint32_t start;
+    uint32_t wait;                      /* start of the spin, valid with waiting */
+    uint32_t error;                     /* HAL error code */
+    uint8_t active;
+    uint8_t waiting;
+} i2c_trace_bus_t;
+
+static i2c_trace_t trace;
+static i2c_trace_bus_t buses[I2C_TRACE_BUSES];
+
+static uint32_t cycle_count(void) {
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+void i2c_trace_begin(int bus) {
+    buses[bus].error = 0;
+    buses[bus].waiting = 0;
+    buses[bus].start = cycle_count();
+    buses[bus].active = 1;
+}
+
+void i2c_trace_wait(int bus) {
+    buses[bus].wait = DWT->CYCCNT;
+    buses[bus].waiting = 1;
+}
+
+void i2c_trace_error(int bus, uint32_t error) {
+    buses[bus].error = error;
+}
+
+void i2c_trace_end(int bus, int address, int bytes, int event) {
+    uint32_t now = DWT->CYCCNT;
+    i2c_trace_bus_t *b = &buses[bus];
+    uint32_t cycles = now - b->start;
+    i2c_trace_address_t *slot;
+    i2c_trace_entry_t *entry;
+    uint32_t i;
+    int result;
+
+    /* An interrupt after the end of an asynchronous transfer */
+    if (!b->active) {
+        return;
+    }
+    b->active = 0;
+
+    if (event == I2C_EVENT_TRANSFER_COMPLETE) {
+        result = I2C_TRACE_OK;
+    } else if ((event & I2C_EVENT_ERROR_NO_SLAVE) || (b->error & HAL_I2C_ERROR_AF)) {
+        result = I2C_TRACE_NACK;
+    } else {
+        result = I2C_TRACE_ERROR;
+    }
+    address &= 0xFE;
+
+    core_util_critical_section_enter();
+
+    for (i = 0; (i < trace.used) && (trace.address[i].address != address); i++);
+    if (i < trace.used) {
+        slot = &trace.address[i];
+    } else if (trace.used < I2C_TRACE_ADDRESSES) {
+        trace.used++;
+        slot = &trace.address[i];
+        slot->address = address;
+    } else {
+        /* The table is full: the slaves in it keep their own counts */
+        slot = &trace.other;
+        slot->address = 0xFF;
+    }
+    slot->transactions++;
+    slot->bytes += bytes;
+    if (result == I2C_TRACE_NACK) {
+        slot->nacks++;
+    } else if (result == I2C_TRACE_ERROR) {
+        slot->errors++;
+    }
+    slot->bus_cycles += cycles;
+    if (b->waiting) {
+        slot->wait_cycles += now - b->wait;
+    }
+    if (cycles > slot->max_cycles) {
+        slot->max_cycles = cycles;
+    }
+
+    entry = &trace.log[trace.logged % I2C_TRACE_LOG];
+    entry->start = b->start;
+    entry->cycles = cycles;
+    entry->bytes = bytes;
+    entry->address = address;
+    entry->result = result;
+    trace.logged++;
+
+    core_util_critical_section_exit();
+}
+
+void i2c_trace_read(i2c_trace_t *copy) {
+    core_util_critical_section_enter();
+    memcpy(copy, &trace, sizeof(trace));
+    core_util_critical_section_exit();
+}
+
+void i2c_trace_clear(void) {
+    core_util_critical_section_enter();
+    memset(&trace, 0, sizeof(trace));
+    core_util_critical_section_exit();
+}
+
+#endif // I2C_TRACE
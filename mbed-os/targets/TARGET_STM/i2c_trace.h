@@ -0,0 +1,122 @@
+/* I2C bus profiler and transaction tracer
+ *
+ * Built only with I2C_TRACE=1 (e.g. "macros": ["I2C_TRACE=1"] in
+ * mbed_app.json); otherwise the hooks in i2c_api.c expand to nothing.
+ *
+ * Every i2c_read(), i2c_write() and asynchronous transfer is charged to
+ * its slave address: transactions, bytes, NACKs, other errors, bus time
+ * from start to end, and the part of it the CPU spent spinning on the
+ * completion flag. Times come from the DWT cycle counter, which the
+ * tracer enables on first use. The last I2C_TRACE_LOG transactions are
+ * kept in a ring for a closer look.
+ */
+#ifndef MBED_I2C_TRACE_H
+#define MBED_I2C_TRACE_H
+
+#include <stdint.h>
+
+#ifndef I2C_TRACE
+#define I2C_TRACE 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if I2C_TRACE
+
+#define I2C_TRACE_ADDRESSES     8       /* slaves profiled, later ones go to the overflow slot */
+#define I2C_TRACE_LOG           32      /* transactions kept */
+#define I2C_TRACE_BUSES         5       /* I2C_NUM of i2c_api.c */
+
+enum {
+    I2C_TRACE_OK,
+    I2C_TRACE_NACK,
+    I2C_TRACE_ERROR                     /* bus error, arbitration lost or timeout */
+};
+
+typedef struct {
+    uint8_t address;                    /* 8-bit, 0xFF for the overflow slot */
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t nacks;
+    uint32_t errors;
+    uint64_t bus_cycles;                /* start to end of each transaction */
+    uint64_t wait_cycles;               /* CPU spinning for completion, blocking calls only */
+    uint32_t max_cycles;                /* longest transaction */
+} i2c_trace_address_t;
+
+typedef struct {
+    uint32_t start;                     /* DWT->CYCCNT at the start */
+    uint32_t cycles;                    /* duration */
+    uint16_t bytes;
+    uint8_t address;
+    uint8_t result;                     /* I2C_TRACE_OK, _NACK or _ERROR */
+} i2c_trace_entry_t;
+
+typedef struct {
+    i2c_trace_address_t address[I2C_TRACE_ADDRESSES];
+    uint32_t used;                      /* address slots in use */
+    i2c_trace_address_t other;          /* slaves met with the address slots all in use */
+    i2c_trace_entry_t log[I2C_TRACE_LOG];
+    uint32_t logged;                    /* transactions logged since the clear, the newest is at (logged - 1) % I2C_TRACE_LOG */
+} i2c_trace_t;
+
+/** Start of a transaction
+ *
+ * @param bus I2C index, 0 to I2C_TRACE_BUSES - 1
+ */
+void i2c_trace_begin(int bus);
+
+/** The CPU starts spinning for the end of the transaction
+ *
+ * @param bus I2C index
+ */
+void i2c_trace_wait(int bus);
+
+/** Note the HAL error code of the transaction failing
+ *
+ * @param bus   I2C index
+ * @param error HAL_I2C_ERROR_xxx
+ */
+void i2c_trace_error(int bus, uint32_t error);
+
+/** End of a transaction
+ *
+ * @param bus     I2C index
+ * @param address 8-bit slave address
+ * @param bytes   data bytes moved, address byte excluded
+ * @param event   I2C_EVENT_xxx it ended with, 0 for a timeout
+ */
+void i2c_trace_end(int bus, int address, int bytes, int event);
+
+/** Copy the profile, consistent with respect to the interrupts updating it
+ *
+ * @param trace destination
+ */
+void i2c_trace_read(i2c_trace_t *trace);
+
+/** Reset the profile and the log
+ */
+void i2c_trace_clear(void);
+
+#define I2C_TRACE_BEGIN(bus)                    i2c_trace_begin(bus)
+#define I2C_TRACE_WAIT(bus)                     i2c_trace_wait(bus)
+#define I2C_TRACE_ERROR(bus, error)             i2c_trace_error((bus), (error))
+#define I2C_TRACE_END(bus, address, bytes, event) \
+                                                i2c_trace_end((bus), (address), (bytes), (event))
+
+#else
+
+#define I2C_TRACE_BEGIN(bus)
+#define I2C_TRACE_WAIT(bus)
+#define I2C_TRACE_ERROR(bus, error)
+#define I2C_TRACE_END(bus, address, bytes, event)
+
+#endif // I2C_TRACE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
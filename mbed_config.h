@@ -5,12 +5,14 @@
 #define __MBED_CONFIG_DATA__
 
 // Configuration parameters
+#define MBED_CONF_APP_HTS221_DRDY_PIN               NC   // set by application
+#define MBED_CONF_APP_LPS25H_INT1_PIN               NC   // set by application
 #define MBED_CONF_NSAPI_PRESENT                     1    // set by library:nsapi
 #define MBED_CONF_FILESYSTEM_PRESENT                1    // set by library:filesystem
 #define MBED_CONF_PLATFORM_STDIO_CONVERT_NEWLINES   0    // set by library:platform
 #define MBED_CONF_EVENTS_PRESENT                    1    // set by library:events
 #define MBED_CONF_RTOS_PRESENT                      1    // set by library:rtos
-#define MBED_CONF_PLATFORM_STDIO_BAUD_RATE          9600 // set by library:platform
+#define MBED_CONF_PLATFORM_STDIO_BAUD_RATE          115200 // set by application
 #define MBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE 9600 // set by library:platform
 #define MBED_CONF_PLATFORM_STDIO_FLUSH_AT_EXIT      1    // set by library:platform
 // Macros
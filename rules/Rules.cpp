@@ -0,0 +1,196 @@
+#include "Rules.h"
+
+static const char *const quantity_names[RULE_QUANTITIES] = {
+    "temperature", "humidity", "pressure", "dewpoint", "spread"
+};
+
+static const uint8_t quantity_units[RULE_QUANTITIES] = { 2, 1, 2, 2, 2 };
+
+static const char *const type_names[RULE_TYPES] = {
+    "off", "above", "below", "rise", "fall", "both"
+};
+
+Rules::Rules(Callback<void(const RuleEvent&)> event) : _event(event)
+{
+    RuleConfig config;
+
+    memset(_config, 0, sizeof(_config));
+    memset(_state, 0, sizeof(_state));
+
+    memset(&config, 0, sizeof(config));
+    config.type = RULE_BELOW;
+    config.quantity = RULE_TEMPERATURE;
+    config.threshold = 0;
+    config.hysteresis = 50;
+    set(0, config);                     // frost
+
+    config.quantity = RULE_SPREAD;
+    config.threshold = 100;
+    set(1, config);                     // condensation
+
+    config.type = RULE_FALL;
+    config.quantity = RULE_PRESSURE;
+    config.threshold = 200;
+    config.window = 3 * 3600;
+    set(2, config);                     // pressure drop
+}
+
+void Rules::update(RuleQuantity quantity, int32_t value, uint64_t time)
+{
+    bool changed = false;
+    int32_t decided;
+    int i, pass;
+
+    _mutex.lock();
+    for (i = 0; i < RULES_MAX; i++) {
+        if (_config[i].type == RULE_OFF || _config[i].type == RULE_BOTH || _config[i].quantity != quantity) {
+            continue;
+        }
+        bool active = evaluate(i, value, time, &decided);
+        if (active != _state[i].active) {
+            change(i, active, decided, time);
+            changed = true;
+        }
+    }
+    // Combined rules follow the rules they are made of, which may be
+    // combined rules themselves
+    for (pass = 0; changed && pass < RULES_MAX; pass++) {
+        changed = false;
+        for (i = 0; i < RULES_MAX; i++) {
+            if (_config[i].type != RULE_BOTH) {
+                continue;
+            }
+            bool active = _state[_config[i].first].active && _state[_config[i].second].active;
+            if (active != _state[i].active) {
+                change(i, active, 0, time);
+                changed = true;
+            }
+        }
+    }
+    _mutex.unlock();
+}
+
+bool Rules::uses(RuleQuantity quantity)
+{
+    for (int i = 0; i < RULES_MAX; i++) {
+        if (_config[i].type != RULE_OFF && _config[i].type != RULE_BOTH && _config[i].quantity == quantity) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Rules::set(int index, const RuleConfig& config)
+{
+    if (index < 0 || index >= RULES_MAX || config.type >= RULE_TYPES) {
+        return false;
+    }
+    if (config.type == RULE_BOTH) {
+        if (config.first >= RULES_MAX || config.second >= RULES_MAX ||
+            config.first == index || config.second == index) {
+            return false;
+        }
+    } else if (config.type != RULE_OFF && config.quantity >= RULE_QUANTITIES) {
+        return false;
+    }
+    if ((config.type == RULE_RISE || config.type == RULE_FALL) && config.window == 0) {
+        return false;
+    }
+    if (config.hysteresis < 0) {
+        return false;
+    }
+    _mutex.lock();
+    _config[index] = config;
+    memset(&_state[index], 0, sizeof(_state[index]));
+    _mutex.unlock();
+    return true;
+}
+
+bool Rules::get(int index, RuleConfig *config)
+{
+    bool active;
+
+    _mutex.lock();
+    *config = _config[index];
+    active = _state[index].active;
+    _mutex.unlock();
+    return active;
+}
+
+const char *Rules::quantity_name(int quantity)
+{
+    return quantity < RULE_QUANTITIES ? quantity_names[quantity] : "?";
+}
+
+int Rules::quantity_decimals(int quantity)
+{
+    return quantity < RULE_QUANTITIES ? quantity_units[quantity] : 0;
+}
+
+const char *Rules::type_name(int type)
+{
+    return type < RULE_TYPES ? type_names[type] : "?";
+}
+
+// New state of one level or rate rule
+bool Rules::evaluate(int index, int32_t value, uint64_t time, int32_t *decided)
+{
+    const RuleConfig *config = &_config[index];
+    State *state = &_state[index];
+    int32_t change;
+
+    *decided = value;
+    switch (config->type) {
+        case RULE_ABOVE:
+            return state->active ? value > config->threshold - config->hysteresis : value > config->threshold;
+
+        case RULE_BELOW:
+            return state->active ? value < config->threshold + config->hysteresis : value < config->threshold;
+
+        case RULE_RISE:
+        case RULE_FALL: {
+            uint64_t slot = (uint64_t)config->window * 1000000 / RULES_HISTORY;
+
+            // One value per slot; after a gap the slots restart from now
+            if (state->filled == 0 || time >= state->slot_end) {
+                if (state->filled < RULES_HISTORY) {
+                    state->history[(state->head + state->filled) % RULES_HISTORY] = value;
+                    state->filled++;
+                } else {
+                    state->history[state->head] = value;
+                    state->head = (state->head + 1) % RULES_HISTORY;
+                }
+                if (state->filled == 1 || time >= state->slot_end + slot) {
+                    state->slot_end = time + slot;
+                } else {
+                    state->slot_end += slot;
+                }
+            }
+            if (state->filled < RULES_HISTORY) {
+                return false;       // less than a window seen yet
+            }
+            // Against the oldest value, between (RULES_HISTORY - 1) / RULES_HISTORY
+            // of a window and a window ago
+            *decided = value - state->history[state->head];
+            change = config->type == RULE_RISE ? *decided : -*decided;
+            return state->active ? change > config->threshold - config->hysteresis : change >= config->threshold;
+        }
+
+        default:
+            return false;
+    }
+}
+
+void Rules::change(int index, bool active, int32_t value, uint64_t time)
+{
+    RuleEvent event;
+
+    _state[index].active = active;
+    if (_event) {
+        event.time = time;
+        event.rule = index;
+        event.active = active;
+        event.value = value;
+        _event.call(event);
+    }
+}
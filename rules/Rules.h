@@ -0,0 +1,146 @@
+/*
+ * On-device event detection
+ *
+ * A small table of rules is evaluated on every new value, so frost,
+ * condensation or a falling barometer are reported by the board as a
+ * handful of RuleEvents instead of being worked out on the host from the
+ * whole sample stream. A rule is one of:
+ *
+ *   RULE_ABOVE, RULE_BELOW  level crossed; the rule re-arms once the value
+ *                           is back past the level by the hysteresis
+ *   RULE_RISE, RULE_FALL    change over a window of seconds at least the
+ *                           threshold; cleared once the change is back
+ *                           under the threshold less the hysteresis
+ *   RULE_BOTH               two other rules active at the same time
+ *
+ * on one of the quantities below, derived ones included. The change over
+ * a window is taken against a ring of RULES_HISTORY values, one per
+ * 1/RULES_HISTORY of the window, so a rule costs a few compares per value
+ * and a fixed 80 bytes. An event is emitted when a rule becomes active and
+ * when it clears, never per sample. Rules are set at run time, from the
+ * console, with the defaults loaded at start-up:
+ *
+ *   0  frost          temperature below 0.00 degC, hysteresis 0.50
+ *   1  condensation   dew point spread below 1.00 degC, hysteresis 0.50
+ *   2  pressure drop  pressure falls 2.00 hPa in 3 hours, hysteresis 0.50
+ */
+#ifndef RULES_H
+#define RULES_H
+
+#include "mbed.h"
+#include "platform/PlatformMutex.h"
+
+#define RULES_MAX           8
+#define RULES_HISTORY       16      // slots per RULE_RISE/RULE_FALL window
+
+enum RuleType {
+    RULE_OFF,
+    RULE_ABOVE,
+    RULE_BELOW,
+    RULE_RISE,
+    RULE_FALL,
+    RULE_BOTH,
+    RULE_TYPES
+};
+
+enum RuleQuantity {
+    RULE_TEMPERATURE,       // HTS221, 0.01 degC
+    RULE_HUMIDITY,          // HTS221, 0.1 %RH
+    RULE_PRESSURE,          // LPS25H, 0.01 hPa
+    RULE_DEW_POINT,         // 0.01 degC
+    RULE_SPREAD,            // temperature less dew point, 0.01 degC
+    RULE_QUANTITIES
+};
+
+/** Rule settings */
+typedef struct {
+    uint8_t type;           // RuleType
+    uint8_t quantity;       // RuleQuantity, not used by RULE_BOTH
+    uint8_t first;          // RULE_BOTH: the two rules combined
+    uint8_t second;
+    int32_t threshold;      // level, or change over the window, in quantity units
+    int32_t hysteresis;     // in quantity units
+    uint32_t window;        // RULE_RISE/RULE_FALL: seconds
+} RuleConfig;
+
+/** State change of a rule */
+typedef struct {
+    uint64_t time;          // Timebase::now() of the value that changed it
+    uint8_t rule;           // index
+    uint8_t active;         // 1 when the rule fired, 0 when it cleared
+    int32_t value;          // the value, or the change over the window, that decided it
+} RuleEvent;
+
+class Rules
+{
+public:
+    /** Load the default rules
+      * @param callback for every event, run in the thread calling update()
+      */
+    Rules(Callback<void(const RuleEvent&)> event);
+
+    /** New value of a quantity, evaluates the rules that depend on it
+      * @param quantity
+      * @param value in the quantity's units
+      * @param time, Timebase::now()
+      * @return none
+      */
+    void update(RuleQuantity quantity, int32_t value, uint64_t time);
+
+    /** Check whether any rule watches a quantity, to skip computing it
+      * @param quantity
+      * @return true if an enabled rule depends on it
+      */
+    bool uses(RuleQuantity quantity);
+
+    /** Set a rule, its state starts afresh
+      * @param index
+      * @param settings
+      * @return false if the index or the settings are out of range
+      */
+    bool set(int index, const RuleConfig& config);
+
+    /** Read a rule
+      * @param index
+      * @param settings
+      * @return true while the rule is active
+      */
+    bool get(int index, RuleConfig *config);
+
+    /** Quantity name
+      * @param quantity
+      * @return name, as used on the console
+      */
+    static const char *quantity_name(int quantity);
+
+    /** Decimal places of a quantity's unit
+      * @param quantity
+      * @return 1 or 2
+      */
+    static int quantity_decimals(int quantity);
+
+    /** Rule type name
+      * @param type
+      * @return name, as used on the console
+      */
+    static const char *type_name(int type);
+
+private:
+    struct State {
+        bool active;
+        uint8_t head;               // oldest slot once the ring is full
+        uint8_t filled;
+        uint64_t slot_end;          // time the newest slot closes
+        int32_t history[RULES_HISTORY];
+    };
+
+    bool evaluate(int index, int32_t value, uint64_t time, int32_t *decided);
+    void change(int index, bool active, int32_t value, uint64_t time);
+
+    RuleConfig _config[RULES_MAX];
+    State _state[RULES_MAX];
+    Callback<void(const RuleEvent&)> _event;
+    PlatformMutex _mutex;
+};
+
+#endif // RULES_H
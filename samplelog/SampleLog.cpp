@@ -0,0 +1,110 @@
+#include "SampleLog.h"
+
+SampleLog::SampleLog() : _first(0), _blocks(0), _count(0), _bytes(0)
+{
+}
+
+void SampleLog::add(const LogEntry& entry)
+{
+    uint8_t code[DELTA_MAX_RECORD];
+    DeltaRecord record;
+    uint32_t block;
+    size_t n;
+
+    to_record(entry, &record);
+    _mutex.lock();
+    block = (_first + _blocks - 1) % SAMPLE_LOG_BLOCKS;
+    n = _encoder.encode(record, code);
+    if (_blocks == 0 || _used[block] + n > SAMPLE_LOG_BLOCK_SIZE) {
+        if (_blocks == SAMPLE_LOG_BLOCKS) {
+            _count -= _records[_first];
+            _bytes -= _used[_first];
+            _first = (_first + 1) % SAMPLE_LOG_BLOCKS;
+            _blocks--;
+        }
+        block = (_first + _blocks) % SAMPLE_LOG_BLOCKS;
+        _used[block] = 0;
+        _records[block] = 0;
+        _blocks++;
+        // A block starts a new stream so it decodes without the ones before
+        _encoder.reset();
+        n = _encoder.encode(record, code);
+    }
+    memcpy(&_data[block][_used[block]], code, n);
+    _used[block] += n;
+    _records[block]++;
+    _count++;
+    _bytes += n;
+    _mutex.unlock();
+}
+
+uint32_t SampleLog::count(void)
+{
+    return _count;
+}
+
+uint32_t SampleLog::bytes(void)
+{
+    return _bytes;
+}
+
+uint32_t SampleLog::read(uint32_t from, LogEntry *entries, uint32_t count)
+{
+    DeltaDecoder decoder;
+    DeltaRecord record;
+    uint32_t i, block, skip, offset, index;
+    uint32_t done = 0;
+    size_t n;
+
+    _mutex.lock();
+    // Skip whole blocks, then decode from the start of the block holding 'from'
+    skip = from;
+    for (i = 0; i < _blocks && skip >= _records[(_first + i) % SAMPLE_LOG_BLOCKS]; i++) {
+        skip -= _records[(_first + i) % SAMPLE_LOG_BLOCKS];
+    }
+    for (; i < _blocks && done < count; i++) {
+        block = (_first + i) % SAMPLE_LOG_BLOCKS;
+        decoder.reset();
+        offset = 0;
+        for (index = 0; index < _records[block] && done < count; index++) {
+            n = decoder.decode(&_data[block][offset], _used[block] - offset, &record);
+            if (n == 0) {
+                break;
+            }
+            offset += n;
+            if (index >= skip) {
+                from_record(record, &entries[done++]);
+            }
+        }
+        skip = 0;
+    }
+    _mutex.unlock();
+    return done;
+}
+
+void SampleLog::clear(void)
+{
+    _mutex.lock();
+    _first = 0;
+    _blocks = 0;
+    _count = 0;
+    _bytes = 0;
+    _encoder.reset();
+    _mutex.unlock();
+}
+
+void SampleLog::to_record(const LogEntry& entry, DeltaRecord *record)
+{
+    record->time = entry.time;
+    record->value[0] = entry.temperature;
+    record->value[1] = entry.humidity;
+    record->value[2] = entry.pressure;
+}
+
+void SampleLog::from_record(const DeltaRecord& record, LogEntry *entry)
+{
+    entry->time = record.time;
+    entry->temperature = record.value[0];
+    entry->humidity = record.value[1];
+    entry->pressure = record.value[2];
+}
@@ -0,0 +1,94 @@
+/*
+ * In-RAM history of readings
+ *
+ * Readings are delta compressed (see compress/Delta.h) into a ring of
+ * fixed size blocks. Each block is coded from a fresh encoder, so it
+ * decodes on its own and the oldest block can be dropped whole once the
+ * ring is full. A steady reading takes 1 to 5 bytes against 8 for the
+ * packed record used before, so the same RAM holds about twice the
+ * history, and times are kept exactly instead of saturating.
+ *
+ * Records are coded as time (ms), temperature (0.01 degC), humidity
+ * (0.1 %RH) and raw LPS25H pressure (1/4096 hPa), in that order.
+ * tools/samplelog_test.cpp checks the coding and the ring on the host.
+ */
+#ifndef SAMPLELOG_H
+#define SAMPLELOG_H
+
+#include "mbed.h"
+#include "platform/PlatformMutex.h"
+#include "Delta.h"
+
+#ifndef SAMPLE_LOG_BLOCKS
+#define SAMPLE_LOG_BLOCKS       128
+#endif
+#define SAMPLE_LOG_BLOCK_SIZE   256     // bytes
+
+/** Reading */
+typedef struct {
+    uint32_t time;          // ms
+    int16_t temperature;    // 0.01 degC
+    uint16_t humidity;      // 0.1 %RH
+    uint32_t pressure;      // 1/4096 hPa
+} LogEntry;
+
+class SampleLog
+{
+public:
+    SampleLog();
+
+    /** Append a reading, dropping the oldest block of readings when the log is full
+      * @param entry, time in ms
+      * @return none
+      */
+    void add(const LogEntry& entry);
+
+    /** Number of readings held
+      * @param none
+      * @return count
+      */
+    uint32_t count(void);
+
+    /** Compressed size of the readings held
+      * @param none
+      * @return bytes, at most SAMPLE_LOG_BLOCKS * SAMPLE_LOG_BLOCK_SIZE
+      */
+    uint32_t bytes(void);
+
+    /** Copy a range of readings, oldest first
+      *  Readings are copied out rather than walked with a callback so the
+      *  log is only locked for the copy, not while they are printed.
+      * @param index of the first reading, 0 being the oldest held
+      * @param buffer for the readings
+      * @param number of readings
+      * @return number of readings copied
+      */
+    uint32_t read(uint32_t from, LogEntry *entries, uint32_t count);
+
+    /** Drop all readings
+      * @param none
+      * @return none
+      */
+    void clear(void);
+
+    /** Convert between a reading and a codec record
+      * @param reading
+      * @param record
+      * @return none
+      */
+    static void to_record(const LogEntry& entry, DeltaRecord *record);
+    static void from_record(const DeltaRecord& record, LogEntry *entry);
+
+private:
+    uint8_t _data[SAMPLE_LOG_BLOCKS][SAMPLE_LOG_BLOCK_SIZE];
+    uint16_t _used[SAMPLE_LOG_BLOCKS];      // bytes of each block
+    uint16_t _records[SAMPLE_LOG_BLOCKS];   // readings in each block
+    uint32_t _first;        // oldest block
+    uint32_t _blocks;       // blocks in use, the newest is being filled
+    uint32_t _count;
+    uint32_t _bytes;
+    DeltaEncoder _encoder;
+    PlatformMutex _mutex;
+};
+
+#endif // SAMPLELOG_H
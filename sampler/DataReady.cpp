@@ -0,0 +1,90 @@
+#include "DataReady.h"
+
+DataReady::DataReady(HTS221Sensor& hts221, PinName hts221_drdy, LPS25HSensor& lps25h, PinName lps25h_int1,
+                     EventQueue& queue, SampleQueue& samples)
+    : _hts221(hts221), _lps25h(lps25h), _hts221_pin(hts221_drdy), _lps25h_pin(lps25h_int1),
+      _hts221_drdy(NULL), _lps25h_int1(NULL), _queue(queue), _samples(samples), _dropped(0)
+{
+}
+
+DataReady::~DataReady()
+{
+    stop();
+}
+
+bool DataReady::start(uint32_t hts221_mhz, uint32_t lps25h_mhz)
+{
+    if (_hts221_pin != NC && _hts221_drdy == NULL) {
+        // A sensor left in one-shot mode never raises DRDY
+        _hts221.start(hts221_mhz);
+        _hts221_drdy = new InterruptIn(_hts221_pin);
+        _hts221_drdy->rise(callback(this, &DataReady::hts221_irq));
+        _hts221.device().drdy_enable(true);
+        // DRDY stays high until the data is read, so a sample that is
+        // already waiting would never produce an edge: read it now
+        _queue.call(this, &DataReady::read_hts221);
+    }
+    if (_lps25h_pin != NC && _lps25h_int1 == NULL) {
+        _lps25h.start(lps25h_mhz);
+        _lps25h_int1 = new InterruptIn(_lps25h_pin);
+        _lps25h_int1->rise(callback(this, &DataReady::lps25h_irq));
+        _lps25h.device().drdy_enable(true);
+        _queue.call(this, &DataReady::read_lps25h);
+    }
+    return (_hts221_drdy != NULL) || (_lps25h_int1 != NULL);
+}
+
+void DataReady::stop(void)
+{
+    if (_hts221_drdy != NULL) {
+        _hts221.device().drdy_enable(false);
+        delete _hts221_drdy;
+        _hts221_drdy = NULL;
+    }
+    if (_lps25h_int1 != NULL) {
+        _lps25h.device().drdy_enable(false);
+        delete _lps25h_int1;
+        _lps25h_int1 = NULL;
+    }
+}
+
+uint32_t DataReady::dropped(void)
+{
+    return _dropped;
+}
+
+void DataReady::hts221_irq(void)
+{
+    _queue.call(this, &DataReady::read_hts221);
+}
+
+void DataReady::lps25h_irq(void)
+{
+    _queue.call(this, &DataReady::read_lps25h);
+}
+
+void DataReady::read_hts221(void)
+{
+    Sample sample;
+
+    push(_hts221.read(sample), sample);
+}
+
+void DataReady::read_lps25h(void)
+{
+    Sample sample;
+
+    push(_lps25h.read(sample), sample);
+}
+
+void DataReady::push(bool ok, Sample& sample)
+{
+    if (!ok) {
+        _dropped++;
+        return;
+    }
+    sample.time = Timebase::now();
+    if (!sample_push(_samples, sample)) {
+        _dropped++;
+    }
+}
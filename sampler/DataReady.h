@@ -0,0 +1,69 @@
+/*
+ * Data ready driven acquisition
+ *
+ * The HTS221 DRDY pin and the LPS25H INT1 pin are enabled and watched with
+ * InterruptIn. Each rising edge defers one read to an EventQueue (the bus
+ * can't be used from interrupt context) and the sample is pushed into the
+ * sample queue, so a sensor is read exactly once per new sample instead of
+ * whenever the application happens to poll it.
+ */
+#ifndef DATAREADY_H
+#define DATAREADY_H
+
+#include "mbed.h"
+#include "HTS221Sensor.h"
+#include "LPS25HSensor.h"
+#include "Sample.h"
+
+class DataReady
+{
+public:
+    /** Bind the sensors and their data ready lines
+      * @param HTS221 adapter and its DRDY pin (NC if not routed)
+      * @param LPS25H adapter and its INT1 pin (NC if not routed)
+      * @param queue the reads are deferred to, dispatched by the caller
+      * @param queue receiving the samples
+      */
+    DataReady(HTS221Sensor& hts221, PinName hts221_drdy, LPS25HSensor& lps25h, PinName lps25h_int1,
+              EventQueue& queue, SampleQueue& samples);
+    ~DataReady();
+
+    /** Set the sensors converting, enable DRDY and start reading on each edge
+      *  The rates are set whatever mode ran before, one-shot included.
+      * @param hts221_mhz HTS221 output data rate, one of HTS221Sensor::rates
+      * @param lps25h_mhz LPS25H output data rate, one of LPS25HSensor::rates
+      * @return false if neither data ready line is routed
+      */
+    bool start(uint32_t hts221_mhz = HTS221Sensor::DEFAULT_RATE, uint32_t lps25h_mhz = LPS25HSensor::DEFAULT_RATE);
+
+    /** Disable DRDY and detach the interrupts
+      * @param none
+      * @return none
+      */
+    void stop(void);
+
+    /** Number of samples lost because the queue was full or a read failed
+      * @param none
+      * @return drop count
+      */
+    uint32_t dropped(void);
+
+private:
+    void hts221_irq(void);
+    void lps25h_irq(void);
+    void read_hts221(void);
+    void read_lps25h(void);
+    void push(bool ok, Sample& sample);
+
+    HTS221Sensor &_hts221;
+    LPS25HSensor &_lps25h;
+    PinName _hts221_pin;
+    PinName _lps25h_pin;
+    InterruptIn *_hts221_drdy;
+    InterruptIn *_lps25h_int1;
+    EventQueue &_queue;
+    SampleQueue &_samples;
+    volatile uint32_t _dropped;
+};
+
+#endif // DATAREADY_H
@@ -0,0 +1,118 @@
+#include "DutyCycle.h"
+
+DutyCycle::DutyCycle(HTS221Sensor& hts221, LPS25HSensor& lps25h, EventQueue& queue, SampleQueue& samples)
+    : _hts221(hts221), _lps25h(lps25h), _queue(queue), _samples(samples), _running(false),
+      _event(0), _poll(0), _period_ms(DUTY_CYCLE_PERIOD_MS), _start(0), _awake(0),
+      _convert_us(0), _awake_us(0), _dropped(0)
+{
+    _pending[SAMPLE_HTS221] = false;
+    _pending[SAMPLE_LPS25H] = false;
+}
+
+void DutyCycle::start(uint32_t period_ms)
+{
+    stop();
+    _hts221.device().odr(ODR_OneShot);
+    _lps25h.device().odr(ODR_ONESHOT);
+    _period_ms = period_ms;
+    _running = true;
+    _event = _queue.call_every(period_ms, this, &DutyCycle::trigger);
+}
+
+void DutyCycle::stop(void)
+{
+    _running = false;
+    if (_event) {
+        _queue.cancel(_event);
+        _event = 0;
+    }
+    if (_poll) {
+        _queue.cancel(_poll);
+        _poll = 0;
+    }
+    _pending[SAMPLE_HTS221] = false;
+    _pending[SAMPLE_LPS25H] = false;
+}
+
+bool DutyCycle::running(void)
+{
+    return _running;
+}
+
+void DutyCycle::budget(DutyBudget *budget)
+{
+    uint32_t period_us = _period_ms * 1000;
+    uint32_t awake_us = _awake_us < period_us ? _awake_us : period_us;
+
+    budget->period_ms = _period_ms;
+    budget->convert_us = _convert_us;
+    budget->awake_us = _awake_us;
+    budget->sensor_nc = HTS221_SAMPLE_NC + LPS25H_SAMPLE_NC;
+    // nC per ms is uA, so nC per s is nA
+    budget->sensor_na = (uint32_t)((uint64_t)budget->sensor_nc * 1000 / _period_ms) + SENSOR_IDLE_NA;
+    budget->mcu_ua = (uint32_t)(((uint64_t)MCU_RUN_UA * awake_us
+                                 + (uint64_t)MCU_SLEEP_UA * (period_us - awake_us)) / period_us);
+}
+
+uint32_t DutyCycle::dropped(void)
+{
+    return _dropped;
+}
+
+void DutyCycle::trigger(void)
+{
+    uint32_t now = us_ticker_read();
+
+    if (_pending[SAMPLE_HTS221] || _pending[SAMPLE_LPS25H]) {
+        return;     // last conversion still being polled
+    }
+    _start = now;
+    _hts221.device().one_shot();
+    _lps25h.device().one_shot();
+    _pending[SAMPLE_HTS221] = true;
+    _pending[SAMPLE_LPS25H] = true;
+    _awake = us_ticker_read() - now;
+    _poll = _queue.call_in(DUTY_CYCLE_POLL_MS, this, &DutyCycle::collect);
+}
+
+void DutyCycle::collect(void)
+{
+    uint32_t now = us_ticker_read();
+    Sample sample;
+
+    _poll = 0;
+    if (_pending[SAMPLE_HTS221] && _hts221.device().data_ready()) {
+        push(_hts221.read(sample), sample);
+        _pending[SAMPLE_HTS221] = false;
+    }
+    if (_pending[SAMPLE_LPS25H] && _lps25h.device().data_ready()) {
+        push(_lps25h.read(sample), sample);
+        _pending[SAMPLE_LPS25H] = false;
+    }
+    _awake += us_ticker_read() - now;
+
+    if (_pending[SAMPLE_HTS221] || _pending[SAMPLE_LPS25H]) {
+        if (us_ticker_read() - _start < DUTY_CYCLE_TIMEOUT_MS * 1000) {
+            _poll = _queue.call_in(DUTY_CYCLE_POLL_MS, this, &DutyCycle::collect);
+            return;
+        }
+        // Sensor missing or the one-shot was lost, try again next period
+        _dropped += _pending[SAMPLE_HTS221] + _pending[SAMPLE_LPS25H];
+        _pending[SAMPLE_HTS221] = false;
+        _pending[SAMPLE_LPS25H] = false;
+    }
+    _convert_us = us_ticker_read() - _start;
+    _awake_us = _awake;
+}
+
+void DutyCycle::push(bool ok, Sample& sample)
+{
+    if (!ok) {
+        _dropped++;
+        return;
+    }
+    sample.time = Timebase::now();
+    if (!sample_push(_samples, sample)) {
+        _dropped++;
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Duty-cycled one-shot acquisition
+ *
+ * Both sensors are left in one-shot mode, idle at their power-down current.
+ * Every period one conversion is triggered on each, the status registers
+ * are polled from the event queue until both samples are ready, and the
+ * samples are pushed into the sample queue. In between the event thread is
+ * blocked, so the RTOS idle loop puts the MCU in sleep(). deepsleep() is
+ * not used: on the F401 it stops the clock the RTOS tick and us_ticker run
+ * from, and there is no low power timer to wake it.
+ *
+ * budget() reports what one sample costs, so a battery deployment can pick
+ * its period: the measured conversion and CPU time of the last cycle, and
+ * the sensor charge per sample from the datasheet figures below.
+ */
+#ifndef DUTYCYCLE_H
+#define DUTYCYCLE_H
+
+#include "mbed.h"
+#include "HTS221Sensor.h"
+#include "LPS25HSensor.h"
+#include "Sample.h"
+
+#define DUTY_CYCLE_PERIOD_MS    10000
+#define DUTY_CYCLE_POLL_MS      5       // status register poll interval
+#define DUTY_CYCLE_TIMEOUT_MS   500     // give up on a conversion after this
+
+// Typical datasheet currents. Sensor charge per one-shot sample is the
+// 1 Hz supply current less the power-down current, over one second.
+#define HTS221_SAMPLE_NC        1500    // 2 uA at 1 Hz, 0.5 uA power-down
+#define LPS25H_SAMPLE_NC        24500   // 25 uA at 1 Hz with RES_CONF averaging
+#define SENSOR_IDLE_NA          1000    // both sensors powered down
+#define MCU_RUN_UA              12000   // STM32F401 at 84 MHz, running
+#define MCU_SLEEP_UA            4500    // STM32F401 at 84 MHz, sleep()
+
+/** Cost of one duty cycle */
+typedef struct {
+    uint32_t period_ms;     // sampling period
+    uint32_t convert_us;    // trigger to both samples read, last cycle
+    uint32_t awake_us;      // CPU time spent in the cycle, last cycle
+    uint32_t sensor_nc;     // sensor charge per sample
+    uint32_t sensor_na;     // average sensor current at this period
+    uint32_t mcu_ua;        // average MCU current at this period
+} DutyBudget;
+
+class DutyCycle
+{
+public:
+    /** Bind the sensors
+      * @param HTS221 adapter
+      * @param LPS25H adapter
+      * @param queue the cycle runs on, dispatched by the caller
+      * @param queue receiving the samples
+      */
+    DutyCycle(HTS221Sensor& hts221, LPS25HSensor& lps25h, EventQueue& queue, SampleQueue& samples);
+
+    /** Put both sensors in one-shot mode and start cycling
+      * @param period in ms
+      * @return none
+      */
+    void start(uint32_t period_ms = DUTY_CYCLE_PERIOD_MS);
+
+    /** Stop cycling, the sensors stay in one-shot mode
+      * @param none
+      * @return none
+      */
+    void stop(void);
+
+    /** Check whether cycling is active
+      * @param none
+      * @return true between start() and stop()
+      */
+    bool running(void);
+
+    /** Report the cost of a sample at the current period
+      * @param budget to fill in
+      * @return none
+      */
+    void budget(DutyBudget *budget);
+
+    /** Number of samples lost because the queue was full, a conversion timed out or a read failed
+      * @param none
+      * @return drop count
+      */
+    uint32_t dropped(void);
+
+private:
+    void trigger(void);
+    void collect(void);
+    void push(bool ok, Sample& sample);
+
+    HTS221Sensor &_hts221;
+    LPS25HSensor &_lps25h;
+    EventQueue &_queue;
+    SampleQueue &_samples;
+    bool _running;
+    int _event;             // periodic trigger
+    int _poll;              // pending status poll
+    uint32_t _period_ms;
+    bool _pending[2];       // conversion started and not yet read, per SampleSource
+    uint32_t _start;        // us_ticker at trigger
+    uint32_t _awake;        // us spent in trigger() and collect() this cycle
+    uint32_t _convert_us;
+    uint32_t _awake_us;
+    uint32_t _dropped;
+};
+
+#endif // DUTYCYCLE_H
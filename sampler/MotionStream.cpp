@@ -0,0 +1,125 @@
+#include "MotionStream.h"
+
+MotionStream::MotionStream(LSM6DS0& lsm6ds0, EventQueue& queue)
+    : _lsm6ds0(lsm6ds0), _queue(queue), _fill(0), _rate(0), _event(0), _burst(false),
+      _burst_count(0), _overruns(0), _fifo_overruns(0)
+{
+    _held[0] = _held[1] = false;
+    _block[0].count = _block[1].count = 0;
+}
+
+bool MotionStream::start(uint8_t rate)
+{
+    uint16_t hz = LSM6DS0::odr_hz(rate);
+    int period;
+
+    if (hz == 0 || _lsm6ds0.read_id() != I_AM_LSM6DS0) {
+        return false;
+    }
+    stop();
+    _rate = hz;
+    _block[_fill].count = 0;
+    _lsm6ds0.odr(rate);
+    // Poll at about half the FIFO depth so it never fills between two reads
+    period = (LSM6DS0_FIFO_DEPTH / 2) * 1000 / hz;
+    _event = _queue.call_every(period > 0 ? period : 1, this, &MotionStream::poll);
+    return true;
+}
+
+void MotionStream::stop(void)
+{
+    if (_event) {
+        _queue.cancel(_event);
+        _event = 0;
+    }
+    while (_burst) {
+        Thread::wait(1);
+    }
+    _lsm6ds0.odr(LSM6DS0_ODR_OFF);
+    _rate = 0;
+}
+
+bool MotionStream::running(void)
+{
+    return _event != 0;
+}
+
+MotionBlock *MotionStream::wait(uint32_t ms)
+{
+    osEvent evt = _full.get(ms);
+    if (evt.status != osEventMessage) {
+        return NULL;
+    }
+    return (MotionBlock *)evt.value.p;
+}
+
+void MotionStream::release(MotionBlock *block)
+{
+    _held[block == &_block[1]] = false;
+}
+
+uint32_t MotionStream::overruns(void)
+{
+    return _overruns;
+}
+
+uint32_t MotionStream::fifo_overruns(void)
+{
+    return _fifo_overruns;
+}
+
+void MotionStream::poll(void)
+{
+    uint8_t status;
+    int n;
+
+    if (_burst) {
+        return;
+    }
+    status = _lsm6ds0.fifo_status();
+    if (status & LSM6DS0_FIFO_SRC_OVRN) {
+        _fifo_overruns++;
+    }
+    n = status & LSM6DS0_FIFO_SRC_FSS;
+    if (n > LSM6DS0_FIFO_DEPTH) {
+        n = LSM6DS0_FIFO_DEPTH;
+    }
+    // Stop at the end of the block, the rest waits in the FIFO
+    if (n > MOTION_BLOCK_SIZE - _block[_fill].count) {
+        n = MOTION_BLOCK_SIZE - _block[_fill].count;
+    }
+    if (n == 0) {
+        return;
+    }
+    _burst = true;
+    _burst_count = n;
+    if (_lsm6ds0.get_fifo_async(_raw, n, event_callback_t(this, &MotionStream::burst_done)) != 0) {
+        _burst = false;
+    }
+}
+
+// Interrupt context
+void MotionStream::burst_done(int event)
+{
+    MotionBlock *block = &_block[_fill];
+    int next = !_fill;
+
+    if (event == I2C_EVENT_TRANSFER_COMPLETE) {
+        for (int i = 0; i < _burst_count; i++) {
+            LSM6DS0::decode(&_raw[i * LSM6DS0_RAW_SIZE], &block->data[block->count++]);
+        }
+        if (block->count == MOTION_BLOCK_SIZE) {
+            block->time = Timebase::now();
+            block->rate = _rate;
+            if (_held[next]) {
+                _overruns++;            // refill this one
+            } else {
+                _held[_fill] = true;
+                _full.put(block);
+                _fill = next;
+            }
+            _block[_fill].count = 0;
+        }
+    }
+    _burst = false;
+}
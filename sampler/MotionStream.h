@@ -0,0 +1,100 @@
+/*
+ * High rate LSM6DS0 streaming
+ *
+ * The LSM6DS0 collects samples in its FIFO. A timer on the event queue
+ * checks the level about every half FIFO and starts a non-blocking burst
+ * read of whatever is there, which is decoded in the completion interrupt
+ * straight into the block being filled. Two blocks alternate: once one is
+ * full it is handed to the consumer thread through a queue and filling
+ * carries on in the other. If the consumer still holds that one, the full
+ * block is reused and counted as an overrun rather than waiting, so the
+ * FIFO is always drained in time.
+ */
+#ifndef MOTIONSTREAM_H
+#define MOTIONSTREAM_H
+
+#include "mbed.h"
+#include "LSM6DS0.h"
+#include "Timebase.h"
+
+#define MOTION_BLOCK_SIZE       64      // samples per block
+
+/** A block of consecutive samples */
+typedef struct {
+    uint64_t time;          // Timebase::now() when the last sample was read
+    uint16_t rate;          // output data rate, Hz
+    uint16_t count;         // MOTION_BLOCK_SIZE
+    LSM6DS0_sample_t data[MOTION_BLOCK_SIZE];
+} MotionBlock;
+
+class MotionStream
+{
+public:
+    /** Bind the sensor
+      * @param LSM6DS0 instance, initialised
+      * @param queue the FIFO polling runs on, dispatched by the caller
+      */
+    MotionStream(LSM6DS0& lsm6ds0, EventQueue& queue);
+
+    /** Start streaming
+      * @param LSM6DS0_ODR_15HZ ... LSM6DS0_ODR_952HZ
+      * @return false if the rate is not valid or the sensor is missing
+      */
+    bool start(uint8_t rate);
+
+    /** Stop streaming and power the sensor down
+      * @param none
+      * @return none
+      */
+    void stop(void);
+
+    /** Check whether streaming is active
+      * @param none
+      * @return true between start() and stop()
+      */
+    bool running(void);
+
+    /** Wait for the next full block (consumer thread)
+      * @param timeout in ms
+      * @return block, to be given back with release(), or NULL on timeout
+      */
+    MotionBlock *wait(uint32_t ms = osWaitForever);
+
+    /** Give a block back for filling
+      * @param block from wait()
+      * @return none
+      */
+    void release(MotionBlock *block);
+
+    /** Blocks dropped because the consumer still held the other one
+      * @param none
+      * @return count
+      */
+    uint32_t overruns(void);
+
+    /** Times the sensor FIFO overflowed before it was read
+      * @param none
+      * @return count
+      */
+    uint32_t fifo_overruns(void);
+
+private:
+    void poll(void);
+    void burst_done(int event);
+
+    LSM6DS0 &_lsm6ds0;
+    EventQueue &_queue;
+    rtos::Queue<MotionBlock, 2> _full;
+    MotionBlock _block[2];
+    volatile bool _held[2];         // block is with the consumer
+    int _fill;                      // block being filled
+    uint16_t _rate;
+    int _event;
+    volatile bool _burst;           // burst read in flight
+    int _burst_count;
+    char _raw[LSM6DS0_FIFO_DEPTH * LSM6DS0_RAW_SIZE];
+    volatile uint32_t _overruns;
+    uint32_t _fifo_overruns;
+};
+
+#endif // MOTIONSTREAM_H
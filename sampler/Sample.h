@@ -0,0 +1,48 @@
+/*
+ * Sample record shared by the acquisition, storage and output paths.
+ * Values are kept in the sensors' fixed-point units; conversion to
+ * engineering units is left to whoever prints them.
+ */
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdint.h>
+#include "mbed.h"
+#include "Timebase.h"
+
+#define SAMPLE_QUEUE_SIZE   16
+
+enum SampleSource {
+    SAMPLE_HTS221 = 0,
+    SAMPLE_LPS25H = 1,
+    SAMPLE_SOURCES
+};
+
+struct Sample {
+    uint64_t time;          // Timebase::now() at acquisition
+    uint8_t source;         // SampleSource
+    int16_t temperature;    // HTS221: 0.01 degC, LPS25H: raw (degC = raw / 480 + 42.5)
+    uint16_t humidity;      // HTS221 only: 0.1 %RH
+    uint32_t pressure;      // LPS25H only: raw, 1/4096 hPa
+};
+
+// Samples travel from the acquisition thread to the consumer through this queue
+typedef rtos::Mail<Sample, SAMPLE_QUEUE_SIZE> SampleQueue;
+
+/** Copy a sample into the queue
+  * @param queue
+  * @param sample
+  * @return false if the queue was full and the sample was dropped
+  */
+inline bool sample_push(SampleQueue& queue, const Sample& sample)
+{
+    Sample *mail = queue.alloc();
+    if (mail == NULL) {
+        return false;
+    }
+    *mail = sample;
+    queue.put(mail);
+    return true;
+}
+
+#endif // SAMPLE_H
@@ -0,0 +1,197 @@
+/*
+ * Periodic acquisition
+ *
+ * Each sensor of the registry (see Sensor.h) is read on its own
+ * EventQueue::call_every() timer, with the sensor's output data rate set
+ * to match, and every timestamped sample is pushed into the sample queue.
+ * The timer only starts a non-blocking read_async(); the sample is filled
+ * in with convert(), timestamped and queued from the I2C completion
+ * interrupt, so the event thread is not held for the transfer. Without
+ * DEVICE_I2C_ASYNCH the blocking read() is used instead.
+ * A read the sensor did not answer is counted and skipped.
+ * The queue is dispatched by a thread of its own, so acquisition carries
+ * on whatever the console is doing.
+ */
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "mbed.h"
+#include "Sample.h"
+#include "Sensor.h"
+
+template <typename Sensors>
+class Sampler
+{
+public:
+    /** Bind the sensors
+      * @param sensor registry
+      * @param queue the sampling runs on, dispatched by the caller
+      * @param queue receiving the samples
+      */
+    Sampler(Sensors& sensors, EventQueue& queue, SampleQueue& samples)
+        : _sensors(sensors), _queue(queue), _samples(samples), _running(false), _dropped(0), _failed(0)
+    {
+        for (int i = 0; i < SAMPLE_SOURCES; i++) {
+            _rate[i] = sensors.default_rate(i);
+            _event[i] = 0;
+            _read[i].sampler = this;
+            _read[i].source = (SampleSource)i;
+        }
+    }
+
+    /** Start sampling every sensor at its configured rate
+      * @param none
+      * @return none
+      */
+    void start(void)
+    {
+        if (_running) {
+            return;
+        }
+        _running = true;
+        for (int i = 0; i < SAMPLE_SOURCES; i++) {
+            if (_sensors.has(i)) {
+                schedule((SampleSource)i);
+            }
+        }
+    }
+
+    /** Stop sampling
+      * @param none
+      * @return none
+      */
+    void stop(void)
+    {
+        _running = false;
+        for (int i = 0; i < SAMPLE_SOURCES; i++) {
+            if (_event[i]) {
+                _queue.cancel(_event[i]);
+                _event[i] = 0;
+            }
+        }
+    }
+
+    /** Check if sampling is running
+      * @param none
+      * @return true once started
+      */
+    bool running(void)
+    {
+        return _running;
+    }
+
+    /** Set the sampling rate of one sensor, applied immediately when running
+      * @param sensor
+      * @param rate in mHz, one the sensor lists
+      * @return false if the sensor doesn't support the rate
+      */
+    bool rate(SampleSource source, uint32_t mhz)
+    {
+        if (!_sensors.supports(source, mhz)) {
+            return false;
+        }
+        _rate[source] = mhz;
+        if (_running) {
+            schedule(source);
+        }
+        return true;
+    }
+
+    /** Current sampling rate of one sensor
+      * @param sensor
+      * @return rate in mHz
+      */
+    uint32_t rate(SampleSource source)
+    {
+        return _rate[source];
+    }
+
+    /** Number of samples lost because the queue was full
+      * @param none
+      * @return drop count
+      */
+    uint32_t dropped(void)
+    {
+        return _dropped;
+    }
+
+    /** Number of samples lost because the sensor did not answer
+      * @param none
+      * @return failed read count
+      */
+    uint32_t failed(void)
+    {
+        return _failed;
+    }
+
+private:
+    // Completion of one sensor's read, the callback is bound to it
+    struct Read {
+        Sampler *sampler;
+        SampleSource source;
+
+        void done(int event)
+        {
+            sampler->read_done(source, event);
+        }
+    };
+
+    // (Re)arm the timer of one sensor and set its output data rate to match
+    void schedule(SampleSource source)
+    {
+        if (_event[source]) {
+            _queue.cancel(_event[source]);
+        }
+        _sensors.start(source, _rate[source]);
+        _event[source] = _queue.call_every(1000000 / _rate[source], this, &Sampler::sample, source);
+    }
+
+    void sample(SampleSource source)
+    {
+#if DEVICE_I2C_ASYNCH
+        if (_sensors.read_async(source, event_callback_t(&_read[source], &Read::done)) != 0) {
+            // The last read is still in flight or the bus refused this one
+            core_util_atomic_incr_u32(&_failed, 1);
+        }
+#else
+        Sample sample;
+
+        if (!_sensors.read(source, sample)) {
+            _failed++;
+            return;
+        }
+        sample.time = Timebase::now();
+        if (!sample_push(_samples, sample)) {
+            _dropped++;
+        }
+#endif
+    }
+
+    // Interrupt context
+    void read_done(SampleSource source, int event)
+    {
+        Sample sample;
+
+        if (event != I2C_EVENT_TRANSFER_COMPLETE) {
+            core_util_atomic_incr_u32(&_failed, 1);
+            return;
+        }
+        _sensors.convert(source, sample);
+        sample.time = Timebase::now();
+        if (!sample_push(_samples, sample)) {
+            _dropped++;
+        }
+    }
+
+    Sensors &_sensors;
+    EventQueue &_queue;
+    SampleQueue &_samples;
+    uint32_t _rate[SAMPLE_SOURCES];
+    int _event[SAMPLE_SOURCES];
+    Read _read[SAMPLE_SOURCES];
+    bool _running;
+    volatile uint32_t _dropped;
+    uint32_t _failed;               // counted from the thread and the interrupt
+};
+
+#endif // SAMPLER_H
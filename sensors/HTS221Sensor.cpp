@@ -0,0 +1,73 @@
+#include "HTS221Sensor.h"
+
+const char HTS221Sensor::name[] = "HTS221";
+
+const SensorChannel HTS221Sensor::channels[HTS221Sensor::CHANNELS] = {
+    { "temperature", "C", FIELD_TEMPERATURE },
+    { "humidity", "%", FIELD_HUMIDITY }
+};
+
+const uint32_t HTS221Sensor::rates[HTS221Sensor::RATES] = { SENSOR_RATE_1HZ, SENSOR_RATE_7HZ, SENSOR_RATE_12R5HZ };
+
+HTS221Sensor::HTS221Sensor(HTS221& hts221) : _hts221(hts221)
+{
+}
+
+bool HTS221Sensor::init(void)
+{
+    bool ok = _hts221.init();
+    return _hts221.calib() && ok;
+}
+
+bool HTS221Sensor::start(uint32_t mhz)
+{
+    switch (mhz) {
+        case SENSOR_RATE_1HZ:    _hts221.odr(ODR_1Hz);    break;
+        case SENSOR_RATE_7HZ:    _hts221.odr(ODR_7Hz);    break;
+        case SENSOR_RATE_12R5HZ: _hts221.odr(ODR_12_5Hz); break;
+        default:                 return false;
+    }
+    return true;
+}
+
+int HTS221Sensor::read_async(const event_callback_t& done)
+{
+#if DEVICE_I2C_ASYNCH
+    _done = done;
+    return _hts221.get_async(Callback<void(int, int16_t, uint16_t)>(this, &HTS221Sensor::async_done));
+#else
+    return -1;
+#endif
+}
+
+#if DEVICE_I2C_ASYNCH
+void HTS221Sensor::async_done(int event, int16_t temperature, uint16_t humidity)
+{
+    // The driver keeps the converted values for convert()
+    if (_done) {
+        _done.call(event);
+    }
+}
+#endif
+
+void HTS221Sensor::convert(Sample& sample)
+{
+    sample.source = SOURCE;
+    sample.temperature = _hts221.temperature_x100();
+    sample.humidity = _hts221.humidity_x10();
+    sample.pressure = 0;
+}
+
+bool HTS221Sensor::read(Sample& sample)
+{
+    if (!_hts221.get()) {
+        return false;
+    }
+    convert(sample);
+    return true;
+}
+
+HTS221& HTS221Sensor::device(void)
+{
+    return _hts221;
+}
@@ -0,0 +1,71 @@
+/*
+ * HTS221 adapter for the sensor registry, see Sensor.h
+ */
+#ifndef HTS221SENSOR_H
+#define HTS221SENSOR_H
+
+#include "mbed.h"
+#include "hts221.h"
+#include "Sensor.h"
+
+class HTS221Sensor
+{
+public:
+    enum {
+        SOURCE = SAMPLE_HTS221,
+        CHANNELS = 2,
+        RATES = 3,
+        DEFAULT_RATE = SENSOR_RATE_1HZ
+    };
+    static const char name[];
+    static const SensorChannel channels[CHANNELS];
+    static const uint32_t rates[RATES];
+
+    HTS221Sensor(HTS221& hts221);
+
+    /** Configure the sensor and load its calibration
+      * @param none
+      * @return false if the sensor did not answer
+      */
+    bool init(void);
+
+    /** Set the output data rate
+      * @param rate in mHz, one of rates[]
+      * @return false if unsupported
+      */
+    bool start(uint32_t mhz);
+
+    /** Start a non-blocking read
+      * @param callback run in interrupt context with the I2C event
+      * @return 0 if started, -1 if busy
+      */
+    int read_async(const event_callback_t& done);
+
+    /** Fill in a sample from the last read
+      * @param sample
+      * @return none
+      */
+    void convert(Sample& sample);
+
+    /** Blocking read and convert
+      * @param sample
+      * @return false if the sensor did not answer
+      */
+    bool read(Sample& sample);
+
+    /** Driver, for what the registry does not cover (data ready, one-shot)
+      * @param none
+      * @return HTS221 instance
+      */
+    HTS221& device(void);
+
+private:
+#if DEVICE_I2C_ASYNCH
+    void async_done(int event, int16_t temperature, uint16_t humidity);
+
+    event_callback_t _done;
+#endif
+    HTS221 &_hts221;
+};
+
+#endif // HTS221SENSOR_H
@@ -0,0 +1,69 @@
+#include "LPS25HSensor.h"
+
+const char LPS25HSensor::name[] = "LPS25H";
+
+const SensorChannel LPS25HSensor::channels[LPS25HSensor::CHANNELS] = {
+    { "pressure", "hPa", FIELD_PRESSURE },
+    { "temperature", "C", FIELD_TEMPERATURE }
+};
+
+const uint32_t LPS25HSensor::rates[LPS25HSensor::RATES] = { SENSOR_RATE_1HZ, SENSOR_RATE_7HZ, SENSOR_RATE_12R5HZ, SENSOR_RATE_25HZ };
+
+LPS25HSensor::LPS25HSensor(LPS25H& lps25h) : _lps25h(lps25h)
+{
+    memset(_raw, 0, sizeof(_raw));
+}
+
+bool LPS25HSensor::init(void)
+{
+    return _lps25h.read_id() == I_AM_LPS25H;
+}
+
+bool LPS25HSensor::start(uint32_t mhz)
+{
+    switch (mhz) {
+        case SENSOR_RATE_1HZ:    _lps25h.odr(ODR_1HZ);    break;
+        case SENSOR_RATE_7HZ:    _lps25h.odr(ODR_7HZ);    break;
+        case SENSOR_RATE_12R5HZ: _lps25h.odr(ODR_12R5HZ); break;
+        case SENSOR_RATE_25HZ:   _lps25h.odr(ODR_25HZ);   break;
+        default:                 return false;
+    }
+    return true;
+}
+
+int LPS25HSensor::read_async(const event_callback_t& done)
+{
+#if DEVICE_I2C_ASYNCH
+    return _lps25h.get_async(_raw, done);
+#else
+    return -1;
+#endif
+}
+
+void LPS25HSensor::convert(Sample& sample)
+{
+    LPS25H_sample_t raw;
+
+    LPS25H::decode(_raw, &raw);
+    sample.source = SOURCE;
+    sample.temperature = raw.temp;
+    sample.humidity = 0;
+    sample.pressure = raw.press;
+}
+
+bool LPS25HSensor::read(Sample& sample)
+{
+    if (!_lps25h.get()) {
+        return false;
+    }
+    sample.source = SOURCE;
+    sample.temperature = _lps25h.temperature_raw();
+    sample.humidity = 0;
+    sample.pressure = _lps25h.pressure_raw();
+    return true;
+}
+
+LPS25H& LPS25HSensor::device(void)
+{
+    return _lps25h;
+}
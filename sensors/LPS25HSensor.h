@@ -0,0 +1,67 @@
+/*
+ * LPS25H adapter for the sensor registry, see Sensor.h
+ */
+#ifndef LPS25HSENSOR_H
+#define LPS25HSENSOR_H
+
+#include "mbed.h"
+#include "LPS25H.h"
+#include "Sensor.h"
+
+class LPS25HSensor
+{
+public:
+    enum {
+        SOURCE = SAMPLE_LPS25H,
+        CHANNELS = 2,
+        RATES = 4,
+        DEFAULT_RATE = SENSOR_RATE_7HZ
+    };
+    static const char name[];
+    static const SensorChannel channels[CHANNELS];
+    static const uint32_t rates[RATES];
+
+    LPS25HSensor(LPS25H& lps25h);
+
+    /** Check the sensor answered, it is configured by its constructor
+      * @param none
+      * @return false if the sensor did not answer
+      */
+    bool init(void);
+
+    /** Set the output data rate
+      * @param rate in mHz, one of rates[]
+      * @return false if unsupported
+      */
+    bool start(uint32_t mhz);
+
+    /** Start a non-blocking read
+      * @param callback run in interrupt context with the I2C event
+      * @return 0 if started, -1 if busy
+      */
+    int read_async(const event_callback_t& done);
+
+    /** Fill in a sample from the last read
+      * @param sample
+      * @return none
+      */
+    void convert(Sample& sample);
+
+    /** Blocking read and convert
+      * @param sample
+      * @return false if the sensor did not answer
+      */
+    bool read(Sample& sample);
+
+    /** Driver, for what the registry does not cover (data ready, one-shot)
+      * @param none
+      * @return LPS25H instance
+      */
+    LPS25H& device(void);
+
+private:
+    LPS25H &_lps25h;
+    char _raw[LPS25H_RAW_SIZE];
+};
+
+#endif // LPS25HSENSOR_H
@@ -0,0 +1,223 @@
+/*
+ * Sensor abstraction
+ *
+ * A sensor is wrapped in an adapter class that provides, without any
+ * virtual function:
+ *
+ *   enum { SOURCE = ..., CHANNELS = n, RATES = m, DEFAULT_RATE = mhz };
+ *   static const char name[];
+ *   static const SensorChannel channels[CHANNELS];
+ *   static const uint32_t rates[RATES];         // supported rates, mHz
+ *   bool init(void);                            // probe and configure
+ *   bool start(uint32_t mhz);                   // run at one of rates[]
+ *   int read_async(const event_callback_t& done);  // fetch raw data
+ *   void convert(Sample& sample);               // raw data of the last read
+ *   bool read(Sample& sample);                  // blocking fetch and convert
+ *
+ * The sensors fitted are listed once as a SensorSet type:
+ *
+ *   typedef SensorSet<HTS221Sensor, SensorSet<LPS25HSensor> > Sensors;
+ *   Sensors sensors(hts221, Sensors::Next(lps25h));
+ *
+ * SensorSet dispatches on the SampleSource with an inlined compare chain
+ * resolved at compile time, so adding a sensor means writing its adapter
+ * and adding it to the list; the acquisition engine stays as it is.
+ *
+ * The periodic engine, Sampler.h, reads with read_async() and fills the
+ * sample with convert() in the completion interrupt. read() is for the
+ * modes that read from the event thread, DataReady and DutyCycle.
+ */
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include "mbed.h"
+#include "Sample.h"
+
+// Rates are given in mHz
+#define SENSOR_RATE_1HZ         1000
+#define SENSOR_RATE_7HZ         7000
+#define SENSOR_RATE_12R5HZ      12500
+#define SENSOR_RATE_25HZ        25000
+
+/** Where a sensor puts a value in a Sample */
+enum SampleField {
+    FIELD_TEMPERATURE,
+    FIELD_HUMIDITY,
+    FIELD_PRESSURE
+};
+
+/** Channel descriptor */
+typedef struct {
+    const char *name;
+    const char *unit;
+    uint8_t field;          // SampleField
+} SensorChannel;
+
+/** End of a sensor list */
+class SensorNil
+{
+public:
+    enum { COUNT = 0 };
+
+    bool init(void) { return true; }
+    bool has(int) { return false; }
+    uint32_t default_rate(int) { return 0; }
+    bool supports(int, uint32_t) { return false; }
+    bool start(int, uint32_t) { return false; }
+    int read_async(int, const event_callback_t&) { return -1; }
+    void convert(int, Sample&) {}
+    bool read(int, Sample&) { return false; }
+    const char *name(int) { return "?"; }
+    const SensorChannel *channels(int, int *count) { *count = 0; return NULL; }
+    const uint32_t *rates(int, int *count) { *count = 0; return NULL; }
+};
+
+/** Compile time list of sensor adapters */
+template <typename S, typename N = SensorNil>
+class SensorSet
+{
+public:
+    typedef S Sensor;
+    typedef N Next;
+    enum { COUNT = 1 + N::COUNT };
+
+    SensorSet(S& sensor, const N& next = N()) : _sensor(sensor), _next(next)
+    {
+    }
+
+    /** Initialise every sensor in the list
+      * @param none
+      * @return false if any of them failed
+      */
+    bool init(void)
+    {
+        bool ok = _sensor.init();
+        return _next.init() && ok;
+    }
+
+    /** Check whether a sensor is in the list
+      * @param SampleSource
+      * @return true if present
+      */
+    bool has(int source)
+    {
+        return source == S::SOURCE || _next.has(source);
+    }
+
+    /** Rate a sensor starts at
+      * @param SampleSource
+      * @return rate in mHz, 0 if the source is not in the list
+      */
+    uint32_t default_rate(int source)
+    {
+        return source == S::SOURCE ? (uint32_t)S::DEFAULT_RATE : _next.default_rate(source);
+    }
+
+    /** Check a rate against the sensor's list
+      * @param SampleSource
+      * @param rate in mHz
+      * @return true if supported
+      */
+    bool supports(int source, uint32_t mhz)
+    {
+        if (source != S::SOURCE) {
+            return _next.supports(source, mhz);
+        }
+        for (int i = 0; i < S::RATES; i++) {
+            if (S::rates[i] == mhz) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Start one sensor at a rate
+      * @param SampleSource
+      * @param rate in mHz
+      * @return false if unknown or unsupported
+      */
+    bool start(int source, uint32_t mhz)
+    {
+        return source == S::SOURCE ? _sensor.start(mhz) : _next.start(source, mhz);
+    }
+
+    /** Start a non-blocking read of one sensor
+      * @param SampleSource
+      * @param callback run in interrupt context with the I2C event
+      * @return 0 if started, -1 if busy or the source is not in the list
+      */
+    int read_async(int source, const event_callback_t& done)
+    {
+        return source == S::SOURCE ? _sensor.read_async(done) : _next.read_async(source, done);
+    }
+
+    /** Fill in a sample from the last non-blocking read of one sensor
+      * @param SampleSource
+      * @param sample to fill in, apart from the time
+      * @return none
+      */
+    void convert(int source, Sample& sample)
+    {
+        if (source != S::SOURCE) {
+            _next.convert(source, sample);
+            return;
+        }
+        _sensor.convert(sample);
+    }
+
+    /** Blocking read of one sensor
+      * @param SampleSource
+      * @param sample to fill in, apart from the time
+      * @return false if the source is not in the list or the read failed
+      */
+    bool read(int source, Sample& sample)
+    {
+        if (source != S::SOURCE) {
+            return _next.read(source, sample);
+        }
+        return _sensor.read(sample);
+    }
+
+    /** Sensor name
+      * @param SampleSource
+      * @return name, "?" if the source is not in the list
+      */
+    const char *name(int source)
+    {
+        return source == S::SOURCE ? S::name : _next.name(source);
+    }
+
+    /** Channel descriptors
+      * @param SampleSource
+      * @param set to the number of channels
+      * @return descriptors
+      */
+    const SensorChannel *channels(int source, int *count)
+    {
+        if (source != S::SOURCE) {
+            return _next.channels(source, count);
+        }
+        *count = S::CHANNELS;
+        return S::channels;
+    }
+
+    /** Supported rates
+      * @param SampleSource
+      * @param set to the number of rates
+      * @return rates in mHz, ascending
+      */
+    const uint32_t *rates(int source, int *count)
+    {
+        if (source != S::SOURCE) {
+            return _next.rates(source, count);
+        }
+        *count = S::RATES;
+        return S::rates;
+    }
+
+private:
+    S &_sensor;
+    N _next;
+};
+
+#endif // SENSOR_H
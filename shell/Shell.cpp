@@ -0,0 +1,94 @@
+#include "Shell.h"
+
+Shell::Shell(const ShellCommand *commands, int count)
+    : _commands(commands), _count(count), _length(0), _overflow(false)
+{
+}
+
+void Shell::input(char c)
+{
+    if (c == '\r' || c == '\n') {
+        if (_length > 0 || _overflow) {
+            printf("\r\n");
+            if (_overflow) {
+                printf("Line too long\r\n");
+            } else {
+                _line[_length] = '\0';
+                execute();
+            }
+        }
+        _length = 0;
+        _overflow = false;
+        return;
+    }
+    if (c == '\b' || c == 0x7f) {
+        if (_length > 0) {
+            _length--;
+            printf("\b \b");
+        }
+        return;
+    }
+    if (c < ' ' || c > '~') {
+        return;
+    }
+    if (_length == SHELL_LINE_MAX) {
+        _overflow = true;
+        return;
+    }
+    _line[_length++] = c;
+    putchar(c);
+}
+
+bool Shell::idle(void)
+{
+    return _length == 0 && !_overflow;
+}
+
+void Shell::help(void)
+{
+    for (int i = 0; i < _count; i++) {
+        printf("  %s %s\r\n", _commands[i].name, _commands[i].usage);
+    }
+}
+
+void Shell::execute(void)
+{
+    char *argv[SHELL_MAX_ARGS];
+    int argc = 0;
+    char *p = _line;
+
+    // Split in place, every run of spaces ends an argument
+    while (*p) {
+        while (*p == ' ') {
+            *p++ = '\0';
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (argc == SHELL_MAX_ARGS) {
+            printf("Too many arguments\r\n");
+            return;
+        }
+        argv[argc++] = p;
+        while (*p && *p != ' ') {
+            p++;
+        }
+    }
+    if (argc == 0) {
+        return;
+    }
+
+    for (int i = 0; i < _count; i++) {
+        const ShellCommand *command = &_commands[i];
+        if (strcmp(argv[0], command->name) != 0) {
+            continue;
+        }
+        if (argc - 1 < command->min_args || argc - 1 > command->max_args) {
+            printf("Usage: %s %s\r\n", command->name, command->usage);
+        } else {
+            command->run(argc, argv);
+        }
+        return;
+    }
+    printf("Unknown command '%s', try help\r\n", argv[0]);
+}
@@ -0,0 +1,68 @@
+/*
+ * Line oriented command shell
+ *
+ * Commands are described by a constant table of ShellCommand entries:
+ * name, usage text, argument count limits and a handler taking the
+ * arguments as argc/argv. Received characters are collected in a fixed
+ * line buffer; at the end of the line it is split in place on spaces and
+ * the handler of the matching entry is called, so nothing is allocated
+ * and adding a command means adding a table entry.
+ *
+ * Backspace edits the line and typed characters are echoed. A line that
+ * does not fit in the buffer is dropped as a whole.
+ */
+#ifndef SHELL_H
+#define SHELL_H
+
+#include "mbed.h"
+
+#define SHELL_LINE_MAX      64      // characters per line
+#define SHELL_MAX_ARGS      8       // including the command name
+
+/** Command table entry */
+typedef struct {
+    const char *name;
+    const char *usage;      // arguments, for help and errors
+    uint8_t min_args;       // not counting the name
+    uint8_t max_args;
+    void (*run)(int argc, char *argv[]);    // argv[0] is the name
+} ShellCommand;
+
+class Shell
+{
+public:
+    /** Bind a command table
+      * @param commands
+      * @param number of entries
+      */
+    Shell(const ShellCommand *commands, int count);
+
+    /** Feed one received character, running the command at the end of a line
+      * @param character
+      * @return none
+      */
+    void input(char c);
+
+    /** Check for a partly typed line
+      * @param none
+      * @return true if nothing has been typed since the last end of line
+      */
+    bool idle(void);
+
+    /** Print every command with its usage
+      * @param none
+      * @return none
+      */
+    void help(void);
+
+private:
+    void execute(void);
+
+    const ShellCommand *_commands;
+    int _count;
+    char _line[SHELL_LINE_MAX + 1];
+    int _length;
+    bool _overflow;
+};
+
+#endif // SHELL_H
@@ -0,0 +1,110 @@
+#include <string.h>
+#include "Telemetry.h"
+
+size_t Telemetry::encode(const Sample& sample, uint8_t *frame)
+{
+    uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+    size_t n = 0;
+    uint16_t crc;
+
+    payload[n++] = sample.source;
+    for (int i = 0; i < 64; i += 8) {
+        payload[n++] = sample.time >> i;
+    }
+    payload[n++] = (uint16_t)sample.temperature;
+    payload[n++] = (uint16_t)sample.temperature >> 8;
+    if (sample.source == SAMPLE_HTS221) {
+        payload[n++] = sample.humidity;
+        payload[n++] = sample.humidity >> 8;
+    } else {
+        payload[n++] = sample.pressure;
+        payload[n++] = sample.pressure >> 8;
+        payload[n++] = sample.pressure >> 16;
+    }
+    crc = crc16(payload, n);
+    payload[n++] = crc;
+    payload[n++] = crc >> 8;
+
+    n = cobs_encode(payload, n, frame);
+    frame[n++] = 0x00;
+    return n;
+}
+
+size_t Telemetry::encode(const RuleEvent& event, uint8_t *frame)
+{
+    uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+    size_t n = 0;
+    uint16_t crc;
+
+    payload[n++] = TELEMETRY_EVENT;
+    for (int i = 0; i < 64; i += 8) {
+        payload[n++] = event.time >> i;
+    }
+    payload[n++] = event.rule;
+    payload[n++] = event.active;
+    for (int i = 0; i < 32; i += 8) {
+        payload[n++] = (uint32_t)event.value >> i;
+    }
+    crc = crc16(payload, n);
+    payload[n++] = crc;
+    payload[n++] = crc >> 8;
+
+    n = cobs_encode(payload, n, frame);
+    frame[n++] = 0x00;
+    return n;
+}
+
+size_t Telemetry::encode_log(uint32_t first, uint8_t records, const uint8_t *data, size_t length, uint8_t *frame)
+{
+    uint8_t payload[TELEMETRY_LOG_FRAME - 2];
+    size_t n = 0;
+    uint16_t crc;
+
+    payload[n++] = TELEMETRY_LOG;
+    for (int i = 0; i < 32; i += 8) {
+        payload[n++] = first >> i;
+    }
+    payload[n++] = records;
+    memcpy(&payload[n], data, length);
+    n += length;
+    crc = crc16(payload, n);
+    payload[n++] = crc;
+    payload[n++] = crc >> 8;
+
+    n = cobs_encode(payload, n, frame);
+    frame[n++] = 0x00;
+    return n;
+}
+
+uint16_t Telemetry::crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xffff;
+
+    while (length--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+size_t Telemetry::cobs_encode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] == 0) {
+            output[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            output[out++] = input[i];
+            code++;
+        }
+    }
+    output[code_pos] = code;
+    return out;
+}
@@ -0,0 +1,83 @@
+/*
+ * Binary telemetry framing
+ *
+ * A sample is sent as a COBS encoded frame terminated by a 0x00 byte, so a
+ * receiver can always resynchronise on the next zero. Before encoding the
+ * frame holds, little-endian:
+ *
+ *   HTS221: 0x00, time (u64, us), temperature (s16, 0.01 degC), humidity (u16, 0.1 %RH), CRC
+ *   LPS25H: 0x01, time (u64, us), temperature (s16, raw), pressure (u24, raw), CRC
+ *   event:  0x80, time (u64, us), rule (u8), active (u8), value (s32, rule's units), CRC
+ *   log:    0x81, index of the first record (u32), records (u8), data, CRC
+ *
+ * The data of a log frame are history records coded as in compress/Delta.h,
+ * from a fresh stream, with the values as in samplelog/SampleLog.h. Each
+ * frame decodes on its own, so a dump costs a few bytes per record on the
+ * wire and a corrupted frame loses only its own records.
+ *
+ * CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff) over the preceding
+ * bytes. A frame is 17 or 18 bytes on the wire against about 30 for the
+ * text output, and no float formatting is involved. tools/telemetry.py
+ * decodes the stream on the host.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Sample.h"
+#include "Rules.h"
+
+#define TELEMETRY_EVENT         0x80    // first byte of a rule event frame
+#define TELEMETRY_LOG           0x81    // first byte of a history frame
+#define TELEMETRY_MAX_PAYLOAD   17
+// COBS adds one byte per 254 plus the leading code byte, then the delimiter
+#define TELEMETRY_MAX_FRAME     (TELEMETRY_MAX_PAYLOAD + 2)
+// A log frame stays within one COBS block
+#define TELEMETRY_LOG_DATA      240
+#define TELEMETRY_LOG_FRAME     (1 + 4 + 1 + TELEMETRY_LOG_DATA + 2 + 2)
+
+class Telemetry
+{
+public:
+    /** Build the frame for one sample
+      * @param sample
+      * @param frame buffer of TELEMETRY_MAX_FRAME bytes
+      * @return frame length including the 0x00 delimiter
+      */
+    static size_t encode(const Sample& sample, uint8_t *frame);
+
+    /** Build the frame for one rule event
+      * @param event
+      * @param frame buffer of TELEMETRY_MAX_FRAME bytes
+      * @return frame length including the 0x00 delimiter
+      */
+    static size_t encode(const RuleEvent& event, uint8_t *frame);
+
+    /** Build the frame for a run of compressed history records
+      * @param index of the first record
+      * @param number of records
+      * @param data, at most TELEMETRY_LOG_DATA bytes
+      * @param length of the data
+      * @param frame buffer of TELEMETRY_LOG_FRAME bytes
+      * @return frame length including the 0x00 delimiter
+      */
+    static size_t encode_log(uint32_t first, uint8_t records, const uint8_t *data, size_t length, uint8_t *frame);
+
+    /** CRC-16/CCITT-FALSE
+      * @param data
+      * @param length
+      * @return crc
+      */
+    static uint16_t crc16(const uint8_t *data, size_t length);
+
+    /** COBS encode a block, the delimiter is not appended
+      * @param input
+      * @param length, at most 254
+      * @param output buffer of length + 1 bytes
+      * @return encoded length
+      */
+    static size_t cobs_encode(const uint8_t *input, size_t length, uint8_t *output);
+};
+
+#endif // TELEMETRY_H
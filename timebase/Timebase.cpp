@@ -0,0 +1,47 @@
+#include "Timebase.h"
+#include "rtc_api.h"
+
+Timebase::Base Timebase::_base[2];
+volatile uint8_t Timebase::_current = 0;
+time_t Timebase::_rtc = 0;
+uint64_t Timebase::_rtc_time = 0;
+
+static Ticker timebase_ticker;
+
+bool Timebase::start(void)
+{
+    time_t rtc;
+
+    timebase_ticker.attach_us(&Timebase::refresh, TIMEBASE_REFRESH_S * 1000000U);
+
+    if (!rtc_isenabled()) {
+        return false;
+    }
+    // Anchor on a seconds edge, the RTC has no finer reading
+    rtc = rtc_read();
+    uint64_t timeout = now() + 1100000;
+    while (rtc_read() == rtc && now() < timeout);
+    _rtc_time = now();
+    _rtc = rtc_read();
+    return true;
+}
+
+uint64_t Timebase::epoch(uint64_t time)
+{
+    return (uint64_t)_rtc * 1000000 + (int64_t)(time - _rtc_time);
+}
+
+time_t Timebase::anchor(void)
+{
+    return _rtc;
+}
+
+// Ticker interrupt: take a new base in the spare slot, then publish it
+void Timebase::refresh(void)
+{
+    uint8_t spare = _current ^ 1;
+
+    _base[spare].ticker = us_ticker_read();
+    _base[spare].time = _base[_current].time + (uint32_t)(_base[spare].ticker - _base[_current].ticker);
+    _current = spare;
+}
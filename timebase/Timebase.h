@@ -0,0 +1,73 @@
+/*
+ * 64-bit microsecond time base
+ *
+ * The 32-bit us_ticker wraps every 71.6 minutes. Timebase extends it to a
+ * monotonic 64-bit count of microseconds since start-up: a Ticker refreshes
+ * a 64-bit base well inside each wrap period, and now() adds the ticker
+ * time elapsed since the base to it.
+ *
+ * The base is double buffered. The refresh fills the spare slot and then
+ * publishes it with a single word write, so now() reads one index, two
+ * words and the ticker, with no critical section and no retry loop, and
+ * is safe from threads and interrupt handlers alike.
+ *
+ * start() also anchors the time base to the RTC, taken on a seconds edge,
+ * so sample times can be turned into calendar time and lined up with
+ * other logs.
+ */
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "mbed.h"
+
+// Well inside the 4294 s wrap period of the 32-bit ticker
+#define TIMEBASE_REFRESH_S      1800
+
+class Timebase
+{
+public:
+    /** Start the refresh and anchor to the RTC
+      *  Waits for the next RTC seconds edge, up to one second.
+      * @param none
+      * @return false if the RTC is not running, epoch() is then uptime only
+      */
+    static bool start(void);
+
+    /** Current time
+      *  Valid before start() for the first wrap period of the ticker.
+      * @param none
+      * @return microseconds since start-up
+      */
+    static inline uint64_t now(void)
+    {
+        const Base *base = &_base[_current];
+        return base->time + (uint32_t)(us_ticker_read() - base->ticker);
+    }
+
+    /** Convert a time to calendar time
+      * @param time from now()
+      * @return microseconds since 1970-01-01 00:00:00 UTC, per the RTC
+      */
+    static uint64_t epoch(uint64_t time);
+
+    /** RTC anchor
+      * @param none
+      * @return RTC seconds at the anchor, 0 if the RTC is not running
+      */
+    static time_t anchor(void);
+
+private:
+    static void refresh(void);
+
+    struct Base {
+        uint64_t time;      // now() when the base was taken
+        uint32_t ticker;    // us_ticker_read() at the same moment
+    };
+
+    static Base _base[2];
+    static volatile uint8_t _current;
+    static time_t _rtc;         // RTC seconds at the anchor
+    static uint64_t _rtc_time;  // now() at the anchor
+};
+
+#endif // TIMEBASE_H
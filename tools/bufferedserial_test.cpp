@@ -0,0 +1,291 @@
+/*
+ * Host tests of the buffered console port, bufferedserial/BufferedSerial.h
+ *
+ *   g++ -O2 -Itools/host -Ibufferedserial tools/bufferedserial_test.cpp \
+ *       bufferedserial/BufferedSerial.cpp tools/host/MockI2C.cpp -o bufferedserial_test
+ *   ./bufferedserial_test
+ *
+ * The real driver runs on the simulated UART of tools/host/MockSerial.h,
+ * with the default ring sizes. Checks that the TX ring goes out in order
+ * as one transmit per contiguous stretch, split at the end of the ring,
+ * that a transmit the HAL refuses is retried by the next write, that
+ * output from interrupt context is dropped and counted once the ring is
+ * full, that the free running head and tail stay right as they wrap past
+ * 2^32, and that received bytes read back in order across the end of the
+ * RX ring with the overflow counted. The high-water marks are checked
+ * along the way, and after clear_stats(). A thread waiting for room is
+ * not covered: nothing drains the ring while the single threaded test
+ * waits. The exit status is 1 if a check fails.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "mbed.h"
+#include "BufferedSerial.h"
+#include "host/check.h"
+
+// Byte n of a test stream
+static uint8_t pattern(uint32_t n)
+{
+    return (uint8_t)(n * 31 + (n >> 8) + 7);
+}
+
+static void fill(uint8_t *buffer, uint32_t first, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = pattern(first + i);
+    }
+}
+
+/** What went out on the line, a transmit at a time */
+struct Line {
+    std::vector<uint8_t> bytes;
+    std::vector<int> transfers;     // length of each
+
+    // Send the transmit in flight, which may start the next
+    bool step(BufferedSerial& port)
+    {
+        int n = port.tx_length();
+
+        if (n == 0) {
+            return false;
+        }
+        bytes.insert(bytes.end(), port.tx_data(), port.tx_data() + n);
+        transfers.push_back(n);
+        port.tx_complete();
+        return true;
+    }
+
+    void drain(BufferedSerial& port)
+    {
+        while (step(port)) {
+        }
+    }
+
+    // The line must carry pattern(first) on
+    bool carries(uint32_t first) const
+    {
+        for (size_t i = 0; i < bytes.size(); i++) {
+            if (bytes[i] != pattern(first + i)) {
+                printf("FAIL byte %zu on the line is 0x%02x, expected 0x%02x\n", i, bytes[i],
+                       pattern(first + i));
+                failures++;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+static void test_write(void)
+{
+    BufferedSerial port(USBTX, USBRX);
+    uint8_t data[1100];
+    Line line;
+
+    fill(data, 0, sizeof(data));
+    CHECK(port.write(data, 5) == 5, "short write not taken");
+    CHECK(port.tx_length() == 5, "short write sent as %d bytes", port.tx_length());
+    CHECK(port.stats().tx_bytes == 5 && port.stats().tx_transfers == 1, "short write counted as %lu bytes, %lu transfers",
+          (unsigned long)port.stats().tx_bytes, (unsigned long)port.stats().tx_transfers);
+    CHECK(port.stats().tx_high_water == 5, "high water %lu after 5 bytes", (unsigned long)port.stats().tx_high_water);
+    // Written during the transmit, so it waits for the completion
+    port.putc(data[5]);
+    CHECK(port.tx_length() == 5, "a second transmit started during the first");
+    CHECK(port.stats().tx_high_water == 6, "high water %lu after 6 bytes", (unsigned long)port.stats().tx_high_water);
+    line.drain(port);
+    CHECK(line.transfers.size() == 2 && line.transfers[1] == 1, "putc() sent in %zu transfers", line.transfers.size());
+
+    // Up to 24 bytes short of the end of the ring, then 100 across it
+    CHECK(port.write(data + 6, 994) == 994, "long write not taken");
+    line.drain(port);
+    CHECK(port.write(data + 1000, 100) == 100, "write across the end not taken");
+    CHECK(port.tx_length() == 24, "transmit up to the end of the ring is %d bytes", port.tx_length());
+    line.step(port);
+    CHECK(port.tx_length() == 76, "transmit from the start of the ring is %d bytes", port.tx_length());
+    line.drain(port);
+    CHECK(port.stats().tx_high_water == 994, "high water %lu after 994 bytes", (unsigned long)port.stats().tx_high_water);
+    CHECK(line.bytes.size() == 1100, "%zu bytes on the line, expected 1100", line.bytes.size());
+    line.carries(0);
+    CHECK(port.stats().tx_waits == 0 && port.stats().tx_dropped == 0, "waits or drops without a full ring");
+}
+
+static void test_refused(void)
+{
+    BufferedSerial port(USBTX, USBRX);
+    uint8_t data[16];
+    Line line;
+
+    fill(data, 0, sizeof(data));
+    port.refuse_tx(true);
+    CHECK(port.write(data, 10) == 10, "write not queued while the UART is taken");
+    CHECK(port.tx_length() == 0 && port.stats().tx_transfers == 0, "refused transmit counted");
+    port.refuse_tx(false);
+    port.write(data + 10, 6);
+    CHECK(port.tx_length() == 16, "retry sent %d bytes, expected 16", port.tx_length());
+    line.drain(port);
+    CHECK(line.bytes.size() == 16 && port.stats().tx_transfers == 1, "retry gave %zu bytes in %lu transfers",
+          line.bytes.size(), (unsigned long)port.stats().tx_transfers);
+    line.carries(0);
+}
+
+static void test_isr_full(void)
+{
+    BufferedSerial port(USBTX, USBRX);
+    uint8_t data[BUFFERED_SERIAL_TX_SIZE + 100];
+    Line line;
+
+    fill(data, 0, sizeof(data));
+    CHECK(port.write(data, BUFFERED_SERIAL_TX_SIZE) == BUFFERED_SERIAL_TX_SIZE, "ring not filled");
+    CHECK(port.stats().tx_high_water == BUFFERED_SERIAL_TX_SIZE, "high water %lu with the ring full",
+          (unsigned long)port.stats().tx_high_water);
+    {
+        MockIsr isr;
+
+        // Taken as written, the interrupt cannot do anything with a shortfall
+        CHECK(port.write(data + BUFFERED_SERIAL_TX_SIZE, 10) == 10, "write from an interrupt not returned");
+    }
+    CHECK(port.stats().tx_dropped == 10, "%lu bytes dropped with the ring full, expected 10",
+          (unsigned long)port.stats().tx_dropped);
+
+    // The first transmit was the first chunk, its room takes part of the next write
+    int room = port.tx_length();
+    line.step(port);
+    {
+        MockIsr isr;
+
+        port.write(data + BUFFERED_SERIAL_TX_SIZE, 100);
+    }
+    CHECK(port.stats().tx_dropped == 10 + (uint32_t)(100 - room), "%lu bytes dropped, expected %d",
+          (unsigned long)port.stats().tx_dropped, 10 + 100 - room);
+    CHECK(port.stats().tx_bytes == (uint32_t)(BUFFERED_SERIAL_TX_SIZE + room), "%lu bytes queued, expected %d",
+          (unsigned long)port.stats().tx_bytes, BUFFERED_SERIAL_TX_SIZE + room);
+    line.drain(port);
+    CHECK(line.bytes.size() == (size_t)(BUFFERED_SERIAL_TX_SIZE + room), "%zu bytes on the line, expected %d",
+          line.bytes.size(), BUFFERED_SERIAL_TX_SIZE + room);
+    line.carries(0);
+    CHECK(port.stats().tx_waits == 0, "an interrupt waited for room");
+}
+
+// Free running counts past 2^32: fill, send in stretches and count right
+static void test_wrap(void)
+{
+    BufferedSerial port(USBTX, USBRX);
+    static uint8_t data[BUFFERED_SERIAL_TX_SIZE];
+    const uint32_t before = 100;            // bytes short of 2^32 to stop at
+    uint64_t pumped = 0;
+    Line line;
+
+    fill(data, 0, sizeof(data));
+    while (pumped < (1ULL << 32) - before) {
+        uint64_t n = (1ULL << 32) - before - pumped;
+
+        if (n > sizeof(data)) {
+            n = sizeof(data);
+        }
+        port.write(data, (size_t)n);
+        while (port.tx_length()) {
+            port.tx_complete();
+        }
+        pumped += n;
+    }
+    CHECK(port.stats().tx_bytes == (uint32_t)-before, "%lu bytes counted before the wrap",
+          (unsigned long)port.stats().tx_bytes);
+
+    port.clear_stats();
+    CHECK(port.stats().tx_high_water == 0, "high water %lu after clear_stats() with the ring empty",
+          (unsigned long)port.stats().tx_high_water);
+    uint8_t across[300];
+    fill(across, 0, sizeof(across));
+    CHECK(port.write(across, sizeof(across)) == (ssize_t)sizeof(across), "write across 2^32 not taken");
+    // A sign or wrap slip shows as a fill near 2^32 here
+    CHECK(port.stats().tx_high_water == sizeof(across), "high water %lu across 2^32, expected %zu",
+          (unsigned long)port.stats().tx_high_water, sizeof(across));
+    line.drain(port);
+    CHECK(line.transfers.size() == 3 && line.transfers[0] + line.transfers[1] == (int)before &&
+          line.transfers[2] == (int)(sizeof(across) - before), "wrap sent in %zu transfers, not split at the end",
+          line.transfers.size());
+    CHECK(line.bytes.size() == sizeof(across), "%zu bytes on the line across 2^32, expected %zu", line.bytes.size(),
+          sizeof(across));
+    line.carries(0);
+    CHECK(port.stats().tx_bytes == sizeof(across), "%lu bytes counted after the wrap",
+          (unsigned long)port.stats().tx_bytes);
+
+    // And the clear takes the fill at the time
+    port.write(across, 50);
+    port.clear_stats();
+    CHECK(port.stats().tx_high_water == 50, "high water %lu after clear_stats() with 50 bytes queued",
+          (unsigned long)port.stats().tx_high_water);
+}
+
+static void test_read(void)
+{
+    BufferedSerial port(USBTX, USBRX);
+    uint8_t in[BUFFERED_SERIAL_RX_SIZE * 2], out[BUFFERED_SERIAL_RX_SIZE];
+    uint32_t sent = 0, got = 0;
+    ssize_t n;
+
+    fill(in, 0, sizeof(in));
+    port.rx(in, 10);
+    sent = 10;
+    CHECK(port.available() == 10 && port.stats().rx_bytes == 10, "%lu bytes available after 10",
+          (unsigned long)port.available());
+    CHECK(port.stats().rx_high_water == 10, "RX high water %lu after 10 bytes", (unsigned long)port.stats().rx_high_water);
+    n = port.read(out, 4);
+    CHECK(n == 4 && out[0] == pattern(0) && out[3] == pattern(3), "read 4 gave %zd bytes", n);
+    CHECK(port.getc() == pattern(4), "getc() out of order");
+    got = 5;
+
+    // Overflow: what does not fit is dropped, the ring keeps the oldest
+    port.rx(in + sent, BUFFERED_SERIAL_RX_SIZE);
+    CHECK(port.stats().rx_dropped == 5, "%lu bytes dropped, expected 5", (unsigned long)port.stats().rx_dropped);
+    CHECK(port.stats().rx_high_water == BUFFERED_SERIAL_RX_SIZE, "RX high water %lu with the ring full",
+          (unsigned long)port.stats().rx_high_water);
+    n = port.read(out, sizeof(out));
+    CHECK(n == BUFFERED_SERIAL_RX_SIZE, "read of a full ring gave %zd bytes", n);
+    for (ssize_t i = 0; i < n; i++) {
+        if (out[i] != pattern(got + i)) {
+            CHECK(false, "byte %zd of a full ring read back wrong", i);
+            break;
+        }
+    }
+    sent = 0;
+    got = 0;
+    port.clear_stats();
+
+    // Bursts and reads of every size, across the end of the ring many times
+    srand(5);
+    for (int round = 0; round < 10000; round++) {
+        uint32_t burst = rand() % (BUFFERED_SERIAL_RX_SIZE - port.available() + 1);
+
+        fill(in, sent, burst);
+        port.rx(in, burst);
+        sent += burst;
+        if (port.available() == 0) {
+            continue;
+        }
+        n = port.read(out, rand() % BUFFERED_SERIAL_RX_SIZE + 1);
+        for (ssize_t i = 0; i < n; i++) {
+            if (out[i] != pattern(got + i)) {
+                CHECK(false, "round %d: byte %lu read back wrong", round, (unsigned long)(got + i));
+                round = 10000;
+                break;
+            }
+        }
+        got += n;
+    }
+    CHECK(port.stats().rx_dropped == 0 && port.stats().rx_bytes == sent, "%lu of %lu bytes received, %lu dropped",
+          (unsigned long)port.stats().rx_bytes, (unsigned long)sent, (unsigned long)port.stats().rx_dropped);
+    CHECK(port.available() == sent - got, "%lu bytes available, expected %lu", (unsigned long)port.available(),
+          (unsigned long)(sent - got));
+}
+
+int main(void)
+{
+    test_write();
+    test_refused();
+    test_isr_full();
+    test_wrap();
+    test_read();
+    return check_report();
+}
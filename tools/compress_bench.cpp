@@ -0,0 +1,174 @@
+/*
+ * Host benchmark of the history compression, compress/Delta.h
+ *
+ *   g++ -O2 -Icompress tools/compress_bench.cpp compress/Delta.cpp -o compress_bench
+ *   ./compress_bench capture.csv ...      # output of tools/telemetry.py
+ *   ./compress_bench                      # synthetic day of 1 Hz readings
+ *
+ * A dataset is coded as one stream and in SampleLog's 256 byte blocks.
+ * The ratio is given against the 8 byte packed record the history used
+ * before, throughput against the 16 byte DeltaRecord, and every record is
+ * checked to decode back unchanged.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "Delta.h"
+
+#define PACKED_RECORD   8
+#define BLOCK_SIZE      256     // SAMPLE_LOG_BLOCK_SIZE
+#define REPEAT          200
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// LOG lines are taken as they are; HTS221 lines become records with the
+// latest LPS25H pressure, as the device logs them
+static bool load(const char *path, std::vector<DeltaRecord> *records)
+{
+    FILE *f = fopen(path, "r");
+    char line[256];
+    int32_t pressure = 0;
+
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        DeltaRecord r;
+        unsigned long index;
+        unsigned long long us;
+        double a, b, c;
+
+        if (sscanf(line, "LOG,%lu,%llu,%lf,%lf,%lf", &index, &us, &a, &b, &c) == 5) {
+            r.time = (uint32_t)us;
+            r.value[0] = (int32_t)(a * 100 + (a < 0 ? -0.5 : 0.5));
+            r.value[1] = (int32_t)(b * 10 + 0.5);
+            r.value[2] = (int32_t)(c * 4096 + 0.5);
+            records->push_back(r);
+        } else if (sscanf(line, "LPS25H,%llu,%lf,%lf", &us, &a, &c) == 3) {
+            pressure = (int32_t)(c * 4096 + 0.5);
+        } else if (sscanf(line, "HTS221,%llu,%lf,%lf", &us, &a, &b) == 3) {
+            r.time = (uint32_t)(us / 1000);
+            r.value[0] = (int32_t)(a * 100 + (a < 0 ? -0.5 : 0.5));
+            r.value[1] = (int32_t)(b * 10 + 0.5);
+            r.value[2] = pressure;
+            records->push_back(r);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// A day at 1 Hz: slow drifts plus sensor noise, with a little timing jitter
+static void synthesise(std::vector<DeltaRecord> *records)
+{
+    DeltaRecord r = { 0, { 2150, 455, 1013 * 4096 } };
+
+    srand(1);
+    for (int i = 0; i < 86400; i++) {
+        r.time += 1000 + (rand() % 8 == 0 ? rand() % 5 - 2 : 0);
+        r.value[0] += rand() % 5 - 2;
+        r.value[1] += rand() % 3 - 1;
+        r.value[2] += rand() % 41 - 20;
+        if (r.value[1] < 0) {
+            r.value[1] = 0;
+        }
+        records->push_back(r);
+    }
+}
+
+static void run(const char *name, const std::vector<DeltaRecord>& records)
+{
+    size_t count = records.size();
+    std::vector<uint8_t> stream(count * DELTA_MAX_RECORD);
+    std::vector<DeltaRecord> decoded(count);
+    DeltaEncoder encoder;
+    DeltaDecoder decoder;
+    size_t length = 0, block = 0, blocked = 0, offset, n, i;
+    uint8_t code[DELTA_MAX_RECORD];
+    double start, encode_s, decode_s;
+    int pass;
+
+    if (count == 0) {
+        printf("%s: no records\n", name);
+        return;
+    }
+
+    start = seconds();
+    for (pass = 0; pass < REPEAT; pass++) {
+        encoder.reset();
+        length = 0;
+        for (i = 0; i < count; i++) {
+            length += encoder.encode(records[i], &stream[length]);
+        }
+    }
+    encode_s = (seconds() - start) / REPEAT;
+
+    start = seconds();
+    for (pass = 0; pass < REPEAT; pass++) {
+        decoder.reset();
+        offset = 0;
+        for (i = 0; i < count; i++) {
+            n = decoder.decode(&stream[offset], length - offset, &decoded[i]);
+            if (n == 0) {
+                break;
+            }
+            offset += n;
+        }
+    }
+    decode_s = (seconds() - start) / REPEAT;
+
+    for (i = 0; i < count; i++) {
+        if (memcmp(&records[i], &decoded[i], sizeof(DeltaRecord)) != 0) {
+            printf("%s: record %zu does not decode back\n", name, i);
+            exit(1);
+        }
+    }
+
+    // As SampleLog stores it: a fresh stream per block, unused tails count
+    encoder.reset();
+    for (i = 0; i < count; i++) {
+        n = encoder.encode(records[i], code);
+        if (i == 0 || block + n > BLOCK_SIZE) {
+            blocked += i ? BLOCK_SIZE : 0;
+            encoder.reset();
+            n = encoder.encode(records[i], code);
+            block = 0;
+        }
+        block += n;
+    }
+    blocked += BLOCK_SIZE;
+
+    printf("%s: %zu records\n", name, count);
+    printf("  stream  %zu bytes, %.2f bytes/record, %.2fx packed, %.2fx raw\n", length,
+           (double)length / count, (double)count * PACKED_RECORD / length,
+           (double)count * sizeof(DeltaRecord) / length);
+    printf("  blocks  %zu bytes, %.2f bytes/record, %.2fx packed\n", blocked,
+           (double)blocked / count, (double)count * PACKED_RECORD / blocked);
+    printf("  encode  %.1f MB/s, decode %.1f MB/s (raw records)\n",
+           count * sizeof(DeltaRecord) / encode_s / 1e6, count * sizeof(DeltaRecord) / decode_s / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::vector<DeltaRecord> records;
+        synthesise(&records);
+        run("synthetic", records);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        std::vector<DeltaRecord> records;
+        if (load(argv[i], &records)) {
+            run(argv[i], records);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * Host tests of the delta codec, compress/Delta.h
+ *
+ *   g++ -O2 -Icompress tools/delta_test.cpp compress/Delta.cpp -o delta_test
+ *   ./delta_test
+ *
+ * Checks the coded size at each boundary of the zigzag size codes and
+ * that differences as far apart as INT32_MIN and INT32_MAX, and times
+ * wrapping past 2^32 with any change of period, decode back unchanged.
+ * Every record cut short must make decode() return 0 without touching
+ * the decoder, so the whole record still decodes after it. reset() must
+ * make a block decodable on its own, whatever the decoder did before,
+ * and code it as a fresh encoder would. The exit status is 1 if a check
+ * fails. tools/compress_bench.cpp gives the ratio and speed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Delta.h"
+#include "host/check.h"
+
+static bool same(const DeltaRecord& a, const DeltaRecord& b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+static DeltaRecord record(uint32_t time, int32_t a, int32_t b, int32_t c)
+{
+    DeltaRecord r;
+
+    r.time = time;
+    r.value[0] = a;
+    r.value[1] = b;
+    r.value[2] = c;
+    return r;
+}
+
+/** A coded stream and where each record of it starts */
+struct Stream {
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> starts;
+    std::vector<DeltaRecord> records;
+
+    void add(DeltaEncoder& encoder, const DeltaRecord& r)
+    {
+        uint8_t out[DELTA_MAX_RECORD];
+        size_t n = encoder.encode(r, out);
+
+        starts.push_back(bytes.size());
+        bytes.insert(bytes.end(), out, out + n);
+        records.push_back(r);
+    }
+
+    size_t length(size_t i) const
+    {
+        return (i + 1 < starts.size() ? starts[i + 1] : bytes.size()) - starts[i];
+    }
+};
+
+// Decode the whole stream, cutting each record short first
+static void check_decode(const Stream& s, const char *what)
+{
+    DeltaDecoder decoder;
+
+    CHECK(decoder.decode(s.bytes.data(), 0, NULL) == 0, "%s: empty input decoded", what);
+    for (size_t i = 0; i < s.records.size(); i++) {
+        const uint8_t *in = &s.bytes[s.starts[i]];
+        DeltaRecord out;
+
+        for (size_t cut = 0; cut < s.length(i); cut++) {
+            if (decoder.decode(in, cut, &out) != 0) {
+                CHECK(false, "%s: record %zu decoded from %zu of its %zu bytes", what, i, cut, s.length(i));
+                return;
+            }
+        }
+        // Also with the bytes of the next record in reach
+        if (decoder.decode(in, s.bytes.size() - s.starts[i], &out) != s.length(i) || !same(out, s.records[i])) {
+            CHECK(false, "%s: record %zu (time %lu) does not decode back", what, i, (unsigned long)s.records[i].time);
+            return;
+        }
+    }
+}
+
+// Coded size at the boundaries of the size codes: zigzag 0, <0x100, <0x10000, else 4 bytes
+static void test_sizes(void)
+{
+    static const struct {
+        int32_t diff;
+        size_t bytes;
+    } sizes[] = {
+        { 0, 0 }, { -1, 1 }, { 1, 1 }, { -128, 1 }, { 127, 1 }, { 128, 2 }, { -129, 2 },
+        { -32768, 2 }, { 32767, 2 }, { 32768, 4 }, { -32769, 4 },
+        { INT32_MAX, 4 }, { INT32_MIN, 4 },
+    };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        DeltaEncoder encoder;
+        uint8_t out[DELTA_MAX_RECORD];
+        size_t n;
+
+        // From the all-zero start: the value difference is the value itself
+        n = encoder.encode(record(0, sizes[i].diff, 0, 0), out);
+        CHECK(n == 1 + sizes[i].bytes, "difference %ld coded in %zu bytes, expected %zu", (long)sizes[i].diff, n,
+              1 + sizes[i].bytes);
+        // and the same size the other way, from that value back by the same amount
+        n = encoder.encode(record(0, (int32_t)((uint32_t)sizes[i].diff * 2), 0, 0), out);
+        CHECK(n == 1 + sizes[i].bytes, "second difference %ld coded in %zu bytes, expected %zu",
+              (long)sizes[i].diff, n, 1 + sizes[i].bytes);
+    }
+}
+
+// The widest differences there are, in value and in time
+static void test_extremes(void)
+{
+    static const int32_t values[] = { 0, INT32_MIN, INT32_MAX, -1, 1, INT32_MIN + 1, INT32_MAX - 1 };
+    static const uint32_t periods[] = { 1000, 0, 0x80000000U, 0xFFFFFFFFU, 1, 0x7FFFFFFFU };
+    const int nv = sizeof(values) / sizeof(values[0]);
+    const int np = sizeof(periods) / sizeof(periods[0]);
+    DeltaEncoder encoder;
+    Stream s;
+    uint32_t time = 0xFFFFF000U;        // wraps within the first few records
+    uint8_t out[DELTA_MAX_RECORD];
+
+    // Every value after every other on each channel, every period after every other
+    for (int a = 0; a < nv; a++) {
+        for (int b = 0; b < nv; b++) {
+            for (int p = 0; p < np; p++) {
+                time += periods[(a * nv + b + p) % np];
+                s.add(encoder, record(time, values[a], values[b], values[(a + b) % nv]));
+                time += periods[p];
+                s.add(encoder, record(time, values[b], values[a], values[(a + p) % nv]));
+            }
+        }
+    }
+    check_decode(s, "extremes");
+
+    // INT32_MIN to INT32_MAX is -1 around the wrap, a single byte
+    encoder.reset();
+    encoder.encode(record(0, INT32_MIN, INT32_MAX, 0), out);
+    CHECK(encoder.encode(record(0, INT32_MAX, INT32_MIN, 0), out) == 3, "INT32_MIN to INT32_MAX not coded as -1 and 1");
+    CHECK(out[0] == ((1 << 2) | (1 << 4)) && out[1] == 1 && out[2] == 2, "INT32_MIN/MAX step coded as %02x %02x %02x",
+          out[0], out[1], out[2]);
+}
+
+// Random walks, steady periods and the odd jump to an extreme
+static void test_random(void)
+{
+    DeltaEncoder encoder;
+    Stream s;
+    DeltaRecord r = record(0, 0, 0, 0);
+    uint32_t period = 1000;
+
+    srand(7);
+    for (int n = 0; n < 200000; n++) {
+        if (rand() % 100 == 0) {
+            period = (uint32_t)rand() * 2654435761U;
+        }
+        r.time += period + (rand() % 8 == 0 ? rand() % 5 - 2 : 0);
+        for (int i = 0; i < DELTA_CHANNELS; i++) {
+            switch (rand() % 50) {
+            case 0:
+                r.value[i] = INT32_MIN;
+                break;
+            case 1:
+                r.value[i] = INT32_MAX;
+                break;
+            case 2:
+                r.value[i] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+                break;
+            default:
+                r.value[i] = (int32_t)((uint32_t)r.value[i] + (uint32_t)(rand() % 201 - 100));
+                break;
+            }
+        }
+        s.add(encoder, r);
+    }
+    check_decode(s, "random");
+}
+
+// reset() at block boundaries, as SampleLog codes its blocks
+static void test_blocks(void)
+{
+    const int blocks = 8, per_block = 50;
+    DeltaEncoder encoder;
+    DeltaDecoder decoder;
+    Stream s;
+    std::vector<size_t> block_start;
+    DeltaRecord r = record(0xFFFF0000U, -5000, 100000, INT32_MAX - 200);
+
+    for (int b = 0; b < blocks; b++) {
+        encoder.reset();
+        block_start.push_back(s.records.size());
+        for (int i = 0; i < per_block; i++) {
+            r.time += 1000 + (i % 7 == 0 ? 3 : 0);
+            r.value[0] += 13;
+            r.value[1] -= 700;
+            r.value[2] = (int32_t)((uint32_t)r.value[2] + 7);      // across INT32_MAX
+            s.add(encoder, r);
+        }
+    }
+
+    // A block coded after reset() is what a new encoder makes of it
+    for (int b = 0; b < blocks; b++) {
+        DeltaEncoder fresh;
+        uint8_t out[DELTA_MAX_RECORD];
+        size_t at = s.starts[block_start[b]];
+
+        for (int i = 0; i < per_block; i++) {
+            size_t k = block_start[b] + i;
+            size_t n = fresh.encode(s.records[k], out);
+
+            if (n != s.length(k) || memcmp(out, &s.bytes[at], n) != 0) {
+                CHECK(false, "block %d record %d differs from a fresh encoder", b, i);
+                break;
+            }
+            at += n;
+        }
+    }
+
+    // Blocks decode alone, in any order, with the decoder reset in between;
+    // reverse order leaves the decoder well off each time
+    for (int b = blocks - 1; b >= 0; b--) {
+        decoder.reset();
+        for (int i = 0; i < per_block; i++) {
+            size_t k = block_start[b] + i;
+            DeltaRecord out;
+
+            if (decoder.decode(&s.bytes[s.starts[k]], s.length(k), &out) != s.length(k) || !same(out, s.records[k])) {
+                CHECK(false, "block %d record %d does not decode alone", b, i);
+                break;
+            }
+        }
+    }
+
+    // Without the reset the next block is read against the wrong base
+    DeltaRecord out;
+    decoder.reset();
+    for (int i = 0; i < per_block; i++) {
+        decoder.decode(&s.bytes[s.starts[i]], s.length(i), &out);
+    }
+    decoder.decode(&s.bytes[s.starts[per_block]], s.length(per_block), &out);
+    CHECK(!same(out, s.records[per_block]), "second block decoded without a reset, blocks are not independent");
+}
+
+int main(void)
+{
+    test_sizes();
+    test_extremes();
+    test_random();
+    test_blocks();
+    return check_report();
+}
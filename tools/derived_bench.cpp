@@ -0,0 +1,173 @@
+/*
+ * Host check and benchmark of the fixed-point derived quantities, derived/Derived.h
+ *
+ *   g++ -O2 -Itools/host -Iderived tools/derived_bench.cpp derived/Derived.cpp -o derived_bench
+ *   ./derived_bench
+ *
+ * Sweeps dew point, altitude and QNH over the input ranges documented in
+ * Derived.h and compares every result with a double precision evaluation
+ * of the same formulas. The worst error of each must stay within the
+ * bound documented there, else the exit status is 1. Then times the
+ * fixed-point path against the naive float one through logf/powf, which
+ * is what the device would run without Derived.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Derived.h"
+
+// Documented in Derived.h
+#define DEW_POINT_BOUND     0.02        // degC
+#define ALTITUDE_BOUND      0.25        // m
+#define QNH_BOUND           0.05        // hPa
+
+#define MAGNUS_B            17.62
+#define MAGNUS_C            243.12
+#define ISA_HEIGHT          44330.77
+#define ISA_EXPONENT        0.190263
+#define SEA_LEVEL           1013.25
+
+#define REPEAT              20
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double dew_point_ref(double t, double rh)
+{
+    double gamma = log(rh / 100) + MAGNUS_B * t / (MAGNUS_C + t);
+    return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+static double altitude_ref(double p, double p0)
+{
+    return ISA_HEIGHT * (1 - pow(p / p0, ISA_EXPONENT));
+}
+
+static double qnh_ref(double p, double h)
+{
+    return p * pow(1 - h / ISA_HEIGHT, -1 / ISA_EXPONENT);
+}
+
+static bool report(const char *name, double worst, double bound, const char *unit, const char *where)
+{
+    bool ok = worst <= bound;
+
+    printf("%-10s max error %.4f %s (bound %.2f) at %s%s\n", name, worst, unit, bound, where,
+           ok ? "" : "  ** OVER BOUND **");
+    return ok;
+}
+
+static bool check_dew_point(void)
+{
+    double worst = 0;
+    char where[64] = "";
+
+    // Every 0.05 degC by every 0.1 %RH step the sensor reports
+    for (int t = -4000; t <= 12000; t += 5) {
+        for (int rh = 1; rh <= 1000; rh++) {
+            double e = fabs(Derived::dew_point((int16_t)t, (uint16_t)rh) / 100.0 - dew_point_ref(t / 100.0, rh / 10.0));
+            if (e > worst) {
+                worst = e;
+                snprintf(where, sizeof(where), "%.2f degC %.1f %%RH", t / 100.0, rh / 10.0);
+            }
+        }
+    }
+    return report("dew point", worst, DEW_POINT_BOUND, "degC", where);
+}
+
+static bool check_altitude(void)
+{
+    double worst = 0;
+    char where[64] = "";
+
+    // Every raw LPS25H step
+    for (uint32_t p = 300 * 4096; p <= 1100 * 4096; p++) {
+        double e = fabs(Derived::altitude(p, DERIVED_SEA_LEVEL_RAW) / 10.0 - altitude_ref(p / 4096.0, SEA_LEVEL));
+        if (e > worst) {
+            worst = e;
+            snprintf(where, sizeof(where), "%.4f hPa", p / 4096.0);
+        }
+    }
+    return report("altitude", worst, ALTITUDE_BOUND, "m", where);
+}
+
+static bool check_qnh(void)
+{
+    double worst = 0;
+    char where[64] = "";
+
+    // Every 1/4 hPa by every metre
+    for (uint32_t p = 300 * 4096; p <= 1100 * 4096; p += 1024) {
+        for (int32_t h = -5000; h <= 50000; h += 10) {
+            double e = fabs(Derived::qnh(p, h) / 4096.0 - qnh_ref(p / 4096.0, h / 10.0));
+            if (e > worst) {
+                worst = e;
+                snprintf(where, sizeof(where), "%.2f hPa %ld m", p / 4096.0, (long)(h / 10));
+            }
+        }
+    }
+    return report("QNH", worst, QNH_BOUND, "hPa", where);
+}
+
+// The float path the device would otherwise take for the same three values
+static float dew_point_float(float t, float rh)
+{
+    float gamma = logf(rh / 100) + 17.62f * t / (243.12f + t);
+    return 243.12f * gamma / (17.62f - gamma);
+}
+
+static void timing(void)
+{
+    const int n = 100000;
+    volatile int64_t fixed_sink = 0;
+    volatile float float_sink = 0;
+    double start, fixed_s, float_s;
+    int pass, i;
+
+    start = seconds();
+    for (pass = 0; pass < REPEAT; pass++) {
+        for (i = 0; i < n; i++) {
+            int16_t t = (int16_t)(i % 8000 - 2000);
+            uint16_t rh = (uint16_t)(i % 999 + 1);
+            uint32_t p = 900 * 4096 + (uint32_t)i;
+            fixed_sink += Derived::dew_point(t, rh);
+            fixed_sink += Derived::altitude(p, DERIVED_SEA_LEVEL_RAW);
+            fixed_sink += Derived::qnh(p, (int32_t)(i % 5000));
+        }
+    }
+    fixed_s = (seconds() - start) / REPEAT / n;
+
+    start = seconds();
+    for (pass = 0; pass < REPEAT; pass++) {
+        for (i = 0; i < n; i++) {
+            float t = (i % 8000 - 2000) / 100.0f;
+            float rh = (i % 999 + 1) / 10.0f;
+            float p = (900 * 4096 + i) / 4096.0f;
+            float_sink += dew_point_float(t, rh);
+            float_sink += 44330.77f * (1 - powf(p / 1013.25f, 0.190263f));
+            float_sink += p * powf(1 - (i % 5000) / 443307.7f, -5.255877f);
+        }
+    }
+    float_s = (seconds() - start) / REPEAT / n;
+
+    printf("all three  fixed %.1f ns, libm float %.1f ns per sample (%.2fx)\n",
+           fixed_s * 1e9, float_s * 1e9, float_s / fixed_s);
+    // A desktop FPU runs libm in a few ns, the ratio on the M4F is the one that counts
+    printf("           host times only, time the device with DWT->CYCCNT for M4F figures\n");
+}
+
+int main(void)
+{
+    bool ok = true;
+
+    ok &= check_dew_point();
+    ok &= check_altitude();
+    ok &= check_qnh();
+    timing();
+    return ok ? 0 : 1;
+}
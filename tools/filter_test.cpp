@@ -0,0 +1,273 @@
+/*
+ * Host unit tests and benchmark of the fixed-point filter stages, filter/Filter.h
+ *
+ *   g++ -O2 -Ifilter tools/filter_test.cpp -o filter_test
+ *   ./filter_test
+ *
+ * Every stage is checked against a straightforward 64-bit reference on
+ * random, step and spike inputs, including the warm-up before the window
+ * is full and, for the CIC, runs long enough for its integrators to wrap.
+ * The exit status is 1 if any check fails. Then each stage and the
+ * pipelines of filter/SampleFilter.h are timed, in ns and, on x86, in TSC
+ * cycles per sample.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include "Filter.h"
+#include "host/check.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC    1
+#endif
+
+#define BENCH_SAMPLES   1000000
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Random samples in [lo, hi]
+static std::vector<int32_t> noise(size_t n, int32_t lo, int32_t hi, unsigned seed)
+{
+    std::vector<int32_t> v(n);
+
+    srand(seed);
+    for (size_t i = 0; i < n; i++) {
+        v[i] = lo + (int32_t)((((uint32_t)rand() << 16) ^ (uint32_t)rand()) % (uint32_t)(hi - lo + 1));
+    }
+    return v;
+}
+
+static void test_pass(void)
+{
+    Pass<int32_t> f;
+    int32_t out = 0;
+
+    CHECK(f.put(-12345, out) && out == -12345, "Pass changed the sample to %ld", (long)out);
+}
+
+template <int N>
+static void test_boxcar(void)
+{
+    std::vector<int32_t> in = noise(5000, -100000, 100000, N);
+    Boxcar<int32_t, N> f;
+
+    for (size_t i = 0; i < in.size(); i++) {
+        size_t first = i + 1 >= (size_t)N ? i + 1 - N : 0;
+        int64_t sum = 0;
+        int32_t out;
+
+        for (size_t j = first; j <= i; j++) {
+            sum += in[j];
+        }
+        CHECK(f.put(in[i], out), "Boxcar<%d> held back a sample", N);
+        CHECK(out == (int32_t)(sum / (int64_t)(i + 1 - first)),
+              "Boxcar<%d> sample %zu: %ld, expected %ld", N, i, (long)out, (long)(sum / (int64_t)(i + 1 - first)));
+    }
+}
+
+template <int SHIFT>
+static void test_ema(void)
+{
+    Ema<int32_t, SHIFT> f;
+    int32_t out = 0, last;
+    int i;
+
+    // The first sample is taken as it is, a constant stays constant
+    f.put(-5000, out);
+    CHECK(out == -5000, "Ema<%d> first sample gave %ld", SHIFT, (long)out);
+    for (i = 0; i < 100; i++) {
+        f.put(-5000, out);
+        CHECK(out == -5000, "Ema<%d> drifted on a constant to %ld", SHIFT, (long)out);
+    }
+
+    // A step is approached monotonically and reached exactly
+    last = out;
+    for (i = 0; i < 64 << SHIFT && out != 7000; i++) {
+        f.put(7000, out);
+        CHECK(out >= last && out <= 7000, "Ema<%d> step not monotonic: %ld after %ld", SHIFT, (long)out, (long)last);
+        last = out;
+    }
+    CHECK(out == 7000, "Ema<%d> stuck at %ld below a step to 7000", SHIFT, (long)out);
+
+    // No dead band: a one count step is followed too, both ways
+    for (i = 0; i < 64 << SHIFT && out != 7001; i++) {
+        f.put(7001, out);
+    }
+    CHECK(out == 7001, "Ema<%d> ignores a +1 step, stuck at %ld", SHIFT, (long)out);
+    for (i = 0; i < 64 << SHIFT && out != 7000; i++) {
+        f.put(7000, out);
+    }
+    CHECK(out == 7000, "Ema<%d> ignores a -1 step, stuck at %ld", SHIFT, (long)out);
+
+    // reset() forgets the state
+    f.reset();
+    f.put(42, out);
+    CHECK(out == 42, "Ema<%d> after reset gave %ld", SHIFT, (long)out);
+}
+
+template <int N>
+static void test_median(void)
+{
+    std::vector<int32_t> in = noise(5000, -1000, 1000, 100 + N);
+    Median<int32_t, N> f;
+
+    for (size_t i = 0; i < in.size(); i++) {
+        size_t first = i + 1 >= (size_t)N ? i + 1 - N : 0;
+        std::vector<int32_t> window(in.begin() + first, in.begin() + i + 1);
+        int32_t out;
+
+        std::sort(window.begin(), window.end());
+        CHECK(f.put(in[i], out), "Median<%d> held back a sample", N);
+        CHECK(out == window[window.size() / 2], "Median<%d> sample %zu: %ld, expected %ld", N, i,
+              (long)out, (long)window[window.size() / 2]);
+    }
+
+    // A lone spike on a flat line never shows
+    f.reset();
+    for (int i = 0; N > 1 && i < 4 * N; i++) {
+        int32_t out;
+        f.put(i == 2 * N ? 1000000 : 250, out);
+        CHECK(out == 250, "Median<%d> let a spike through at %d: %ld", N, i, (long)out);
+    }
+}
+
+// M moving sums of R in cascade, taken every R samples: what the CIC computes
+template <int R, int M>
+static void test_cic(int32_t lo, int32_t hi, size_t n)
+{
+    std::vector<int32_t> in = noise(n, lo, hi, 1000 + R * 10 + M);
+    std::vector<int64_t> stage(in.begin(), in.end());
+    Cic<int32_t, R, M> f;
+    size_t outputs = 0;
+
+    for (int m = 0; m < M; m++) {
+        std::vector<int64_t> sum(n);
+        int64_t acc = 0;
+        for (size_t i = 0; i < n; i++) {
+            acc += stage[i] - (i >= (size_t)R ? stage[i - R] : 0);
+            sum[i] = acc;
+        }
+        stage.swap(sum);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t out;
+        bool ready = f.put(in[i], out);
+
+        CHECK(ready == ((i + 1) % R == 0), "Cic<%d,%d> output at the wrong phase, sample %zu", R, M, i);
+        if (ready) {
+            int64_t expected = stage[i] / FilterPower<R, M>::value;
+            CHECK(out == expected, "Cic<%d,%d> sample %zu: %ld, expected %lld", R, M, i, (long)out, (long long)expected);
+            outputs++;
+        }
+    }
+    CHECK(outputs == n / R, "Cic<%d,%d> gave %zu outputs for %zu inputs", R, M, outputs, n);
+
+    // Unity gain once the stages are full
+    f.reset();
+    for (int i = 0; i < R * (M + 2); i++) {
+        int32_t out;
+        if (f.put(-31337, out) && i >= R * M) {
+            CHECK(out == -31337, "Cic<%d,%d> gain not unity: %ld", R, M, (long)out);
+        }
+    }
+}
+
+static void test_chain(void)
+{
+    std::vector<int32_t> in = noise(2000, -5000, 5000, 7);
+    Chain<Median<int32_t, 3>, Ema<int32_t, 2> > chain;
+    Median<int32_t, 3> median;
+    Ema<int32_t, 2> ema;
+    Chain<Boxcar<int32_t, 2>, Cic<int32_t, 4, 1> > decimating;
+    int ready = 0;
+
+    for (size_t i = 0; i < in.size(); i++) {
+        int32_t mid, expected, out;
+        median.put(in[i], mid);
+        ema.put(mid, expected);
+        CHECK(chain.put(in[i], out) && out == expected, "Chain sample %zu: %ld, expected %ld", i,
+              (long)out, (long)expected);
+        ready += decimating.put(in[i], out);
+    }
+    CHECK(ready == (int)in.size() / 4, "decimating Chain gave %d outputs for %zu inputs", ready, in.size());
+}
+
+template <typename F>
+static void bench(const char *name, const std::vector<int32_t>& in)
+{
+    F f;
+    volatile int32_t sink = 0;
+    double start, s;
+#if HAVE_TSC
+    unsigned long long tsc;
+#endif
+    size_t i;
+
+    start = seconds();
+#if HAVE_TSC
+    tsc = __rdtsc();
+#endif
+    for (i = 0; i < in.size(); i++) {
+        int32_t out;
+        if (f.put(in[i], out)) {
+            sink = sink + out;
+        }
+    }
+#if HAVE_TSC
+    tsc = __rdtsc() - tsc;
+#endif
+    s = seconds() - start;
+#if HAVE_TSC
+    printf("  %-38s %6.2f ns %7.2f cycles/sample\n", name, s * 1e9 / in.size(), (double)tsc / in.size());
+#else
+    printf("  %-38s %6.2f ns/sample\n", name, s * 1e9 / in.size());
+#endif
+}
+
+int main(void)
+{
+    std::vector<int32_t> in;
+
+    test_pass();
+    test_boxcar<1>();
+    test_boxcar<4>();
+    test_boxcar<7>();
+    test_ema<1>();
+    test_ema<2>();
+    test_ema<5>();
+    test_median<1>();
+    test_median<3>();
+    test_median<5>();
+    test_cic<4, 1>(-100000, 100000, 10000);
+    test_cic<2, 3>(-100000, 100000, 10000);
+    // 24-bit pressure through R^M = 16: the integrators wrap every few thousand samples
+    test_cic<4, 2>(900 * 4096, 1100 * 4096, 200000);
+    test_cic<8, 4>(-2000, 2000, 20000);
+    test_chain();
+
+    if (check_report()) {
+        return 1;
+    }
+
+    in = noise(BENCH_SAMPLES, 900 * 4096, 1100 * 4096, 99);
+    printf("per sample, %d samples (host figures, time the device with DWT->CYCCNT):\n", BENCH_SAMPLES);
+    bench<Pass<int32_t> >("Pass", in);
+    bench<Boxcar<int32_t, 4> >("Boxcar<4>", in);
+    bench<Boxcar<int32_t, 16> >("Boxcar<16>", in);
+    bench<Ema<int32_t, 2> >("Ema<2>", in);
+    bench<Median<int32_t, 3> >("Median<3>", in);
+    bench<Median<int32_t, 7> >("Median<7>", in);
+    bench<Cic<int32_t, 4, 2> >("Cic<4,2>", in);
+    bench<Chain<Median<int32_t, 3>, Ema<int32_t, 2> > >("HTS221 channel: Median<3>, Ema<2>", in);
+    bench<Chain<Median<int32_t, 3>, Boxcar<int32_t, 4> > >("LPS25H pressure: Median<3>, Boxcar<4>", in);
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Host check and benchmark of the fixed-point console formatting, format/Decimal.h
+ *
+ *   g++ -O2 -Iformat tools/format_bench.cpp format/Decimal.cpp -o format_bench
+ *   ./format_bench
+ *
+ * Decimal::format() is compared with an exact integer printf of the same
+ * value for every number of decimals, at the int32 edges and on random
+ * values, and parse() must read each result back unchanged; the exit
+ * status is 1 on a mismatch. Then one sample line of each sensor is formatted as
+ * print_sample() in main.cpp does, integer conversions and Decimal, and
+ * as the float path it replaced, raw / 4096 and %f, to give the cost per
+ * formatted sample in ns and, on x86, TSC cycles.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Decimal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC    1
+#endif
+
+#define SAMPLES     1000000
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// LPS25H::raw_to_pressure_x100() and raw_to_temperature_x100(), which
+// need the mbed headers
+static uint32_t raw_to_pressure_x100(uint32_t raw)
+{
+    return (raw * 25 + 512) / 1024;
+}
+
+static int16_t raw_to_temperature_x100(int16_t raw)
+{
+    int32_t t = (int32_t)raw * 5;
+    t = (t >= 0 ? t + 12 : t - 12) / 24;
+    return (int16_t)(t + 4250);
+}
+
+static long long power_of_ten(int n)
+{
+    long long p = 1;
+    while (n--) {
+        p *= 10;
+    }
+    return p;
+}
+
+static bool check(int32_t value, int decimals, int width)
+{
+    char got[DECIMAL_MAX_LENGTH], number[64], want[64];
+    long long p = power_of_ten(decimals);
+    long long whole = (value < 0 ? -(long long)value : value) / p;
+    long long fraction = (value < 0 ? -(long long)value : value) % p;
+    int32_t back;
+
+    // Exact reference, no float rounding in the way
+    if (decimals) {
+        snprintf(number, sizeof(number), "%s%lld.%0*lld", value < 0 ? "-" : "", whole, decimals, fraction);
+    } else {
+        snprintf(number, sizeof(number), "%s%lld", value < 0 ? "-" : "", whole);
+    }
+    snprintf(want, sizeof(want), "%*s", width, number);
+    Decimal::format(got, value, decimals, width);
+    if (strcmp(got, want) != 0) {
+        printf("FAIL format(%ld, %d, %d): \"%s\", expected \"%s\"\n", (long)value, decimals, width, got, want);
+        return false;
+    }
+    if (!Decimal::parse(got + strspn(got, " "), decimals, &back) || back != value) {
+        printf("FAIL parse(\"%s\", %d) did not give back %ld\n", got, decimals, (long)value);
+        return false;
+    }
+    return true;
+}
+
+static bool check_all(void)
+{
+    static const int32_t edges[] = { 0, 1, -1, 9, -9, 10, 99, 100, -100, 12345, -12345,
+                                     2147483647, -2147483647 - 1 };
+    int failures = 0;
+    char text[DECIMAL_MAX_LENGTH];
+    uint32_t u;
+
+    for (int d = 0; d <= 9; d++) {
+        for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+            failures += !check(edges[i], d, 0);
+            failures += !check(edges[i], d, 8);
+        }
+    }
+    srand(1);
+    for (int i = 0; i < 200000; i++) {
+        int32_t v = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+        failures += !check(v >> (rand() % 31), rand() % 10, rand() % 12);
+    }
+    Decimal::format_unsigned(text, 4294967295U, 2);
+    if (strcmp(text, "42949672.95") != 0 || !Decimal::parse_unsigned(text, 2, &u) || u != 4294967295U) {
+        printf("FAIL format_unsigned/parse_unsigned of 0xffffffff: \"%s\"\n", text);
+        failures++;
+    }
+    // Rejected input
+    if (Decimal::parse_unsigned("1.234", 2, &u) || Decimal::parse_unsigned("", 2, &u) ||
+        Decimal::parse_unsigned(".", 2, &u) || Decimal::parse_unsigned("1x", 0, &u) ||
+        Decimal::parse_unsigned("4294967296", 0, &u) || Decimal::parse_unsigned("42949673", 2, &u)) {
+        printf("FAIL parse_unsigned accepted bad input\n");
+        failures++;
+    }
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return false;
+    }
+    printf("format and parse checks passed\n");
+    return true;
+}
+
+struct Raw {
+    int16_t hts_temperature;    // 0.01 degC
+    uint16_t hts_humidity;      // 0.1 %RH
+    uint32_t pressure;          // LPS25H raw, 1/4096 hPa
+    int16_t temperature;        // LPS25H raw
+};
+
+// Both sensors' lines of print_sample()
+static int line_fixed(char *out, const Raw& r)
+{
+    char t[DECIMAL_MAX_LENGTH], v[DECIMAL_MAX_LENGTH];
+    int n;
+
+    Decimal::format(t, r.hts_temperature, 2, 4);
+    Decimal::format_unsigned(v, r.hts_humidity, 1, 3);
+    n = sprintf(out, "%7lu.%06lu %sC %s%%\r\n", 123ul, 456789ul, t, v);
+    Decimal::format_unsigned(v, raw_to_pressure_x100(r.pressure), 2, 6);
+    Decimal::format(t, raw_to_temperature_x100(r.temperature), 2, 4);
+    return n + sprintf(out + n, "%7lu.%06lu %s %s\r\n", 123ul, 456789ul, v, t);
+}
+
+static int line_float(char *out, const Raw& r)
+{
+    int n;
+
+    n = sprintf(out, "%7lu.%06lu %4.2fC %3.1f%%\r\n", 123ul, 456789ul, r.hts_temperature / 100.0f,
+                r.hts_humidity / 10.0f);
+    return n + sprintf(out + n, "%7lu.%06lu %6.2f %4.2f\r\n", 123ul, 456789ul, r.pressure / 4096.0f,
+                       r.temperature / 480.0f + 42.5f);
+}
+
+template <int (*LINE)(char *, const Raw&)>
+static double bench(const char *name, const Raw *raw, int n)
+{
+    char out[128];
+    volatile int sink = 0;
+    double start, s;
+#if HAVE_TSC
+    unsigned long long tsc = __rdtsc();
+#endif
+
+    start = seconds();
+    for (int i = 0; i < n; i++) {
+        sink = sink + LINE(out, raw[i]);
+    }
+    s = seconds() - start;
+#if HAVE_TSC
+    tsc = __rdtsc() - tsc;
+    printf("  %-26s %7.1f ns %8.1f cycles per formatted sample\n", name, s * 1e9 / n, (double)tsc / n);
+#else
+    printf("  %-26s %7.1f ns per formatted sample\n", name, s * 1e9 / n);
+#endif
+    return s;
+}
+
+int main(void)
+{
+    Raw *raw = new Raw[SAMPLES];
+    double fixed_s, float_s;
+
+    if (!check_all()) {
+        return 1;
+    }
+
+    srand(2);
+    for (int i = 0; i < SAMPLES; i++) {
+        raw[i].hts_temperature = (int16_t)(rand() % 16000 - 4000);
+        raw[i].hts_humidity = (uint16_t)(rand() % 1001);
+        raw[i].pressure = 260 * 4096 + (uint32_t)rand() % (1000 * 4096);
+        raw[i].temperature = (int16_t)(rand() % 65536 - 32768);
+    }
+    printf("HTS221 and LPS25H lines, %d samples (host figures, time the device with DWT->CYCCNT):\n",
+           SAMPLES);
+    fixed_s = bench<line_fixed>("fixed point and Decimal", raw, SAMPLES);
+    float_s = bench<line_float>("float and %f", raw, SAMPLES);
+    printf("  float path takes %.2fx the time\n", float_s / fixed_s);
+    delete[] raw;
+    return 0;
+}
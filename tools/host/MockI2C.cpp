@@ -0,0 +1,327 @@
+#include <deque>
+#include "mbed.h"
+
+// A non-blocking transfer, queued or in flight
+struct MockTransfer {
+    int address;
+    const char *tx;
+    int tx_length;
+    char *rx;
+    int rx_length;
+    event_callback_t callback;
+    int mask;
+    bool repeated;
+    int event;              // set when it starts
+    uint64_t end;           // clock at its completion interrupt
+};
+
+static MockSlave *slaves[128];
+static MockFault fault_kind = MOCK_OK;
+static int fault_count;
+static uint64_t clock_us;
+static std::deque<MockTransfer> transfers;     // front is in flight
+
+uint32_t MockI2C::transactions;
+uint32_t MockI2C::interrupts;
+uint64_t MockI2C::blocked_us;
+int MockI2C::hz = 100000;
+
+MockRegisterSlave::MockRegisterSlave(bool msb_increment)
+    : _pointer(0), _increment(!msb_increment), _msb_increment(msb_increment), _select(false)
+{
+    memset(regs, 0, sizeof(regs));
+}
+
+bool MockRegisterSlave::start(bool read)
+{
+    _select = !read;
+    return true;
+}
+
+bool MockRegisterSlave::write(uint8_t data)
+{
+    if (_select) {
+        _select = false;
+        _pointer = _msb_increment ? data & 0x7f : data;
+        _increment = !_msb_increment || (data & 0x80);
+        return true;
+    }
+    reg_write(_pointer, data);
+    if (_increment) {
+        _pointer++;
+    }
+    return true;
+}
+
+uint8_t MockRegisterSlave::read(void)
+{
+    uint8_t value = reg_read(_pointer);
+
+    if (_increment) {
+        _pointer++;
+    }
+    return value;
+}
+
+uint8_t MockRegisterSlave::reg_read(uint8_t reg)
+{
+    return regs[reg];
+}
+
+void MockRegisterSlave::reg_write(uint8_t reg, uint8_t value)
+{
+    regs[reg] = value;
+}
+
+static MockFault take_fault(void)
+{
+    MockFault f = MOCK_OK;
+
+    if (fault_count > 0) {
+        f = fault_kind;
+        fault_count--;
+    }
+    return f;
+}
+
+// Time on the wire of 'bytes' bytes, address bytes included, with START and STOP
+static uint64_t wire_us(int bytes)
+{
+    return ((uint64_t)bytes * 9 + 2) * 1000000 / MockI2C::hz + 1;
+}
+
+// One START to STOP or repeated START. Moves the data, returns the I2C
+// event it ends with and the time it held the bus.
+static int transaction(int address, bool read, char *data, int length, bool repeated, uint64_t *us)
+{
+    MockSlave *slave = slaves[(address >> 1) & 0x7f];
+    MockFault fault = take_fault();
+    int i;
+
+    MockI2C::transactions++;
+    if (fault == MOCK_TIMEOUT || fault == MOCK_LOST) {
+        *us = wire_us(I2C_MOCK_TIMEOUT_BYTES);
+        return I2C_EVENT_ERROR;
+    }
+    if (slave == NULL || fault == MOCK_NACK_ADDRESS || !slave->start(read)) {
+        *us = wire_us(1);
+        return I2C_EVENT_ERROR_NO_SLAVE;
+    }
+    for (i = 0; i < length; i++) {
+        if (read) {
+            data[i] = (char)slave->read();
+        } else if ((i == 0 && fault == MOCK_NACK_DATA) || !slave->write((uint8_t)data[i])) {
+            *us = wire_us(2 + i);
+            slave->stop();
+            return I2C_EVENT_TRANSFER_EARLY_NACK;
+        }
+    }
+    if (!repeated) {
+        slave->stop();
+    }
+    *us = wire_us(1 + length);
+    return I2C_EVENT_TRANSFER_COMPLETE;
+}
+
+// Run a queued transfer: the write, then the read after a repeated start
+static void start_front(void)
+{
+    MockTransfer& t = transfers.front();
+    uint64_t us = 0, read_us = 0;
+
+    if (fault_kind == MOCK_LOST && fault_count > 0) {
+        fault_count--;
+        MockI2C::transactions++;
+        t.event = 0;
+        t.end = UINT64_MAX;
+        return;
+    }
+    t.event = I2C_EVENT_TRANSFER_COMPLETE;
+    if (t.tx_length > 0) {
+        t.event = transaction(t.address, false, (char *)t.tx, t.tx_length, t.rx_length > 0 || t.repeated, &us);
+    }
+    if (t.event == I2C_EVENT_TRANSFER_COMPLETE && t.rx_length > 0) {
+        t.event = transaction(t.address, true, t.rx, t.rx_length, t.repeated, &read_us);
+        us += read_us;
+    }
+    t.end = clock_us + us;
+}
+
+void MockI2C::attach(uint8_t address, MockSlave *slave)
+{
+    slaves[(address >> 1) & 0x7f] = slave;
+}
+
+void MockI2C::fault(MockFault kind, int count)
+{
+    fault_kind = kind;
+    fault_count = count;
+}
+
+uint64_t MockI2C::now(void)
+{
+    return clock_us;
+}
+
+void MockI2C::advance(uint64_t us)
+{
+    uint64_t target = clock_us + us;
+
+    while (!transfers.empty() && transfers.front().end <= target) {
+        MockTransfer t = transfers.front();
+
+        clock_us = t.end;
+        transfers.pop_front();
+        // The next transfer starts from the completion interrupt, as in the HAL
+        if (!transfers.empty()) {
+            start_front();
+        }
+        interrupts++;
+        if (t.callback && (t.event & t.mask)) {
+            t.callback.call(t.event & t.mask);
+        }
+    }
+    clock_us = target;
+}
+
+void MockI2C::run(void)
+{
+    while (!transfers.empty() && transfers.front().end != UINT64_MAX) {
+        advance(transfers.front().end - clock_us);
+    }
+}
+
+bool MockI2C::idle(void)
+{
+    return transfers.empty();
+}
+
+void MockI2C::reset(void)
+{
+    memset(slaves, 0, sizeof(slaves));
+    fault_kind = MOCK_OK;
+    fault_count = 0;
+    transfers.clear();
+    transactions = 0;
+    interrupts = 0;
+    blocked_us = 0;
+    hz = 100000;
+}
+
+uint32_t us_ticker_read(void)
+{
+    return (uint32_t)clock_us;
+}
+
+void wait_us(int us)
+{
+    MockI2C::advance((uint64_t)us);
+}
+
+void wait_ms(int ms)
+{
+    MockI2C::advance((uint64_t)ms * 1000);
+}
+
+void i2c_reset(i2c_t *obj)
+{
+    (void)obj;
+}
+
+I2C::I2C(PinName sda, PinName scl) : _hz(100000)
+{
+    (void)sda;
+    (void)scl;
+    _i2c.index = 0;
+}
+
+void I2C::frequency(int hz)
+{
+    _hz = hz;
+    MockI2C::hz = hz;
+}
+
+// Blocking transfers wait for the non-blocking ones first, the CPU spinning
+static int blocking(int address, bool read, char *data, int length, bool repeated)
+{
+    uint64_t start = clock_us, us;
+    int event;
+
+    MockI2C::run();
+    event = transaction(address, read, data, length, repeated, &us);
+    MockI2C::advance(us);
+    MockI2C::blocked_us += clock_us - start;
+    return event == I2C_EVENT_TRANSFER_COMPLETE ? 0 : -1;
+}
+
+int I2C::read(int address, char *data, int length, bool repeated)
+{
+    return blocking(address, true, data, length, repeated);
+}
+
+int I2C::write(int address, const char *data, int length, bool repeated)
+{
+    return blocking(address, false, (char *)data, length, repeated);
+}
+
+void I2C::start(void)
+{
+}
+
+void I2C::stop(void)
+{
+}
+
+void I2C::lock(void)
+{
+}
+
+void I2C::unlock(void)
+{
+}
+
+int I2C::transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length,
+                  const event_callback_t& callback, int event, bool repeated)
+{
+    MockTransfer t;
+
+    if (transfers.size() > I2C_MOCK_QUEUE) {
+        return -1;
+    }
+    t.address = address;
+    t.tx = tx_buffer;
+    t.tx_length = tx_length;
+    t.rx = rx_buffer;
+    t.rx_length = rx_length;
+    t.callback = callback;
+    t.mask = event;
+    t.repeated = repeated;
+    t.event = 0;
+    t.end = 0;
+    transfers.push_back(t);
+    if (transfers.size() == 1) {
+        start_front();
+    }
+    return 0;
+}
+
+void I2C::abort_transfer(void)
+{
+    if (!transfers.empty()) {
+        transfers.pop_front();
+        if (!transfers.empty()) {
+            start_front();
+        }
+    }
+}
+
+void I2C::abort_all_transfers(void)
+{
+    transfers.clear();
+}
+
+int I2C::set_dma_usage(DMAUsage usage)
+{
+    (void)usage;
+    return 0;
+}
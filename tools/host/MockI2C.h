@@ -0,0 +1,200 @@
+/*
+ * Simulated I2C bus for the host tools
+ *
+ * Stands in for drivers/I2C.h, so i2cbus/I2CBus.cpp and the sensor
+ * drivers build and run unchanged on the host against slave models
+ * attached by address. Blocking transfers move the simulated clock by
+ * their time on the wire, (9 bits a byte + START/STOP) at the bus clock,
+ * and count it as CPU time spent waiting. A non-blocking transfer()
+ * returns at once; it is queued behind the one in flight, as the STM32
+ * HAL does, and its completion "interrupt" is taken when the clock
+ * passes its end, from advance(), wait_us() or Thread::wait().
+ *
+ * MockI2C::fault() makes the next transactions fail the way a real bus
+ * does: address NACK (no device), data NACK (device busy) or a timeout,
+ * which holds the bus for I2C_MOCK_TIMEOUT_BYTES byte times before the
+ * HAL gives up. MOCK_LOST is a non-blocking transfer that never ends, a
+ * start refused without an interrupt; only an abort removes it.
+ */
+#ifndef HOST_MOCKI2C_H
+#define HOST_MOCKI2C_H
+
+#include <stdint.h>
+
+// hal/i2c_api.h
+#define I2C_EVENT_ERROR               (1 << 1)
+#define I2C_EVENT_ERROR_NO_SLAVE      (1 << 2)
+#define I2C_EVENT_TRANSFER_COMPLETE   (1 << 3)
+#define I2C_EVENT_TRANSFER_EARLY_NACK (1 << 4)
+#define I2C_EVENT_ALL                 (I2C_EVENT_ERROR |  I2C_EVENT_TRANSFER_COMPLETE | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)
+
+#define I2C_MOCK_QUEUE              4       // TRANSACTION_QUEUE_SIZE_I2C
+#define I2C_MOCK_TIMEOUT_BYTES      30      // the HAL gives up on a silent bus after about this long
+
+// The HAL object, nothing in it on the host
+typedef struct {
+    int index;
+} i2c_t;
+
+void i2c_reset(i2c_t *obj);
+
+/** A device on the simulated bus, byte level */
+class MockSlave
+{
+public:
+    virtual ~MockSlave()
+    {
+    }
+
+    /** START with the slave's address
+      * @param read direction
+      * @return false to NACK the address
+      */
+    virtual bool start(bool read)
+    {
+        (void)read;
+        return true;
+    }
+
+    /** Byte written by the master
+      * @param data
+      * @return false to NACK it
+      */
+    virtual bool write(uint8_t data) = 0;
+
+    /** Byte read by the master
+      * @param none
+      * @return data
+      */
+    virtual uint8_t read(void) = 0;
+
+    /** STOP, not sent between the halves of a repeated start transfer
+      * @param none
+      * @return none
+      */
+    virtual void stop(void)
+    {
+    }
+};
+
+/** Register file of an ST MEMS sensor
+  *  The first byte written after a START selects the register, the next
+  *  ones write it and those after; reads come from the selected register
+  *  on. With msb_increment the address only advances when bit 7 of the
+  *  register byte is set (HTS221, LPS25H), otherwise always (LSM6DS0 with
+  *  IF_INC). Derived models override reg_read()/reg_write() for registers
+  *  with side effects.
+  */
+class MockRegisterSlave : public MockSlave
+{
+public:
+    MockRegisterSlave(bool msb_increment);
+
+    virtual bool start(bool read);
+    virtual bool write(uint8_t data);
+    virtual uint8_t read(void);
+
+    virtual uint8_t reg_read(uint8_t reg);
+    virtual void reg_write(uint8_t reg, uint8_t value);
+
+    uint8_t regs[256];
+
+protected:
+    uint8_t _pointer;
+    bool _increment;
+    bool _msb_increment;
+    bool _select;           // the next byte written is the register address
+};
+
+enum MockFault {
+    MOCK_OK,
+    MOCK_NACK_ADDRESS,      // nothing answers the address
+    MOCK_NACK_DATA,         // the first data byte is refused
+    MOCK_TIMEOUT,           // the bus hangs until the HAL times out
+    MOCK_LOST               // no completion interrupt, blocking transfers time out
+};
+
+/** Control and state of the simulated bus */
+class MockI2C
+{
+public:
+    /** Put a slave on the bus
+      * @param address 8-bit
+      * @param slave, NULL to remove it
+      * @return none
+      */
+    static void attach(uint8_t address, MockSlave *slave);
+
+    /** Make the next transactions fail, a transaction being one START
+      * @param fault
+      * @param count of transactions
+      * @return none
+      */
+    static void fault(MockFault fault, int count = 1);
+
+    /** Simulated time
+      * @param none
+      * @return us since the start
+      */
+    static uint64_t now(void);
+
+    /** Move the clock, taking the completion interrupts that fall due
+      * @param us
+      * @return none
+      */
+    static void advance(uint64_t us);
+
+    /** Move the clock until no transfer is in flight or queued, or one is lost
+      * @param none
+      * @return none
+      */
+    static void run(void);
+
+    /** No transfer in flight or queued
+      * @param none
+      * @return true when idle
+      */
+    static bool idle(void);
+
+    /** Forget slaves, faults, transfers and counters; the clock runs on
+      * @param none
+      * @return none
+      */
+    static void reset(void);
+
+    static uint32_t transactions;   // STARTs
+    static uint32_t interrupts;     // non-blocking completions taken
+    static uint64_t blocked_us;     // clock time spent inside blocking calls
+    static int hz;                  // bus clock
+};
+
+/** drivers/I2C.h over the simulated bus */
+class I2C
+{
+public:
+    I2C(PinName sda, PinName scl);
+    virtual ~I2C()
+    {
+    }
+
+    void frequency(int hz);
+    int read(int address, char *data, int length, bool repeated = false);
+    int write(int address, const char *data, int length, bool repeated = false);
+    void start(void);
+    void stop(void);
+    virtual void lock(void);
+    virtual void unlock(void);
+
+    int transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length,
+                 const event_callback_t& callback, int event = I2C_EVENT_TRANSFER_COMPLETE,
+                 bool repeated = false);
+    void abort_transfer(void);
+    void abort_all_transfers(void);
+    int set_dma_usage(DMAUsage usage);
+
+protected:
+    i2c_t _i2c;
+    int _hz;
+};
+
+#endif // HOST_MOCKI2C_H
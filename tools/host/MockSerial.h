@@ -0,0 +1,257 @@
+/*
+ * Simulated UART for the host tools
+ *
+ * Stands in for drivers/SerialBase.h, drivers/Stream.h and the parts of
+ * hal/serial_api.h that bufferedserial/BufferedSerial.cpp uses, so it
+ * builds and runs unchanged on the host. Nothing moves on its own: the
+ * tool looks at the asynchronous transmit in flight with tx_data() and
+ * tx_length() and ends it with tx_complete(), and puts received bytes in
+ * the UART with rx(). Both take the interrupt the way the device does,
+ * calling the driver's handler with __get_IPSR() non-zero; MockIsr runs
+ * any other code as if from an interrupt.
+ */
+#ifndef HOST_MOCKSERIAL_H
+#define HOST_MOCKSERIAL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define USBTX                       ((PinName)0x02)
+#define USBRX                       ((PinName)0x03)
+
+#define MBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE     9600
+
+// hal/serial_api.h
+#define SERIAL_EVENT_TX_SHIFT       (2)
+#define SERIAL_EVENT_TX_COMPLETE    (1 << (SERIAL_EVENT_TX_SHIFT + 0))
+
+// The active exception, 0 in thread mode
+inline volatile uint32_t& mock_ipsr(void)
+{
+    static volatile uint32_t ipsr;
+    return ipsr;
+}
+
+inline uint32_t __get_IPSR(void)
+{
+    return mock_ipsr();
+}
+
+/** Scope run as the USART2 interrupt, IRQ 38 */
+class MockIsr
+{
+public:
+    MockIsr() : _was(mock_ipsr())
+    {
+        mock_ipsr() = 16 + 38;
+    }
+
+    ~MockIsr()
+    {
+        mock_ipsr() = _was;
+    }
+
+private:
+    uint32_t _was;
+};
+
+/** The HAL object: the bytes in the receive register, oldest first */
+typedef struct {
+    const uint8_t *rx;
+    size_t rx_length;
+} serial_t;
+
+inline int serial_readable(serial_t *obj)
+{
+    return obj->rx_length > 0;
+}
+
+inline int serial_getc(serial_t *obj)
+{
+    obj->rx_length--;
+    return *obj->rx++;
+}
+
+namespace rtos {
+/** rtos/Semaphore.h. Nothing else runs while the tools wait, so wait()
+  *  on a semaphore without tokens returns 0 at once.
+  */
+class Semaphore
+{
+public:
+    Semaphore(int32_t count = 0) : _count(count)
+    {
+    }
+
+    int32_t wait(uint32_t millisec = osWaitForever)
+    {
+        (void)millisec;
+        if (_count == 0) {
+            return 0;
+        }
+        return _count--;
+    }
+
+    osStatus release(void)
+    {
+        _count++;
+        return osOK;
+    }
+
+private:
+    int32_t _count;
+};
+}
+
+class SerialBase
+{
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+
+    void attach(Callback<void()> func, IrqType type = RxIrq)
+    {
+        if (type == RxIrq) {
+            _rx_irq = func;
+        }
+    }
+
+    int set_dma_usage_tx(DMAUsage usage)
+    {
+        (void)usage;
+        return 0;
+    }
+
+    /** Start an asynchronous transmit
+      * @return 0, or -1 while one is in flight or refuse_tx() is set, as
+      *  the HAL refuses a second
+      */
+    int write(const uint8_t *buffer, int length, const event_callback_t& callback,
+              int event = SERIAL_EVENT_TX_COMPLETE)
+    {
+        (void)event;
+        if (_tx_length || _tx_refused) {
+            return -1;
+        }
+        _tx_data = buffer;
+        _tx_length = length;
+        _tx_callback = callback;
+        return 0;
+    }
+
+    /** The transmit in flight
+      * @return its bytes, valid until tx_complete()
+      */
+    const uint8_t *tx_data(void) const
+    {
+        return _tx_data;
+    }
+
+    /** @return bytes in the transmit in flight, 0 if none */
+    int tx_length(void) const
+    {
+        return _tx_length;
+    }
+
+    /** End the transmit in flight, taking its completion interrupt
+      * @return none
+      */
+    void tx_complete(void)
+    {
+        MockIsr isr;
+
+        _tx_length = 0;
+        _tx_callback.call(SERIAL_EVENT_TX_COMPLETE);
+    }
+
+    /** Make write() fail as if another transmit were running
+      * @param refuse
+      * @return none
+      */
+    void refuse_tx(bool refuse)
+    {
+        _tx_refused = refuse;
+    }
+
+    /** Receive bytes, all in one receive interrupt
+      * @param data
+      * @param length
+      * @return none
+      */
+    void rx(const void *data, size_t length)
+    {
+        MockIsr isr;
+
+        _serial.rx = (const uint8_t *)data;
+        _serial.rx_length = length;
+        _rx_irq.call();
+    }
+
+protected:
+    SerialBase(PinName tx, PinName rx, int baud)
+        : _tx_data(NULL), _tx_length(0), _tx_refused(false)
+    {
+        (void)tx;
+        (void)rx;
+        (void)baud;
+        memset(&_serial, 0, sizeof(_serial));
+    }
+
+    serial_t _serial;
+
+private:
+    Callback<void()> _rx_irq;
+    const uint8_t *_tx_data;
+    int _tx_length;
+    bool _tx_refused;
+    event_callback_t _tx_callback;
+};
+
+/** drivers/Stream.h, the FileHandle side only; nothing is registered by name */
+class Stream
+{
+public:
+    Stream(const char *name = NULL)
+    {
+        (void)name;
+    }
+
+    virtual ~Stream()
+    {
+    }
+
+    virtual ssize_t write(const void *buffer, size_t length) = 0;
+    virtual ssize_t read(void *buffer, size_t length) = 0;
+
+    virtual int sync(void)
+    {
+        return 0;
+    }
+
+    int putc(int c)
+    {
+        return _putc(c);
+    }
+
+    int getc(void)
+    {
+        return _getc();
+    }
+
+protected:
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+
+    virtual void lock(void)
+    {
+    }
+
+    virtual void unlock(void)
+    {
+    }
+};
+
+#endif // HOST_MOCKSERIAL_H
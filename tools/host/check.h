@@ -0,0 +1,41 @@
+/*
+ * Check harness of the host tests
+ *
+ * CHECK() prints the file, line and a printf style message of a failed
+ * condition and counts it in 'failures'; the test goes on, so one run
+ * shows every failure. check_report() ends the checks with the count or
+ * "all checks passed" and gives the exit status. The tests in tools/
+ * include it as "host/check.h", which needs no include path of its own.
+ */
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <stdio.h>
+
+static int failures;        // checks failed so far
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/** Print the outcome of the checks
+  * @param none
+  * @return exit status, 1 if a check failed
+  */
+static inline int check_report(void)
+{
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
+
+#endif // HOST_CHECK_H
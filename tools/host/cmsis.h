@@ -0,0 +1,20 @@
+/*
+ * Host stand-in for cmsis.h
+ *
+ * Gives the app modules that only need a core intrinsic or two what they
+ * use from CMSIS, so they build unchanged into the host tools:
+ *
+ *   g++ -O2 -Itools/host -Iderived tools/derived_bench.cpp derived/Derived.cpp
+ */
+#ifndef HOST_CMSIS_H
+#define HOST_CMSIS_H
+
+#include <stdint.h>
+
+// Count leading zeros, 32 for 0 as on the Cortex-M
+static inline uint8_t __CLZ(uint32_t x)
+{
+    return x ? (uint8_t)__builtin_clz(x) : 32;
+}
+
+#endif // HOST_CMSIS_H
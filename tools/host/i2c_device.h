@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for targets/TARGET_STM/TARGET_STM32F4/i2c_device.h
+ *
+ * Only the I2C IP version of the F401, which sets the layout of the
+ * timing cache entries of i2c_timing.h.
+ */
+#ifndef HOST_I2C_DEVICE_H
+#define HOST_I2C_DEVICE_H
+
+#define I2C_IP_VERSION_V1
+
+#endif // HOST_I2C_DEVICE_H
@@ -0,0 +1,283 @@
+/*
+ * Host stand-in for mbed.h
+ *
+ * Just enough of the mbed API for the app modules the host tools build
+ * to compile unchanged. The tools are single threaded, so the locks are
+ * empty. Time is simulated: us_ticker_read() reads a clock that only
+ * moves when the code under test waits or spends time on the simulated
+ * I2C bus, and the interrupts of that bus are taken while it moves, see
+ * MockI2C.h. The EventQueue runs its periodic events on that clock when
+ * the tool dispatches it. The UART is driven by the tool, see MockSerial.h.
+ */
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "platform/PlatformMutex.h"
+
+#ifndef DEVICE_I2C_ASYNCH
+#define DEVICE_I2C_ASYNCH       1
+#endif
+
+#define MBED_ASSERT(expr)       ((void)0)
+
+typedef int PinName;
+#define NC                      ((PinName)-1)
+#define I2C_SDA                 ((PinName)0x19)
+#define I2C_SCL                 ((PinName)0x18)
+
+// hal/dma_api.h
+typedef enum {
+    DMA_USAGE_NEVER,
+    DMA_USAGE_OPPORTUNISTIC,
+    DMA_USAGE_ALWAYS,
+    DMA_USAGE_TEMPORARY_ALLOCATED,
+    DMA_USAGE_ALLOCATED
+} DMAUsage;
+
+/** Callback in the style of platform/Callback.h, over std::function */
+template <typename F>
+class Callback;
+
+template <typename R, typename... A>
+class Callback<R(A...)>
+{
+public:
+    Callback()
+    {
+    }
+
+    Callback(R (*func)(A...)) : _func(func)
+    {
+    }
+
+    template <typename T, typename U>
+    Callback(U *obj, R (T::*method)(A...))
+        : _func([obj, method](A... a) { return (obj->*method)(a...); })
+    {
+    }
+
+    // Lambdas and other function objects
+    template <typename F, typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, Callback>::value>::type>
+    Callback(F func) : _func(func)
+    {
+    }
+
+    R call(A... a) const
+    {
+        return _func(a...);
+    }
+
+    R operator()(A... a) const
+    {
+        return _func(a...);
+    }
+
+    operator bool() const
+    {
+        return (bool)_func;
+    }
+
+private:
+    std::function<R(A...)> _func;
+};
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *obj, R (T::*method)(A...))
+{
+    return Callback<R(A...)>(obj, method);
+}
+
+typedef Callback<void(int)> event_callback_t;
+
+// Simulated time, MockI2C.cpp
+uint32_t us_ticker_read(void);
+void wait_us(int us);
+void wait_ms(int ms);
+
+// cmsis_os.h
+typedef enum {
+    osOK = 0,
+    osEventMessage = 0x10,
+    osEventTimeout = 0x40,
+    osErrorResource = 0x81
+} osStatus;
+
+#define osWaitForever           0xFFFFFFFFU
+
+typedef struct {
+    osStatus status;
+    union {
+        uint32_t v;
+        void *p;
+        int32_t signals;
+    } value;
+} osEvent;
+
+namespace rtos {
+class Thread
+{
+public:
+    static int wait(uint32_t ms)
+    {
+        wait_ms((int)ms);
+        return 0;
+    }
+};
+
+/** rtos/Queue.h. Nothing else runs while the tools wait, so get() on an
+  *  empty queue times out at once whatever the timeout.
+  */
+template <typename T, uint32_t queue_sz>
+class Queue
+{
+public:
+    Queue() : _head(0), _count(0)
+    {
+    }
+
+    osStatus put(T *data, uint32_t millisec = 0)
+    {
+        (void)millisec;
+        if (_count == queue_sz) {
+            return osErrorResource;
+        }
+        _data[(_head + _count++) % queue_sz] = data;
+        return osOK;
+    }
+
+    osEvent get(uint32_t millisec = osWaitForever)
+    {
+        osEvent evt;
+
+        (void)millisec;
+        evt.status = osEventTimeout;
+        evt.value.p = NULL;
+        if (_count > 0) {
+            evt.status = osEventMessage;
+            evt.value.p = _data[_head];
+            _head = (_head + 1) % queue_sz;
+            _count--;
+        }
+        return evt;
+    }
+
+private:
+    T *_data[queue_sz];
+    uint32_t _head;
+    uint32_t _count;
+};
+}
+using namespace rtos;
+
+/** events/EventQueue.h, periodic events only
+  *  dispatch(ms) runs the events that fall due in the next ms of simulated
+  *  time, moving the clock to each, so the I2C interrupts in between are
+  *  taken in order.
+  */
+class EventQueue
+{
+public:
+    EventQueue() : _next_id(1)
+    {
+    }
+
+    template <typename T, typename R>
+    int call_every(int ms, T *obj, R (T::*method)())
+    {
+        Event e;
+
+        e.id = _next_id++;
+        e.period = (uint64_t)ms * 1000;
+        e.due = us_ticker_now() + e.period;
+        e.func = Callback<void()>([obj, method]() { (obj->*method)(); });
+        _events.push_back(e);
+        return e.id;
+    }
+
+    void cancel(int id)
+    {
+        for (size_t i = 0; i < _events.size(); i++) {
+            if (_events[i].id == id) {
+                _events.erase(_events.begin() + i);
+                return;
+            }
+        }
+    }
+
+    void dispatch(int ms)
+    {
+        uint64_t end = us_ticker_now() + (uint64_t)ms * 1000;
+
+        for (;;) {
+            Event *first = NULL;
+
+            for (size_t i = 0; i < _events.size(); i++) {
+                if (_events[i].due <= end && (first == NULL || _events[i].due < first->due)) {
+                    first = &_events[i];
+                }
+            }
+            if (first == NULL) {
+                break;
+            }
+            if (first->due > us_ticker_now()) {
+                wait_us((int)(first->due - us_ticker_now()));
+            }
+            first->due += first->period;
+            Callback<void()> func = first->func;
+            func();
+        }
+        if (end > us_ticker_now()) {
+            wait_us((int)(end - us_ticker_now()));
+        }
+    }
+
+private:
+    struct Event {
+        int id;
+        uint64_t period;
+        uint64_t due;
+        Callback<void()> func;
+    };
+
+    // 64-bit simulated time, the events outlast the 32-bit ticker
+    static uint64_t us_ticker_now(void);
+
+    std::vector<Event> _events;
+    int _next_id;
+};
+
+inline void core_util_critical_section_enter(void)
+{
+}
+
+inline void core_util_critical_section_exit(void)
+{
+}
+
+inline uint32_t core_util_atomic_incr_u32(uint32_t *value, uint32_t delta)
+{
+    return *value += delta;
+}
+
+inline uint32_t core_util_atomic_decr_u32(uint32_t *value, uint32_t delta)
+{
+    return *value -= delta;
+}
+
+#include "MockI2C.h"
+#include "MockSerial.h"
+
+inline uint64_t EventQueue::us_ticker_now(void)
+{
+    return MockI2C::now();
+}
+
+#endif // HOST_MBED_H
@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for platform/PlatformMutex.h, the tools are single threaded
+ */
+#ifndef HOST_PLATFORMMUTEX_H
+#define HOST_PLATFORMMUTEX_H
+
+class PlatformMutex
+{
+public:
+    void lock(void)
+    {
+    }
+
+    void unlock(void)
+    {
+    }
+};
+
+#endif // HOST_PLATFORMMUTEX_H
@@ -0,0 +1,294 @@
+/*
+ * Host tests of the HTS221 non-blocking read, hts221/hts221.h
+ *
+ *   g++ -O2 -Itools/host -Ii2cbus -Ihts221 tools/hts221_test.cpp hts221/hts221.cpp \
+ *       i2cbus/I2CBus.cpp tools/host/MockI2C.cpp -o hts221_test
+ *   ./hts221_test
+ *
+ * The real driver and I2CBus run against a register model of the sensor
+ * on the simulated bus of tools/host/MockI2C.h. get_async() is driven
+ * through completion, address NACK, data NACK and timeout, checking the
+ * event and sample handed to the callback, busy(), the samples kept for
+ * the getters and the health counters, and that a timeout, and only a
+ * timeout, has the bus checked before its next use. A transfer that never
+ * ends is aborted by the next user of the bus after I2CBUS_DRAIN_MS. Latency is the
+ * simulated time from get_async() to the callback, against the time the
+ * transfer needs on the wire; the caller must not be held for any of it,
+ * where the blocking get() is held for all of it. The exit status is 1 if
+ * a check fails.
+ */
+#include <stdio.h>
+#include "mbed.h"
+#include "hts221.h"
+#include "host/check.h"
+
+#define HTS221_OTHER    0xBC    // a second sensor, for the queueing test
+
+/** HTS221 registers: WHO_AM_I, a calibration and the output registers
+  *  Calibration: 20 %RH at H_OUT 0, 80 %RH at 12000; 10 degC at T_OUT 300,
+  *  35 degC at 800, so set() is exact on 0.05 degC and 0.1 %RH steps.
+  */
+class HTS221Model : public MockRegisterSlave
+{
+public:
+    HTS221Model() : MockRegisterSlave(true)
+    {
+        static const uint8_t calibration[16] = {
+            40, 160, 80, 0x18, 0, 0x04, 0, 0,           // H0_rH_x2, H1_rH_x2, T0/T1_degC_x8
+            0, 0, 12000 & 0xff, 12000 >> 8,             // H0_T0_OUT, H1_T0_OUT
+            300 & 0xff, 300 >> 8, 800 & 0xff, 800 >> 8  // T0_OUT, T1_OUT
+        };
+        regs[ADDRESS_WHO_AM_I] = 0xBC;
+        memcpy(&regs[HTS221_CALIB], calibration, sizeof(calibration));
+        set(2150, 455);
+    }
+
+    // New sample in 0.01 degC and 0.1 %RH
+    void set(int16_t temperature, uint16_t humidity)
+    {
+        int16_t h = (int16_t)((humidity - 200) * 20);
+        int16_t t = (int16_t)(300 + (temperature - 1000) / 5);
+
+        regs[HTS221_TempHumi_OUT] = (uint8_t)h;
+        regs[HTS221_TempHumi_OUT + 1] = (uint8_t)(h >> 8);
+        regs[HTS221_TempHumi_OUT + 2] = (uint8_t)t;
+        regs[HTS221_TempHumi_OUT + 3] = (uint8_t)(t >> 8);
+        regs[HTS221_STATUS] = H_DA_On | T_DA_On;
+    }
+};
+
+// What the callback was given
+struct Result {
+    int calls;
+    int event;
+    int16_t temperature;
+    uint16_t humidity;
+    uint64_t at;
+
+    void done(int e, int16_t t, uint16_t h)
+    {
+        calls++;
+        event = e;
+        temperature = t;
+        humidity = h;
+        at = MockI2C::now();
+    }
+};
+
+// Register address write, repeated start, 4 byte read
+static uint64_t read_wire_us(int hz)
+{
+    return ((uint64_t)2 * 9 + 2) * 1000000 / hz + 1 + ((uint64_t)5 * 9 + 2) * 1000000 / hz + 1;
+}
+
+// Start a read, check the caller was not held, run the bus to the callback
+static void async_read(HTS221& hts, Result& r, int expect_start)
+{
+    uint64_t blocked = MockI2C::blocked_us, start = MockI2C::now();
+    int ret;
+
+    r.calls = 0;
+    ret = hts.get_async(Callback<void(int, int16_t, uint16_t)>(&r, &Result::done));
+    CHECK(ret == expect_start, "get_async() returned %d, expected %d", ret, expect_start);
+    CHECK(MockI2C::now() == start && MockI2C::blocked_us == blocked, "get_async() held the caller for %lu us",
+          (unsigned long)(MockI2C::now() - start));
+    if (ret != 0) {
+        return;
+    }
+    CHECK(hts.busy(), "busy() false with a read in flight");
+    CHECK(hts.get_async(Callback<void(int, int16_t, uint16_t)>(&r, &Result::done)) == -1,
+          "a second get_async() was accepted while the first is in flight");
+    MockI2C::run();
+    CHECK(r.calls == 1, "callback ran %d times", r.calls);
+    CHECK(!hts.busy(), "busy() still true after the callback");
+}
+
+static void test_setup(HTS221& hts)
+{
+    CHECK(hts.init(), "init() failed");
+    CHECK(hts.calib(), "calib() failed");
+    CHECK(hts.get(), "get() failed");
+    CHECK(hts.temperature_x100() == 2150 && hts.humidity_x10() == 455, "calibrated read gave %d, %u",
+          hts.temperature_x100(), hts.humidity_x10());
+}
+
+static void test_complete(HTS221& hts, HTS221Model& model)
+{
+    static const int16_t temperatures[] = { -4000, -5, 0, 2150, 8765, 12000 };
+    Result r;
+
+    for (size_t i = 0; i < sizeof(temperatures) / sizeof(temperatures[0]); i++) {
+        uint16_t humidity = (uint16_t)(i * 200);
+        uint64_t start = MockI2C::now();
+
+        model.set(temperatures[i], humidity);
+        async_read(hts, r, 0);
+        CHECK(r.event == I2C_EVENT_TRANSFER_COMPLETE, "event %d, expected complete", r.event);
+        CHECK(r.temperature == temperatures[i] && r.humidity == humidity, "callback got %d, %u, expected %d, %u",
+              r.temperature, r.humidity, temperatures[i], humidity);
+        CHECK(hts.temperature_x100() == temperatures[i] && hts.humidity_x10() == humidity,
+              "getters give %d, %u after the callback", hts.temperature_x100(), hts.humidity_x10());
+        CHECK(r.at - start == read_wire_us(I2CBUS_DEFAULT_HZ), "latency %lu us, the wire needs %lu us",
+              (unsigned long)(r.at - start), (unsigned long)read_wire_us(I2CBUS_DEFAULT_HZ));
+    }
+}
+
+// A failed read reports its event, no sample, and keeps the last one for the getters
+static void test_failure(HTS221& hts, HTS221Model& model, MockFault fault, int event, const char *what)
+{
+    I2CHealth before = hts.health();
+    int16_t t = hts.temperature_x100();
+    uint16_t h = hts.humidity_x10();
+    Result r;
+
+    model.set(3335, 777);
+    MockI2C::fault(fault);
+    async_read(hts, r, 0);
+    CHECK(r.event == event, "%s: event %d, expected %d", what, r.event, event);
+    CHECK(r.temperature == 0 && r.humidity == 0, "%s: callback got a sample %d, %u", what, r.temperature, r.humidity);
+    CHECK(hts.temperature_x100() == t && hts.humidity_x10() == h, "%s: last sample overwritten", what);
+    if (fault == MOCK_TIMEOUT) {
+        CHECK(hts.health().timeouts == before.timeouts + 1, "%s: not counted as a timeout", what);
+        CHECK(r.at >= (uint64_t)I2C_MOCK_TIMEOUT_BYTES * 9 * 1000000 / I2CBUS_DEFAULT_HZ,
+              "%s: ended before the HAL timeout", what);
+    } else {
+        CHECK(hts.health().nacks == before.nacks + 1, "%s: not counted as a NACK", what);
+    }
+
+    // The bus is only checked after a timeout, by the next user of the bus
+    before = hts.health();
+    CHECK(hts.get(), "%s: blocking read after it failed", what);
+    CHECK(hts.health().recoveries == before.recoveries + (fault == MOCK_TIMEOUT ? 1 : 0),
+          "%s: %lu recoveries run", what, (unsigned long)(hts.health().recoveries - before.recoveries));
+
+    // And the next non-blocking read goes through
+    async_read(hts, r, 0);
+    CHECK(r.event == I2C_EVENT_TRANSFER_COMPLETE && r.temperature == 3335 && r.humidity == 777,
+          "%s: read after it gave event %d, %d, %u", what, r.event, r.temperature, r.humidity);
+}
+
+// The blocking read retries a NACK without touching the bus
+static void test_blocking_retry(HTS221& hts)
+{
+    I2CHealth before = hts.health();
+
+    MockI2C::fault(MOCK_NACK_ADDRESS);
+    CHECK(hts.get(), "get() did not retry a NACK");
+    CHECK(hts.health().retries == before.retries + 1 && hts.health().recoveries == before.recoveries,
+          "NACK retry: %lu retries, %lu recoveries", (unsigned long)(hts.health().retries - before.retries),
+          (unsigned long)(hts.health().recoveries - before.recoveries));
+
+    before = hts.health();
+    MockI2C::fault(MOCK_NACK_ADDRESS, 1 + I2CBUS_RETRIES);
+    CHECK(!hts.get(), "get() succeeded with every attempt NACKed");
+    CHECK(hts.health().failures == before.failures + 1, "failure not counted");
+}
+
+// Two sensors: the second read queues behind the first and is delayed by it
+static void test_queue(I2CBus& bus, HTS221& hts)
+{
+    HTS221Model other_model;
+    HTS221 other(bus, HTS221_OTHER);
+    Result a, b;
+    uint64_t start;
+
+    MockI2C::attach(HTS221_OTHER, &other_model);
+    other_model.set(-1235, 999);
+    other.calib();
+
+    a.calls = b.calls = 0;
+    start = MockI2C::now();
+    CHECK(hts.get_async(Callback<void(int, int16_t, uint16_t)>(&a, &Result::done)) == 0, "first read refused");
+    CHECK(other.get_async(Callback<void(int, int16_t, uint16_t)>(&b, &Result::done)) == 0, "queued read refused");
+    CHECK(MockI2C::now() == start, "queueing held the caller");
+    MockI2C::run();
+    CHECK(a.calls == 1 && b.calls == 1, "callbacks %d, %d", a.calls, b.calls);
+    CHECK(b.temperature == -1235 && b.humidity == 999, "queued read gave %d, %u", b.temperature, b.humidity);
+    CHECK(a.at - start == read_wire_us(I2CBUS_DEFAULT_HZ) && b.at - start == 2 * read_wire_us(I2CBUS_DEFAULT_HZ),
+          "latencies %lu and %lu us, expected %lu and %lu", (unsigned long)(a.at - start),
+          (unsigned long)(b.at - start), (unsigned long)read_wire_us(I2CBUS_DEFAULT_HZ),
+          (unsigned long)(2 * read_wire_us(I2CBUS_DEFAULT_HZ)));
+    MockI2C::attach(HTS221_OTHER, NULL);
+}
+
+// A transfer that never ends must not lock the bus up: the next user
+// waits I2CBUS_DRAIN_MS, then it ends as failed and the bus is recovered
+static void test_lost(HTS221& hts)
+{
+    I2CHealth before = hts.health();
+    uint64_t start;
+    Result r;
+
+    r.calls = 0;
+    MockI2C::fault(MOCK_LOST);
+    CHECK(hts.get_async(Callback<void(int, int16_t, uint16_t)>(&r, &Result::done)) == 0, "read refused");
+    MockI2C::run();
+    CHECK(r.calls == 0 && hts.busy(), "lost transfer ended by itself");
+
+    start = MockI2C::now();
+    CHECK(hts.get(), "blocking read after a lost transfer failed");
+    CHECK(MockI2C::now() - start >= (uint64_t)I2CBUS_DRAIN_MS * 1000 &&
+          MockI2C::now() - start < (uint64_t)2 * I2CBUS_DRAIN_MS * 1000,
+          "blocking read held %lu us behind the lost transfer", (unsigned long)(MockI2C::now() - start));
+    CHECK(r.calls == 1 && r.event == I2C_EVENT_ERROR, "lost transfer ended with %d callbacks, event %d", r.calls,
+          r.event);
+    CHECK(!hts.busy(), "device still busy after the abort");
+    CHECK(hts.health().timeouts == before.timeouts + 1 && hts.health().recoveries == before.recoveries + 1,
+          "abort: %lu timeouts, %lu recoveries", (unsigned long)(hts.health().timeouts - before.timeouts),
+          (unsigned long)(hts.health().recoveries - before.recoveries));
+
+    async_read(hts, r, 0);
+    CHECK(r.event == I2C_EVENT_TRANSFER_COMPLETE, "read after the abort gave event %d", r.event);
+}
+
+// Time the caller is held per sample, blocking against non-blocking
+static void latency(HTS221& hts)
+{
+    const int n = 1000;
+    uint64_t blocked, start, total = 0, worst = 0;
+    Result r;
+
+    blocked = MockI2C::blocked_us;
+    for (int i = 0; i < n; i++) {
+        hts.get();
+    }
+    blocked = MockI2C::blocked_us - blocked;
+
+    for (int i = 0; i < n; i++) {
+        start = MockI2C::now();
+        r.calls = 0;
+        hts.get_async(Callback<void(int, int16_t, uint16_t)>(&r, &Result::done));
+        MockI2C::run();
+        total += r.at - start;
+        if (r.at - start > worst) {
+            worst = r.at - start;
+        }
+    }
+    printf("latency at %d Hz: get() holds the caller %.1f us a sample; get_async() holds it 0 us,\n"
+           "  sample in the callback after %.1f us on average, %lu us at worst (simulated)\n",
+           I2CBUS_DEFAULT_HZ, (double)blocked / n, (double)total / n, (unsigned long)worst);
+}
+
+int main(void)
+{
+    HTS221Model model;
+
+    MockI2C::reset();
+    MockI2C::attach(HTS221_WriteADDE, &model);
+    I2CBus bus(I2C_SDA, I2C_SCL);
+    HTS221 hts(bus);
+
+    test_setup(hts);
+    test_complete(hts, model);
+    test_failure(hts, model, MOCK_NACK_ADDRESS, I2C_EVENT_ERROR_NO_SLAVE, "address NACK");
+    test_failure(hts, model, MOCK_NACK_DATA, I2C_EVENT_TRANSFER_EARLY_NACK, "data NACK");
+    test_failure(hts, model, MOCK_TIMEOUT, I2C_EVENT_ERROR, "timeout");
+    test_blocking_retry(hts);
+    test_queue(bus, hts);
+    test_lost(hts);
+    if (check_report()) {
+        return 1;
+    }
+    latency(hts);
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Host tests of the I2C timing cache, targets/TARGET_STM/i2c_timing.h
+ *
+ *   g++ -O2 -Itools/host -Imbed-os/targets/TARGET_STM tools/i2c_timing_test.cpp \
+ *       mbed-os/targets/TARGET_STM/i2c_timing.c -o i2c_timing_test
+ *   ./i2c_timing_test
+ *
+ * The cache runs as i2c_frequency() uses it on the F401 (I2C IP V1): a
+ * hit computed at the current APB1 clock is written to CCR and TRISE,
+ * anything else goes through HAL_I2C_Init(), modelled here with the
+ * formulas of stm32f4xx_hal_i2c.h, and is kept. After every switch the
+ * registers must hold what a fresh HAL_I2C_Init() would have written.
+ * Checks that more than I2C_TIMING_CACHE frequencies evict the one kept
+ * the longest ago, that a timing recomputed for a new APB1 clock replaces
+ * its own entry, that the I2Cs do not share entries, and
+ * i2c_timing_clear(). The exit status is 1 if a check fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "i2c_timing.h"
+#include "host/check.h"
+
+#define PCLK1           42000000    // APB1 of the F401 at 84 MHz
+#define PCLK1_SLOW      21000000
+
+// stm32f4xx_hal_i2c.h
+#define I2C_CCR_CCR     0x0FFFU
+#define I2C_CCR_FS      0x8000U
+
+static const int frequencies[] = { 100000, 400000, 10000, 50000, 200000, 300000 };
+#define FREQUENCIES     (int)(sizeof(frequencies) / sizeof(frequencies[0]))
+
+struct Bus {
+    int index;
+    uint32_t pclk;
+    uint32_t ccr;
+    uint32_t trise;
+    int inits;          // HAL_I2C_Init() calls, cache misses
+
+    Bus(int i) : index(i), pclk(PCLK1), ccr(0), trise(0), inits(0)
+    {
+    }
+};
+
+// What HAL_I2C_Init() writes, I2C_DUTYCYCLE_2
+static void hal_init(int hz, uint32_t pclk, uint32_t *ccr, uint32_t *trise)
+{
+    uint32_t range = pclk / 1000000;
+    uint32_t speed = (uint32_t)hz;
+
+    *trise = speed <= 100000 ? range + 1 : range * 300 / 1000 + 1;
+    if (speed <= 100000) {
+        *ccr = ((pclk / (speed << 1)) & I2C_CCR_CCR) < 4 ? 4 : pclk / (speed << 1);
+    } else {
+        uint32_t fast = pclk / (speed * 3);
+        *ccr = (fast & I2C_CCR_CCR) == 0 ? 1 : fast | I2C_CCR_FS;
+    }
+}
+
+// i2c_frequency() on a running master: i2c_timing_load(), else HAL_I2C_Init()
+// and i2c_timing_store()
+static void frequency(Bus& bus, int hz)
+{
+    const i2c_timing_t *cached = i2c_timing_find(bus.index, hz);
+    i2c_timing_t timing;
+
+    if (cached != NULL && cached->pclk == bus.pclk) {
+        bus.trise = cached->trise;
+        bus.ccr = cached->ccr;
+        return;
+    }
+    hal_init(hz, bus.pclk, &bus.ccr, &bus.trise);
+    bus.inits++;
+    timing.hz = hz;
+    timing.pclk = bus.pclk;
+    timing.ccr = bus.ccr;
+    timing.trise = bus.trise;
+    i2c_timing_keep(bus.index, &timing);
+}
+
+// The registers must be those of a fresh HAL_I2C_Init()
+static bool fresh(const Bus& bus, int hz)
+{
+    uint32_t ccr, trise;
+
+    hal_init(hz, bus.pclk, &ccr, &trise);
+    return bus.ccr == ccr && bus.trise == trise;
+}
+
+// Switch to each of frequencies[first..last], expecting 'misses' inits
+static void switch_to(Bus& bus, int first, int last, int misses, const char *what)
+{
+    int inits = bus.inits;
+
+    for (int i = first; i <= last; i++) {
+        frequency(bus, frequencies[i]);
+        CHECK(fresh(bus, frequencies[i]), "%s: %d Hz registers differ from a fresh init", what, frequencies[i]);
+    }
+    CHECK(bus.inits - inits == misses, "%s: %d inits, expected %d", what, bus.inits - inits, misses);
+}
+
+static bool kept(int bus, int i)
+{
+    return i2c_timing_find(bus, frequencies[i]) != NULL;
+}
+
+static void test_eviction(void)
+{
+    Bus bus(1);
+
+    i2c_timing_clear(bus.index);
+    switch_to(bus, 0, 3, 4, "first four");
+    switch_to(bus, 0, 3, 0, "first four again");
+    // A fifth replaces the first kept, then each miss the next oldest
+    switch_to(bus, 4, 4, 1, "fifth");
+    CHECK(!kept(bus.index, 0) && kept(bus.index, 1) && kept(bus.index, 4), "fifth did not replace the first");
+    switch_to(bus, 1, 4, 0, "second to fifth");
+    switch_to(bus, 0, 0, 1, "first back");
+    CHECK(!kept(bus.index, 1) && kept(bus.index, 2), "first back did not replace the second");
+    switch_to(bus, 5, 5, 1, "sixth");
+    CHECK(!kept(bus.index, 2) && kept(bus.index, 3) && kept(bus.index, 4) && kept(bus.index, 0),
+          "sixth did not replace the third");
+}
+
+static void test_clock_change(void)
+{
+    Bus bus(1);
+
+    i2c_timing_clear(bus.index);
+    switch_to(bus, 0, 3, 4, "at 42 MHz");
+    // Computed again for the new APB1 clock, in place of the old entry only
+    bus.pclk = PCLK1_SLOW;
+    switch_to(bus, 1, 1, 1, "400 kHz at 21 MHz");
+    CHECK(kept(bus.index, 0) && kept(bus.index, 2) && kept(bus.index, 3), "recomputed entry replaced another");
+    CHECK(i2c_timing_find(bus.index, frequencies[1])->pclk == PCLK1_SLOW, "recomputed entry not updated");
+    switch_to(bus, 1, 1, 0, "400 kHz at 21 MHz again");
+    switch_to(bus, 0, 0, 1, "100 kHz at 21 MHz");
+    bus.pclk = PCLK1;
+    switch_to(bus, 2, 3, 0, "back at 42 MHz");
+}
+
+static void test_buses(void)
+{
+    Bus a(0), b(2);
+
+    i2c_timing_clear(a.index);
+    i2c_timing_clear(b.index);
+    switch_to(a, 0, 3, 4, "I2C1");
+    switch_to(b, 2, 5, 4, "I2C3");
+    switch_to(b, 0, 1, 2, "I2C3 evicting");
+    switch_to(a, 0, 3, 0, "I2C1 after I2C3");
+
+    i2c_timing_clear(a.index);
+    for (int i = 0; i < FREQUENCIES; i++) {
+        CHECK(!kept(a.index, i), "%d Hz kept after a clear", frequencies[i]);
+    }
+    CHECK(kept(b.index, 0), "clear of I2C1 cleared I2C3");
+    switch_to(a, 0, 3, 4, "I2C1 after the clear");
+}
+
+// Random switches on two I2Cs, with the odd clock change
+static void test_random(void)
+{
+    Bus buses[2] = { Bus(0), Bus(1) };
+    int switches = 0, inits;
+
+    i2c_timing_clear(0);
+    i2c_timing_clear(1);
+    srand(3);
+    for (int n = 0; n < 100000; n++) {
+        Bus& bus = buses[rand() & 1];
+        int hz = frequencies[rand() % FREQUENCIES];
+
+        if (rand() % 1000 == 0) {
+            bus.pclk = bus.pclk == PCLK1 ? PCLK1_SLOW : PCLK1;
+        }
+        frequency(bus, hz);
+        switches++;
+        if (!fresh(bus, hz)) {
+            CHECK(false, "switch %d to %d Hz at %lu Hz APB1: registers differ from a fresh init", n, hz,
+                  (unsigned long)bus.pclk);
+            break;
+        }
+    }
+    inits = buses[0].inits + buses[1].inits;
+    // Six frequencies over four entries: at best 4 of 6 hit
+    CHECK(inits < switches / 2, "%d inits in %d switches", inits, switches);
+    printf("random: %d switches, %d inits\n", switches, inits);
+}
+
+int main(void)
+{
+    test_eviction();
+    test_clock_change();
+    test_buses();
+    test_random();
+    return check_report();
+}
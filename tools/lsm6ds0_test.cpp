@@ -0,0 +1,463 @@
+/*
+ * Host tests of the LSM6DS0 FIFO bursts, LSM6DS0/LSM6DS0.h, and of the
+ * block streaming on top of them, sampler/MotionStream.h
+ *
+ *   g++ -O2 -Itools/host -Ii2cbus -ILSM6DS0 -Itimebase -Isampler tools/lsm6ds0_test.cpp \
+ *       LSM6DS0/LSM6DS0.cpp sampler/MotionStream.cpp i2cbus/I2CBus.cpp tools/host/MockI2C.cpp \
+ *       -o lsm6ds0_test
+ *   ./lsm6ds0_test
+ *
+ * The real driver, I2CBus and MotionStream run against a register level
+ * model of the sensor on the simulated bus of tools/host/MockI2C.h. The
+ * model produces numbered samples at the output data rate into a 32 slot
+ * FIFO with the continuous and bypass modes, FIFO_SRC level, threshold and
+ * overrun flags, and the output address rollover (OUT_Z_H_G to OUT_X_L_XL,
+ * OUT_Z_H_XL back to OUT_X_L_G, popping a slot) that lets one burst drain
+ * it. Blocking and non-blocking bursts must return every sample once, in
+ * order, short and full reads alike, and a FIFO left to overflow must
+ * report it and resume with the newest 32. MotionStream must deliver
+ * gapless blocks while the consumer keeps up, count and recover from
+ * blocks it had to drop and from sensor FIFO overflows. The exit status
+ * is 1 if a check fails.
+ */
+#include <stdio.h>
+#include "mbed.h"
+#include "LSM6DS0.h"
+#include "MotionStream.h"
+#include "host/check.h"
+
+// Timebase::now() is inline over these; the base stays at zero, so it
+// reads the simulated ticker without timebase/Timebase.cpp
+Timebase::Base Timebase::_base[2];
+volatile uint8_t Timebase::_current;
+
+/** LSM6DS0 registers, FIFO and output data rate
+  *  Sample n has gyroscope n, n + 1, -n and accelerometer 3n, -3n, n ^ 0x5555,
+  *  as 16-bit words, so a burst shows which samples it got and in what order.
+  */
+class LSM6DS0Model : public MockRegisterSlave
+{
+public:
+    LSM6DS0Model() : MockRegisterSlave(false), produced(0), _period(0), _next(0), _head(0), _level(0), _overrun(false)
+    {
+        regs[LSM6DS0_WHO_AM_I] = I_AM_LSM6DS0;
+        regs[LSM6DS0_CTRL_REG8] = LSM6DS0_IF_ADD_INC;  // reset value
+    }
+
+    static void expected(uint32_t n, LSM6DS0_sample_t *sample)
+    {
+        sample->gyro[0] = (int16_t)n;
+        sample->gyro[1] = (int16_t)(n + 1);
+        sample->gyro[2] = (int16_t)-n;
+        sample->accel[0] = (int16_t)(3 * n);
+        sample->accel[1] = (int16_t)(-3 * n);
+        sample->accel[2] = (int16_t)(n ^ 0x5555);
+    }
+
+    virtual bool start(bool read)
+    {
+        update();
+        return MockRegisterSlave::start(read);
+    }
+
+    virtual bool write(uint8_t data)
+    {
+        update();
+        return MockRegisterSlave::write(data);
+    }
+
+    virtual uint8_t read(void)
+    {
+        uint8_t value;
+
+        update();
+        value = reg_read(_pointer);
+        if (!(regs[LSM6DS0_CTRL_REG8] & LSM6DS0_IF_ADD_INC)) {
+            return value;
+        }
+        if (fifo_enabled() && _pointer == LSM6DS0_OUT_X_L_G + 5) {
+            _pointer = LSM6DS0_OUT_X_L_XL;
+        } else if (fifo_enabled() && _pointer == LSM6DS0_OUT_X_L_XL + 5) {
+            pop();
+            _pointer = LSM6DS0_OUT_X_L_G;
+        } else {
+            _pointer++;
+        }
+        return value;
+    }
+
+    virtual uint8_t reg_read(uint8_t reg)
+    {
+        if (reg == LSM6DS0_FIFO_SRC) {
+            uint8_t threshold = regs[LSM6DS0_FIFO_CTRL] & 0x1f;
+            return (uint8_t)(_level | (_overrun ? LSM6DS0_FIFO_SRC_OVRN : 0) |
+                             (_level > 0 && _level >= threshold ? LSM6DS0_FIFO_SRC_FTH : 0));
+        }
+        if (reg >= LSM6DS0_OUT_X_L_G && reg < LSM6DS0_OUT_X_L_G + 6) {
+            return output()[reg - LSM6DS0_OUT_X_L_G];
+        }
+        if (reg >= LSM6DS0_OUT_X_L_XL && reg < LSM6DS0_OUT_X_L_XL + 6) {
+            return output()[6 + reg - LSM6DS0_OUT_X_L_XL];
+        }
+        return regs[reg];
+    }
+
+    virtual void reg_write(uint8_t reg, uint8_t value)
+    {
+        regs[reg] = value;
+        if (reg == LSM6DS0_CTRL_REG1_G) {
+            _period = period_us(value);
+            _next = MockI2C::now() + _period;
+        } else if (reg == LSM6DS0_FIFO_CTRL && (value & 0xe0) == LSM6DS0_FIFO_BYPASS) {
+            _level = 0;
+            _overrun = false;
+        }
+    }
+
+    // FIFO level, without going through the bus
+    int level(void)
+    {
+        update();
+        return _level;
+    }
+
+    // Time of the next sample
+    uint64_t next(void)
+    {
+        return _next;
+    }
+
+    uint32_t produced;          // samples taken since the start
+
+private:
+    static uint64_t period_us(uint8_t ctrl)
+    {
+        // 14.9, 59.5, 119, 238, 476 and 952 Hz
+        static const uint64_t us[8] = { 0, 67114, 16807, 8403, 4202, 2101, 1050, 0 };
+        return us[(ctrl >> 5) & 7];
+    }
+
+    bool fifo_enabled(void)
+    {
+        return (regs[LSM6DS0_CTRL_REG9] & LSM6DS0_FIFO_EN) && (regs[LSM6DS0_FIFO_CTRL] & 0xe0) != LSM6DS0_FIFO_BYPASS;
+    }
+
+    // Take the samples due by now
+    void update(void)
+    {
+        while (_period && _next <= MockI2C::now()) {
+            LSM6DS0_sample_t s;
+            uint8_t *slot;
+
+            expected(produced++, &s);
+            if (fifo_enabled()) {
+                if (_level == LSM6DS0_FIFO_DEPTH) {
+                    _head = (_head + 1) % LSM6DS0_FIFO_DEPTH;   // oldest overwritten
+                    _level--;
+                    _overrun = true;
+                }
+                slot = _fifo[(_head + _level++) % LSM6DS0_FIFO_DEPTH];
+            } else {
+                slot = _latest;
+            }
+            for (int i = 0; i < 3; i++) {
+                slot[2 * i] = (uint8_t)s.gyro[i];
+                slot[2 * i + 1] = (uint8_t)(s.gyro[i] >> 8);
+                slot[2 * i + 6] = (uint8_t)s.accel[i];
+                slot[2 * i + 7] = (uint8_t)(s.accel[i] >> 8);
+            }
+            _next += _period;
+        }
+    }
+
+    // Output registers: the oldest FIFO slot, or the latest sample in bypass
+    const uint8_t *output(void)
+    {
+        if (fifo_enabled()) {
+            return _fifo[_head];
+        }
+        return _latest;
+    }
+
+    void pop(void)
+    {
+        if (_level > 0) {
+            _head = (_head + 1) % LSM6DS0_FIFO_DEPTH;
+            _level--;
+            _overrun = false;
+        }
+    }
+
+    uint64_t _period;
+    uint64_t _next;
+    uint8_t _fifo[LSM6DS0_FIFO_DEPTH][LSM6DS0_RAW_SIZE];
+    uint8_t _latest[LSM6DS0_RAW_SIZE];
+    int _head;
+    int _level;
+    bool _overrun;
+};
+
+static bool same(const LSM6DS0_sample_t& a, const LSM6DS0_sample_t& b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Samples must be number 'first' on; returns the number after the last
+static uint32_t check_run(const LSM6DS0_sample_t *samples, int n, uint32_t first, const char *what)
+{
+    for (int i = 0; i < n; i++) {
+        LSM6DS0_sample_t want;
+
+        LSM6DS0Model::expected(first + i, &want);
+        if (!same(samples[i], want)) {
+            printf("FAIL %s: sample %d of %d is not number %lu (gyro x %d)\n", what, i, n,
+                   (unsigned long)(first + i), samples[i].gyro[0]);
+            failures++;
+            break;
+        }
+    }
+    return first + n;
+}
+
+// Wait for the next sample to arrive
+static void step(LSM6DS0Model& model)
+{
+    MockI2C::advance(model.next() - MockI2C::now());
+    model.level();
+}
+
+// Wait until the FIFO holds 'level' samples, just after the last arrived
+static void fill_to(LSM6DS0Model& model, int level)
+{
+    while (model.level() < level) {
+        step(model);
+    }
+}
+
+static void test_setup(LSM6DS0& imu, LSM6DS0Model& model)
+{
+    CHECK(imu.init(), "init() failed");
+    CHECK(model.regs[LSM6DS0_CTRL_REG8] == (LSM6DS0_BDU | LSM6DS0_IF_ADD_INC), "CTRL_REG8 0x%02x",
+          model.regs[LSM6DS0_CTRL_REG8]);
+    CHECK(model.regs[LSM6DS0_CTRL_REG9] & LSM6DS0_FIFO_EN, "FIFO not enabled");
+    CHECK(model.regs[LSM6DS0_FIFO_CTRL] == LSM6DS0_FIFO_CONTINUOUS, "FIFO_CTRL 0x%02x",
+          model.regs[LSM6DS0_FIFO_CTRL]);
+    wait_ms(100);
+    CHECK(imu.fifo_status() == 0, "FIFO_SRC 0x%02x powered down", imu.fifo_status());
+}
+
+// Blocking bursts: short, full and past an overflow
+static void test_blocking(LSM6DS0& imu, LSM6DS0Model& model)
+{
+    LSM6DS0_sample_t samples[LSM6DS0_FIFO_DEPTH + 4];
+    uint32_t next;
+    uint8_t status;
+    int n;
+
+    imu.odr(LSM6DS0_ODR_119HZ);
+    next = model.produced;
+    CHECK(imu.fifo_status() == 0, "odr() left %d samples in the FIFO", imu.fifo_status() & LSM6DS0_FIFO_SRC_FSS);
+
+    fill_to(model, 10);
+    n = imu.get_fifo(samples, 4);
+    CHECK(n == 4, "short burst read %d of 4", n);
+    next = check_run(samples, n, next, "short burst");
+    n = imu.get_fifo(samples, LSM6DS0_FIFO_DEPTH + 4);
+    CHECK(n == 6, "rest of the FIFO read %d of 6", n);
+    next = check_run(samples, n, next, "rest of the FIFO");
+
+    fill_to(model, LSM6DS0_FIFO_DEPTH);
+    status = imu.fifo_status();
+    CHECK(status == (LSM6DS0_FIFO_DEPTH | LSM6DS0_FIFO_SRC_FTH), "full FIFO_SRC 0x%02x", status);
+    n = imu.get_fifo(samples, LSM6DS0_FIFO_DEPTH + 4);
+    CHECK(n == LSM6DS0_FIFO_DEPTH, "full burst read %d", n);
+    next = check_run(samples, n, next, "full burst");
+
+    // Left for 40 more samples: the 8 oldest are lost, the newest 32 kept
+    fill_to(model, LSM6DS0_FIFO_DEPTH);
+    while (model.produced < next + LSM6DS0_FIFO_DEPTH + 8) {
+        step(model);
+    }
+    status = imu.fifo_status();
+    CHECK(status & LSM6DS0_FIFO_SRC_OVRN, "overflow not flagged, FIFO_SRC 0x%02x", status);
+    CHECK((status & LSM6DS0_FIFO_SRC_FSS) == LSM6DS0_FIFO_DEPTH, "overflowed FIFO holds %d",
+          status & LSM6DS0_FIFO_SRC_FSS);
+    n = imu.get_fifo(samples, LSM6DS0_FIFO_DEPTH);
+    CHECK(n == LSM6DS0_FIFO_DEPTH, "burst after overflow read %d", n);
+    next = check_run(samples, n, next + 8, "burst after overflow");
+    status = imu.fifo_status();
+    CHECK(!(status & LSM6DS0_FIFO_SRC_OVRN), "overflow still flagged after the burst, FIFO_SRC 0x%02x", status);
+
+    // A new rate starts from an empty FIFO
+    fill_to(model, 5);
+    imu.odr(LSM6DS0_ODR_238HZ);
+    CHECK(imu.fifo_status() == 0, "odr() left FIFO_SRC 0x%02x", imu.fifo_status());
+}
+
+// What the burst callback was given
+struct Burst {
+    int calls;
+    int event;
+    uint64_t at;
+
+    void done(int e)
+    {
+        calls++;
+        event = e;
+        at = MockI2C::now();
+    }
+};
+
+// Non-blocking bursts: the caller is not held, the samples are the same
+static void test_async(LSM6DS0& imu, LSM6DS0Model& model)
+{
+    char raw[LSM6DS0_FIFO_DEPTH * LSM6DS0_RAW_SIZE];
+    LSM6DS0_sample_t samples[LSM6DS0_FIFO_DEPTH];
+    uint64_t start, blocked;
+    uint32_t next;
+    Burst b;
+    int n, ret;
+
+    imu.odr(LSM6DS0_ODR_476HZ);
+    next = model.produced;
+    for (int round = 0; round < 4; round++) {
+        int level = round == 3 ? LSM6DS0_FIFO_DEPTH : 3 + round * 9;
+
+        fill_to(model, level);
+        n = imu.fifo_status() & LSM6DS0_FIFO_SRC_FSS;
+        CHECK(n >= level, "FIFO_SRC level %d, expected %d", n, level);
+        b.calls = 0;
+        start = MockI2C::now();
+        blocked = MockI2C::blocked_us;
+        ret = imu.get_fifo_async(raw, n, event_callback_t(&b, &Burst::done));
+        CHECK(ret == 0, "get_fifo_async(%d) returned %d", n, ret);
+        CHECK(MockI2C::now() == start && MockI2C::blocked_us == blocked, "get_fifo_async() held the caller");
+        MockI2C::run();
+        CHECK(b.calls == 1 && b.event == I2C_EVENT_TRANSFER_COMPLETE, "%d callbacks, event %d", b.calls, b.event);
+        for (int i = 0; i < n; i++) {
+            LSM6DS0::decode(&raw[i * LSM6DS0_RAW_SIZE], &samples[i]);
+        }
+        next = check_run(samples, n, next, "async burst");
+    }
+
+    CHECK(imu.get_fifo_async(raw, 0, event_callback_t(&b, &Burst::done)) == -1, "empty burst accepted");
+    CHECK(imu.get_fifo_async(raw, LSM6DS0_FIFO_DEPTH + 1, event_callback_t(&b, &Burst::done)) == -1,
+          "burst past the FIFO depth accepted");
+
+    // A NACKed burst reports it and pops nothing
+    fill_to(model, 4);
+    n = model.level();
+    b.calls = 0;
+    MockI2C::fault(MOCK_NACK_ADDRESS);
+    CHECK(imu.get_fifo_async(raw, n, event_callback_t(&b, &Burst::done)) == 0, "burst not started");
+    MockI2C::run();
+    CHECK(b.calls == 1 && b.event == I2C_EVENT_ERROR_NO_SLAVE, "NACKed burst: %d callbacks, event %d", b.calls,
+          b.event);
+    CHECK(model.level() >= n, "NACKed burst popped samples, %d left of %d", model.level(), n);
+    n = imu.get_fifo(samples, LSM6DS0_FIFO_DEPTH);
+    check_run(samples, n, next, "burst after a NACK");
+    imu.odr(LSM6DS0_ODR_OFF);
+}
+
+// Take the blocks on offer; returns the number taken
+static int consume(MotionStream& stream, uint32_t *next, bool release, MotionBlock **held)
+{
+    MotionBlock *block;
+    int taken = 0;
+
+    while ((block = stream.wait(0)) != NULL) {
+        CHECK(block->count == MOTION_BLOCK_SIZE && block->rate == 952, "block of %u at %u Hz", block->count,
+              block->rate);
+        CHECK(block->time <= MockI2C::now(), "block time %llu ahead of the clock", (unsigned long long)block->time);
+        if (*next == 0) {
+            // Picking up after a gap, from whatever sample the block starts with
+            *next = (uint16_t)block->data[0].gyro[0];
+        }
+        *next = check_run(block->data, MOTION_BLOCK_SIZE, *next, "stream block");
+        if (release) {
+            stream.release(block);
+        } else {
+            *held = block;
+        }
+        taken++;
+    }
+    return taken;
+}
+
+static void test_stream(LSM6DS0& imu, LSM6DS0Model& model)
+{
+    EventQueue queue;
+    MotionStream stream(imu, queue);
+    MotionBlock *held = NULL;
+    uint32_t next = 0, first, blocks = 0;
+    int taken;
+
+    CHECK(stream.start(LSM6DS0_ODR_952HZ), "start() failed");
+    first = model.produced;
+
+    // Consumer keeping up: every sample once, in order
+    for (int i = 0; i < 200; i++) {
+        queue.dispatch(10);
+        blocks += consume(stream, &next, true, &held);
+    }
+    CHECK(blocks >= 2000 * 952 / 1000 / MOTION_BLOCK_SIZE - 1, "%lu blocks in 2 s at 952 Hz",
+          (unsigned long)blocks);
+    CHECK(next - first == blocks * MOTION_BLOCK_SIZE, "blocks did not start at sample %lu", (unsigned long)first);
+    CHECK(stream.overruns() == 0 && stream.fifo_overruns() == 0, "%lu overruns, %lu FIFO overruns",
+          (unsigned long)stream.overruns(), (unsigned long)stream.fifo_overruns());
+
+    // Consumer holding its block: the other one fills, then is refilled
+    // and counted rather than the FIFO left to overflow
+    do {
+        queue.dispatch(10);
+    } while (consume(stream, &next, false, &held) == 0);
+    for (int i = 0; i < 30; i++) {
+        queue.dispatch(10);
+    }
+    CHECK(stream.overruns() >= 2, "%lu overruns with the consumer stalled 300 ms", (unsigned long)stream.overruns());
+    CHECK(stream.fifo_overruns() == 0, "sensor FIFO overflowed while the consumer stalled");
+    taken = consume(stream, &next, true, &held);
+    CHECK(taken == 0, "%d blocks queued while the consumer held the other", taken);
+    stream.release(held);
+    next = 0;
+    for (int i = 0; i < 20; i++) {
+        queue.dispatch(10);
+        consume(stream, &next, true, &held);
+    }
+
+    // Polling stalled past the FIFO depth: the sensor overflow is counted
+    // and the stream carries on
+    MockI2C::advance(100000);
+    queue.dispatch(10);
+    CHECK(stream.fifo_overruns() == 1, "%lu FIFO overruns after a 100 ms stall",
+          (unsigned long)stream.fifo_overruns());
+    // The block being filled spans the lost samples, the next ones are whole
+    do {
+        queue.dispatch(10);
+    } while ((held = stream.wait(0)) == NULL);
+    stream.release(held);
+    next = 0;
+    for (int i = 0; i < 20; i++) {
+        queue.dispatch(10);
+        consume(stream, &next, true, &held);
+    }
+    CHECK(model.level() < LSM6DS0_FIFO_DEPTH, "FIFO not drained after the stall");
+
+    stream.stop();
+    CHECK(!stream.running() && MockI2C::idle(), "stop() left the stream running or a burst in flight");
+    CHECK(model.regs[LSM6DS0_CTRL_REG1_G] >> 5 == 0, "stop() left the sensor running");
+}
+
+int main(void)
+{
+    I2CBus bus(I2C_SDA, I2C_SCL);
+    LSM6DS0Model model;
+    LSM6DS0 imu(bus);
+
+    MockI2C::attach(LSM6DS0_V_CHIP_ADDR, &model);
+    test_setup(imu, model);
+    test_blocking(imu, model);
+    test_async(imu, model);
+    test_stream(imu, model);
+    return check_report();
+}
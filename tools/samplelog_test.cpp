@@ -0,0 +1,234 @@
+/*
+ * Host tests and throughput of the in-RAM history, samplelog/SampleLog.h
+ *
+ *   g++ -O2 -Itools/host -Isamplelog -Icompress tools/samplelog_test.cpp \
+ *       samplelog/SampleLog.cpp compress/Delta.cpp -o samplelog_test
+ *   ./samplelog_test
+ *
+ * Checks that every field of a reading survives the coding at the ends
+ * of its range, that the ring drops whole blocks of the oldest readings
+ * once it wraps while what it holds still reads back exactly, at any
+ * offset and across block boundaries, that times wrapping past 2^32 ms
+ * come back unchanged, and clear(). The exit status is 1 if a check
+ * fails. Then times add() and read() on a day of 1 Hz readings.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "SampleLog.h"
+#include "host/check.h"
+
+#define CAPACITY    (SAMPLE_LOG_BLOCKS * SAMPLE_LOG_BLOCK_SIZE)
+#define REPEAT      20
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool same(const LogEntry& a, const LogEntry& b)
+{
+    return a.time == b.time && a.temperature == b.temperature && a.humidity == b.humidity &&
+           a.pressure == b.pressure;
+}
+
+static void print_entry(const char *what, const LogEntry& e)
+{
+    printf("  %s: %lu ms, %d, %u, %lu\n", what, (unsigned long)e.time, e.temperature, e.humidity,
+           (unsigned long)e.pressure);
+}
+
+// Readings as the device takes them: 1 Hz with some jitter, slow drifts and noise
+static std::vector<LogEntry> readings(size_t n, uint32_t start, unsigned seed)
+{
+    std::vector<LogEntry> v(n);
+    LogEntry e = { start, 2150, 455, 1013 * 4096 };
+
+    srand(seed);
+    for (size_t i = 0; i < n; i++) {
+        e.time += 1000 + (rand() % 8 == 0 ? rand() % 5 - 2 : 0);
+        e.temperature += rand() % 5 - 2;
+        e.humidity = (uint16_t)(e.humidity + rand() % 3 - 1);
+        e.pressure += rand() % 41 - 20;
+        v[i] = e;
+    }
+    return v;
+}
+
+// The log must hold exactly the newest count() of what was added
+static void check_tail(SampleLog& log, const std::vector<LogEntry>& added, const char *what)
+{
+    uint32_t count = log.count();
+    std::vector<LogEntry> out(count + 8);
+    size_t base;
+    uint32_t n;
+
+    CHECK(count <= added.size(), "%s: holds %lu readings, only %zu added", what, (unsigned long)count, added.size());
+    CHECK(log.bytes() <= CAPACITY, "%s: %lu bytes in a %d byte log", what, (unsigned long)log.bytes(), CAPACITY);
+    if (count > added.size()) {
+        return;
+    }
+    base = added.size() - count;
+
+    n = log.read(0, &out[0], count + 8);
+    CHECK(n == count, "%s: read everything gave %lu of %lu", what, (unsigned long)n, (unsigned long)count);
+    for (uint32_t i = 0; i < n; i++) {
+        if (!same(out[i], added[base + i])) {
+            printf("FAIL %s: reading %lu differs\n", what, (unsigned long)i);
+            print_entry("read", out[i]);
+            print_entry("added", added[base + i]);
+            failures++;
+            break;
+        }
+    }
+
+    // Short reads from every kind of offset, crossing block boundaries
+    for (uint32_t from = 0; from < count; from += 1 + from / 3) {
+        LogEntry part[7];
+        uint32_t want = count - from < 7 ? count - from : 7;
+
+        n = log.read(from, part, 7);
+        CHECK(n == want, "%s: read(%lu, 7) gave %lu, expected %lu", what, (unsigned long)from,
+              (unsigned long)n, (unsigned long)want);
+        for (uint32_t i = 0; i < n && i < want; i++) {
+            CHECK(same(part[i], added[base + from + i]), "%s: read(%lu, 7) reading %lu differs", what,
+                  (unsigned long)from, (unsigned long)i);
+        }
+    }
+    CHECK(log.read(count, &out[0], 1) == 0, "%s: read past the end returned data", what);
+}
+
+// Every field at the ends of its range, as single records and through the log
+static void test_fields(void)
+{
+    static const int16_t temperatures[] = { 0, -1, 1, -32768, 32767, -4000, 12000 };
+    static const uint16_t humidities[] = { 0, 1, 1000, 65535 };
+    static const uint32_t pressures[] = { 0, 1, 0xffffff, 0x1000000, 0x7fffffff, 0x80000000, 0xffffffff };
+    static const uint32_t times[] = { 0, 1, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff };
+    std::vector<LogEntry> added;
+    SampleLog *log = new SampleLog;
+    size_t i = 0;
+
+    for (size_t t = 0; t < sizeof(temperatures) / sizeof(temperatures[0]); t++) {
+        for (size_t h = 0; h < sizeof(humidities) / sizeof(humidities[0]); h++) {
+            for (size_t p = 0; p < sizeof(pressures) / sizeof(pressures[0]); p++, i++) {
+                LogEntry e = { times[i % (sizeof(times) / sizeof(times[0]))], temperatures[t], humidities[h], pressures[p] };
+                LogEntry back;
+                DeltaRecord record;
+
+                SampleLog::to_record(e, &record);
+                SampleLog::from_record(record, &back);
+                if (!same(e, back)) {
+                    printf("FAIL field round trip\n");
+                    print_entry("in", e);
+                    print_entry("out", back);
+                    failures++;
+                }
+                log->add(e);
+                added.push_back(e);
+            }
+        }
+    }
+    check_tail(*log, added, "extreme fields");
+    delete log;
+}
+
+// Fill the ring several times over, checking as it goes
+static void test_wrap(void)
+{
+    std::vector<LogEntry> all = readings(CAPACITY * 3, 0, 1);
+    std::vector<LogEntry> added;
+    SampleLog *log = new SampleLog;
+    uint32_t last_count = 0;
+    bool wrapped = false;
+
+    for (size_t i = 0; i < all.size(); i++) {
+        log->add(all[i]);
+        added.push_back(all[i]);
+        if (log->count() < last_count + 1) {
+            // The oldest block went: no more than one block of readings lost at once
+            CHECK(last_count + 1 - log->count() <= SAMPLE_LOG_BLOCK_SIZE,
+                  "wrap dropped %lu readings at once", (unsigned long)(last_count + 1 - log->count()));
+            CHECK(log->bytes() >= CAPACITY - SAMPLE_LOG_BLOCK_SIZE - DELTA_MAX_RECORD * SAMPLE_LOG_BLOCKS,
+                  "wrapped with only %lu of %d bytes used", (unsigned long)log->bytes(), CAPACITY);
+            if (!wrapped || i % 997 == 0) {
+                check_tail(*log, added, "after wrap");
+            }
+            wrapped = true;
+        }
+        last_count = log->count();
+    }
+    CHECK(wrapped, "%zu readings never wrapped the log", all.size());
+    check_tail(*log, added, "wrapped three times");
+    printf("wrap: %lu readings in %lu bytes held, %.2f bytes/reading\n", (unsigned long)log->count(),
+           (unsigned long)log->bytes(), (double)log->bytes() / log->count());
+
+    log->clear();
+    CHECK(log->count() == 0 && log->bytes() == 0, "clear() left %lu readings", (unsigned long)log->count());
+    added.clear();
+    for (size_t i = 0; i < 1000; i++) {
+        log->add(all[i]);
+        added.push_back(all[i]);
+    }
+    check_tail(*log, added, "after clear");
+    delete log;
+}
+
+// Millisecond times running past 2^32, about every 49.7 days
+static void test_time_wrap(void)
+{
+    std::vector<LogEntry> all = readings(20000, 0xffffffff - 10000 * 1000, 2);
+    SampleLog *log = new SampleLog;
+
+    CHECK(all.back().time < all.front().time, "test readings do not cross 2^32 ms");
+    for (size_t i = 0; i < all.size(); i++) {
+        log->add(all[i]);
+    }
+    check_tail(*log, all, "time wrap");
+    delete log;
+}
+
+static void throughput(void)
+{
+    std::vector<LogEntry> day = readings(86400, 0, 3);
+    std::vector<LogEntry> out(CAPACITY);
+    SampleLog *log = new SampleLog;
+    double start, add_s, read_s;
+    uint32_t n = 0;
+    int pass;
+
+    start = seconds();
+    for (pass = 0; pass < REPEAT; pass++) {
+        log->clear();
+        for (size_t i = 0; i < day.size(); i++) {
+            log->add(day[i]);
+        }
+    }
+    add_s = (seconds() - start) / REPEAT / day.size();
+
+    start = seconds();
+    for (pass = 0; pass < REPEAT; pass++) {
+        n = log->read(0, &out[0], log->count());
+    }
+    read_s = (seconds() - start) / REPEAT / n;
+
+    printf("throughput: add %.1f ns/reading, read %.1f ns/reading (host)\n", add_s * 1e9, read_s * 1e9);
+    printf("            %lu of a day's 86400 readings held in %d bytes\n", (unsigned long)log->count(), CAPACITY);
+    delete log;
+}
+
+int main(void)
+{
+    test_fields();
+    test_wrap();
+    test_time_wrap();
+    if (check_report()) {
+        return 1;
+    }
+    throughput();
+    return 0;
+}
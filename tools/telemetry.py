@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry stream of the weather monitor.
+
+Reads COBS framed samples (see telemetry/Telemetry.h) from a serial port or
+from a capture file, prints them as CSV and reports the sustained frame and
+byte rates when it stops.
+
+    telemetry.py /dev/ttyACM0           # sends 'B' to switch the board over
+    telemetry.py capture.bin            # decode a recorded stream
+    telemetry.py --bench                # decoder throughput on synthetic frames
+
+Serial ports need pyserial.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+SAMPLE_HTS221 = 0
+SAMPLE_LPS25H = 1
+TELEMETRY_EVENT = 0x80
+TELEMETRY_LOG = 0x81
+DELTA_SIZES = (0, 1, 2, 4)
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(b)
+            code += 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def zigzag_decode(u):
+    return (u >> 1) ^ -(u & 1)
+
+
+def delta_decode(data, count):
+    """Decode count records of a compress/Delta.h stream into
+    [time_ms, temperature, humidity, pressure] lists, or None if the data
+    ends early or runs on.
+    """
+    records = []
+    prev = [0, 0, 0, 0]
+    period = 0
+    i = 0
+    for _ in range(count):
+        if i >= len(data):
+            return None
+        tag = data[i]
+        i += 1
+        diff = []
+        for field in range(4):
+            size = DELTA_SIZES[(tag >> (2 * field)) & 3]
+            if i + size > len(data):
+                return None
+            diff.append(zigzag_decode(int.from_bytes(data[i:i + size], 'little')))
+            i += size
+        period = (period + diff[0]) & 0xFFFFFFFF
+        rec = [(prev[0] + period) & 0xFFFFFFFF]
+        for field in range(1, 4):
+            value = (prev[field] + diff[field]) & 0xFFFFFFFF
+            rec.append(value - (1 << 32) if value & 0x80000000 else value)
+        records.append(rec)
+        prev = rec
+    return records if i == len(data) else None
+
+
+def decode_frame(frame):
+    """Return (source, time_us, temperature, value) or None if the frame is bad.
+
+    HTS221 values are degC and %RH, LPS25H values are degC and hPa. Rule
+    events come back as (TELEMETRY_EVENT, time_us, rule, active, value),
+    the value in the fixed-point units of the rule's quantity. History
+    frames come back as (TELEMETRY_LOG, first_index, records), a record
+    being [time_ms, degC, %RH, hPa].
+    """
+    payload = cobs_decode(frame)
+    if payload is None or len(payload) < 3:
+        return None
+    body, crc = payload[:-2], struct.unpack('<H', payload[-2:])[0]
+    if crc16(body) != crc:
+        return None
+    if body[0] == SAMPLE_HTS221 and len(body) == 13:
+        _, t, temp, humi = struct.unpack('<BQhH', body)
+        return SAMPLE_HTS221, t, temp / 100.0, humi / 10.0
+    if body[0] == SAMPLE_LPS25H and len(body) == 14:
+        _, t, temp = struct.unpack('<BQh', body[:11])
+        press = body[11] | body[12] << 8 | body[13] << 16
+        return SAMPLE_LPS25H, t, temp / 480.0 + 42.5, press / 4096.0
+    if body[0] == TELEMETRY_EVENT and len(body) == 15:
+        _, t, rule, active, value = struct.unpack('<BQBBi', body)
+        return TELEMETRY_EVENT, t, rule, active, value
+    if body[0] == TELEMETRY_LOG and len(body) >= 6:
+        _, first, count = struct.unpack('<BIB', body[:6])
+        records = delta_decode(body[6:], count)
+        if records is None:
+            return None
+        return TELEMETRY_LOG, first, [[t, temp / 100.0, humi / 10.0, press / 4096.0]
+                                      for t, temp, humi, press in records]
+    return None
+
+
+def format_frame(frame):
+    if frame[0] == TELEMETRY_LOG:
+        _, first, records = frame
+        return '\n'.join('LOG,%d,%d,%.2f,%.1f,%.2f' % (first + i, t, temp, humi, press)
+                         for i, (t, temp, humi, press) in enumerate(records))
+    if frame[0] == TELEMETRY_EVENT:
+        _, t, rule, active, value = frame
+        return 'EVENT,%d,%d,%s,%d' % (t, rule, 'on' if active else 'off', value)
+    source, t, temp, value = frame
+    return '%s,%d,%.2f,%.2f' % ('HTS221' if source == SAMPLE_HTS221 else 'LPS25H', t, temp, value)
+
+
+class Decoder(object):
+    def __init__(self):
+        self.buf = bytearray()
+        self.frames = 0
+        self.errors = 0
+        self.bytes = 0
+
+    def feed(self, data):
+        self.bytes += len(data)
+        self.buf += data
+        while True:
+            end = self.buf.find(b'\0')
+            if end < 0:
+                return
+            frame, self.buf = bytes(self.buf[:end]), self.buf[end + 1:]
+            if not frame:
+                continue
+            sample = decode_frame(frame)
+            if sample is None:
+                # Text output or a corrupted frame, resync on the next zero
+                self.errors += 1
+            else:
+                self.frames += 1
+                yield sample
+
+
+def report(dec, elapsed, baud):
+    elapsed = max(elapsed, 1e-9)
+    line = '# %d frames, %d errors, %.1f frames/s, %.0f bytes/s' % (
+        dec.frames, dec.errors, dec.frames / elapsed, dec.bytes / elapsed)
+    if baud:
+        line += ', %.1f%% of %d baud' % (100.0 * dec.bytes * 10 / elapsed / baud, baud)
+    print(line, file=sys.stderr)
+
+
+def bench(count):
+    frames = []
+    for i in range(count):
+        if i & 1:
+            body = struct.pack('<BQh', SAMPLE_LPS25H, i * 40000, -2400) + bytes([0, 0x20, 0x3f])
+        else:
+            body = struct.pack('<BQhH', SAMPLE_HTS221, i * 40000, 2150, 455)
+        frames.append(cobs_encode(body + struct.pack('<H', crc16(body))) + b'\0')
+    stream = b''.join(frames)
+    dec = Decoder()
+    start = time.time()
+    n = sum(1 for _ in dec.feed(stream))
+    elapsed = time.time() - start
+    assert n == count and dec.errors == 0
+    print('# %d bytes/frame on the wire, text output is about 30' % (len(stream) // count), file=sys.stderr)
+    report(dec, elapsed, 0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('source', nargs='?', help='serial port or capture file')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--bench', type=int, nargs='?', const=100000, metavar='FRAMES',
+                    help='measure decoder throughput instead')
+    args = ap.parse_args()
+
+    if args.bench:
+        bench(args.bench)
+        return
+    if not args.source:
+        ap.error('no source given')
+
+    port = None
+    if os.path.isfile(args.source):
+        stream = open(args.source, 'rb')
+        baud = 0
+    else:
+        import serial
+        port = serial.Serial(args.source, args.baud, timeout=0.1)
+        port.write(b'B')
+        stream = port
+        baud = args.baud
+
+    dec = Decoder()
+    start = time.time()
+    try:
+        while True:
+            data = stream.read(256)
+            if not data:
+                if port is None:
+                    break
+                continue
+            for frame in dec.feed(data):
+                print(format_frame(frame))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if port is not None:
+            port.write(b'B')
+        report(dec, time.time() - start, baud)
+
+
+if __name__ == '__main__':
+    main()